@@ -0,0 +1,749 @@
+/*********************************************************************
+
+Copyright (c) 2007, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Benchmarks for the parser hot paths. Every result is one CSV line:
+	benchmark,variant,param,items,ns_total,ns_per_item,items_per_sec
+	Setup (superCompileOpt) is timed apart from matching and conversion
+	(superParseOptSpec); the superParseOpt_legacy variants pay for both on
+	every call, and getopt_long variants parse an equivalent table.
+	`make bench` runs everything; -only picks one benchmark.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "supergetopt.h"
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( ts.tv_sec * 1e9 + ts.tv_nsec );
+}
+
+static void report( const char *benchmark, const char *variant, long param, long items, double ns )
+{
+	printf("%s,%s,%ld,%ld,%.0f,%.2f,%.0f\n", benchmark, variant, param, items, ns, ns / (items > 0 ? items : 1), ns > 0 ? items * 1e9 / ns : 0.0);
+	fflush( stdout );
+}
+
+/* random tuning-coefficient style values, printed with full precision */
+static char **make_real_tokens( int n )
+{
+	char **tokens = (char **) malloc( (n + 1) * sizeof(char *) );
+	char buf[64];
+	int i;
+
+	for( i = 0 ; i < n ; i++ )
+	{
+		double v = (rand() / (double) RAND_MAX - 0.5) * (i % 3 == 0 ? 1e-3 : i % 3 == 1 ? 1.0 : 1e6);
+		sprintf( buf, i % 2 ? "%.17g" : "%.6f", v );
+		tokens[i] = strdup( buf );
+	}
+	tokens[n] = NULL;
+
+	return( tokens );
+}
+
+static void free_tokens( char **tokens, int n )
+{
+	int i;
+
+	for( i = 0 ; i < n ; i++ ) free( tokens[i] );
+	free( tokens );
+}
+
+/* %lf var-arg list through the library against the old per-value sscanf() */
+static void bench_reals( int n, int reps )
+{
+	char **tokens = make_real_tokens( n );
+	char **argv = (char **) malloc( (n + 2) * sizeof(char *) );
+	double *darray = (double *) malloc( n * sizeof(double) );
+	float *farray = (float *) malloc( n * sizeof(float) );
+	double *check = (double *) malloc( n * sizeof(double) );
+	int numd = n, numf = n;
+	SG_SPEC *dspec, *fspec;
+	double t0, t1;
+	int i, r, err;
+
+	argv[0] = "-coef";
+	memcpy( argv + 1, tokens, n * sizeof(char *) );
+
+	superCompileOpt( &dspec, &err, "-coef *%lf", darray, &numd, "coefficients", (char *) 0 );
+	superCompileOpt( &fspec, &err, "-coef *%f", farray, &numf, "coefficients", (char *) 0 );
+
+	t0 = now_ns();
+	for( r = 0 ; r < reps ; r++ ) superParseOptSpec( dspec, n + 1, argv, &err );
+	t1 = now_ns();
+	report( "reals", "superParseOpt_lf", n, (long) n * reps, t1 - t0 );
+
+	t0 = now_ns();
+	for( r = 0 ; r < reps ; r++ ) superParseOptSpec( fspec, n + 1, argv, &err );
+	t1 = now_ns();
+	report( "reals", "superParseOpt_f", n, (long) n * reps, t1 - t0 );
+
+	t0 = now_ns();
+	for( r = 0 ; r < reps ; r++ )
+	{
+		for( i = 0 ; i < n ; i++ ) sscanf( tokens[i], "%lf", &check[i] );
+	}
+	t1 = now_ns();
+	report( "reals", "sscanf_lf", n, (long) n * reps, t1 - t0 );
+
+	for( i = 0 ; i < n ; i++ )
+	{
+		if( darray[i] != check[i] ) fprintf(stderr, "reals: mismatch at %d <%s>\n", i, tokens[i]);
+	}
+
+	superFreeOpt( dspec );
+	superFreeOpt( fspec );
+	free( argv ); free( darray ); free( farray ); free( check );
+	free_tokens( tokens, n );
+}
+
+/* Flag tables of 16 ... 4096 options named -o1xxxx (binary), option
+	-o1xxxx writing flags[0b1xxxx]. Each size gets its own compile and
+	legacy call site since the options are passed as varargs. */
+static int flags[8192];
+
+#define OPT1(p)		"-o" #p, &flags[0b ## p], ""
+#define OPT2(p)		OPT1(p##0), OPT1(p##1)
+#define OPT4(p)		OPT2(p##0), OPT2(p##1)
+#define OPT8(p)		OPT4(p##0), OPT4(p##1)
+#define OPT16(p)	OPT8(p##0), OPT8(p##1)
+#define OPT32(p)	OPT16(p##0), OPT16(p##1)
+#define OPT64(p)	OPT32(p##0), OPT32(p##1)
+#define OPT128(p)	OPT64(p##0), OPT64(p##1)
+#define OPT256(p)	OPT128(p##0), OPT128(p##1)
+#define OPT512(p)	OPT256(p##0), OPT256(p##1)
+#define OPT1024(p)	OPT512(p##0), OPT512(p##1)
+#define OPT2048(p)	OPT1024(p##0), OPT1024(p##1)
+#define OPT4096(p)	OPT2048(p##0), OPT2048(p##1)
+
+#define OPTION_TABLE(n) \
+	static int compile_##n( SG_SPEC **pSpec ) { int err; return( superCompileOpt( pSpec, &err, OPT##n(1), (char *) 0 ) ); } \
+	static int legacy_##n( int argc, char **argv ) { int err; return( superParseOpt( argc, argv, &err, OPT##n(1), (char *) 0 ) ); }
+
+OPTION_TABLE(16)
+OPTION_TABLE(64)
+OPTION_TABLE(1024)
+OPTION_TABLE(4096)
+
+static const struct
+{
+	int n;
+	int (*compile)( SG_SPEC **pSpec );
+	int (*legacy)( int argc, char **argv );
+} optionTables[] = {
+	{ 16, compile_16, legacy_16 },
+	{ 64, compile_64, legacy_64 },
+	{ 1024, compile_1024, legacy_1024 },
+	{ 4096, compile_4096, legacy_4096 },
+};
+
+/* name of flag i (0 <= i < n) in the n-option table, without the dash */
+static void flag_name( char *buf, int n, int i )
+{
+	int bit;
+
+	*buf++ = 'o';
+	for( bit = n ; bit > 0 ; bit >>= 1 ) *buf++ = (n + i) & bit ? '1' : '0';
+	*buf = 0;
+}
+
+#define OPTIONS_ARGC 256
+
+/* option count: setup, then matching 256 flag tokens */
+static void bench_options( int reps )
+{
+	char *argv[OPTIONS_ARGC + 1];
+	char names[OPTIONS_ARGC][24];
+	struct option *longopts;
+	SG_SPEC *spec;
+	double t0, t1;
+	int t, i, r, n;
+
+	for( t = 0 ; t < (int) (sizeof(optionTables) / sizeof(optionTables[0])) ; t++ )
+	{
+		n = optionTables[t].n;
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			optionTables[t].compile( &spec );
+			superFreeOpt( spec );
+		}
+		t1 = now_ns();
+		report( "options", "superCompileOpt", n, reps, t1 - t0 );
+
+		argv[0] = "prog";
+		for( i = 0 ; i < OPTIONS_ARGC ; i++ )
+		{
+			names[i][0] = '-';
+			flag_name( names[i] + 1, n, rand() % n );
+			argv[i + 1] = names[i];
+		}
+
+		optionTables[t].compile( &spec );
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ ) superParseOptSpec( spec, OPTIONS_ARGC, argv + 1, &i );
+		t1 = now_ns();
+		report( "options", "superParseOptSpec", n, (long) OPTIONS_ARGC * reps, t1 - t0 );
+		superFreeOpt( spec );
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ ) optionTables[t].legacy( OPTIONS_ARGC, argv + 1 );
+		t1 = now_ns();
+		report( "options", "superParseOpt_legacy", n, (long) OPTIONS_ARGC * reps, t1 - t0 );
+
+		// getopt_long_only() accepts the same single-dash long names
+		longopts = (struct option *) calloc( n + 1, sizeof(struct option) );
+		for( i = 0 ; i < n ; i++ )
+		{
+			char *name = (char *) malloc( 24 );
+
+			flag_name( name, n, i );
+			longopts[i].name = name;
+			longopts[i].has_arg = no_argument;
+			longopts[i].flag = &flags[n + i];
+			longopts[i].val = 1;
+		}
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			optind = 0;
+			while( getopt_long_only( OPTIONS_ARGC + 1, argv, "", longopts, NULL ) != -1 );
+		}
+		t1 = now_ns();
+		report( "options", "getopt_long", n, (long) OPTIONS_ARGC * reps, t1 - t0 );
+
+		for( i = 0 ; i < n ; i++ ) free( (char *) longopts[i].name );
+		free( longopts );
+	}
+}
+
+/* argv length: a few typed options repeated to fill argv */
+static void bench_argv( int reps )
+{
+	static const int lengths[] = { 8, 64, 1024, 16384 };
+	static char *group[] = { "-count", "42", "-scale", "2.5", "-name", "nightly", "-verbose" };
+	static const struct option longopts[] = {
+		{ "count", required_argument, NULL, 'c' },
+		{ "scale", required_argument, NULL, 'x' },
+		{ "name", required_argument, NULL, 'n' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ NULL, 0, NULL, 0 }
+	};
+	char **argv;
+	SG_SPEC *spec;
+	int count, verbose, err, len, i, r, c;
+	double scale, t0, t1;
+	char *name;
+
+	superCompileOpt( &spec, &err,
+			"-count %d", &count, "",
+			"-scale %lf", &scale, "",
+			"-name %s", &name, "",
+			"-verbose", &verbose, "",
+			(char *) 0 );
+
+	for( i = 0 ; i < (int) (sizeof(lengths) / sizeof(lengths[0])) ; i++ )
+	{
+		len = lengths[i] - lengths[i] % 7;
+		argv = (char **) malloc( (len + 2) * sizeof(char *) );
+		argv[0] = "prog";
+		for( c = 0 ; c < len ; c++ ) argv[c + 1] = group[c % 7];
+		argv[len + 1] = NULL;
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ ) superParseOptSpec( spec, len, argv + 1, &err );
+		t1 = now_ns();
+		report( "argv", "superParseOptSpec", len, (long) len * reps, t1 - t0 );
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			optind = 0;
+			while( (c = getopt_long_only( len + 1, argv, "", longopts, NULL )) != -1 )
+			{
+				switch( c )
+				{
+					case 'c': count = (int) strtol( optarg, NULL, 10 ); break;
+					case 'x': scale = strtod( optarg, NULL ); break;
+					case 'n': name = optarg; break;
+					case 'v': verbose = 1; break;
+				}
+			}
+		}
+		t1 = now_ns();
+		report( "argv", "getopt_long", len, (long) len * reps, t1 - t0 );
+
+		free( argv );
+	}
+
+	superFreeOpt( spec );
+}
+
+/* var-arg list size for *%d, *%lf and *%s */
+static void bench_varlists( int reps )
+{
+	static const int sizes[] = { 16, 1024, 65536 };
+	static const char *formats[] = { "-list *%d", "-list *%lf", "-list *%s" };
+	static const char *variants[] = { "int", "double", "string" };
+	int maxN = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+	char **reals = make_real_tokens( maxN );
+	char **argv = (char **) malloc( (maxN + 2) * sizeof(char *) );
+	char *text = (char *) malloc( (size_t) maxN * 16 );
+	void *array = malloc( (size_t) maxN * sizeof(double) );
+	SG_SPEC *spec;
+	double t0, t1;
+	int f, i, r, n, num, err;
+	char variant[32];
+
+	for( f = 0 ; f < 3 ; f++ )
+	{
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			superCompileOpt( &spec, &err, formats[f], array, &num, "", (char *) 0 );
+			superFreeOpt( spec );
+		}
+		t1 = now_ns();
+		sprintf( variant, "superCompileOpt_%s", variants[f] );
+		report( "varlists", variant, 1, reps, t1 - t0 );
+
+		superCompileOpt( &spec, &err, formats[f], array, &num, "", (char *) 0 );
+		for( i = 0 ; i < (int) (sizeof(sizes) / sizeof(sizes[0])) ; i++ )
+		{
+			n = sizes[i];
+			argv[0] = "-list";
+			for( r = 0 ; r < n ; r++ )
+			{
+				if( f == 1 ) argv[r + 1] = reals[r];
+				else
+				{
+					argv[r + 1] = text + (size_t) r * 16;
+					sprintf( argv[r + 1], f == 0 ? "%d" : "s%d", rand() - RAND_MAX / 2 );
+				}
+			}
+
+			t0 = now_ns();
+			for( r = 0 ; r < reps ; r++ )
+			{
+				num = n;
+				superParseOptSpec( spec, n + 1, argv, &err );
+			}
+			t1 = now_ns();
+			sprintf( variant, "superParseOptSpec_%s", variants[f] );
+			report( "varlists", variant, n, (long) n * reps, t1 - t0 );
+		}
+		superFreeOpt( spec );
+	}
+
+	free_tokens( reals, maxN );
+	free( argv ); free( text ); free( array );
+}
+
+/* recorded job submissions: a few scalar options and a dependency list */
+struct job_s
+{
+	int id;
+	int cpus;
+	double mem;
+	char *queue;
+	char *name;
+	int deps[16];
+	int numDeps;
+};
+
+/* superParseBatch() records/second at 1, 2, 4 ... maxThreads threads */
+static void bench_batch( int n, int maxThreads, int reps )
+{
+	SG_RECORD *records = (SG_RECORD *) malloc( n * sizeof(SG_RECORD) );
+	struct job_s *jobs = (struct job_s *) malloc( n * sizeof(struct job_s) );
+	char **strings = (char **) malloc( n * 24 * sizeof(char *) );
+	char *text = (char *) malloc( (size_t) n * 16 * 16 );	// numbers, 16 bytes each
+	struct job_s template;
+	SG_SPEC *spec;
+	double t0, t1;
+	int i, k, r, t, err, argc;
+
+	template.numDeps = 16;
+	superCompileOpt( &spec, &err,
+			"-id %d", &template.id, "job id",
+			"-cpus %d", &template.cpus, "cpus",
+			"-mem %lf", &template.mem, "memory in GB",
+			"-queue %s", &template.queue, "queue",
+			"-name %s", &template.name, "job name",
+			"-deps *%d", template.deps, &template.numDeps, "job ids to wait for",
+			(char *) 0 );
+
+	for( i = 0 ; i < n ; i++ )
+	{
+		char **argv = strings + i * 24;
+		char *num = text + (size_t) i * 16 * 16;
+
+		argc = 0;
+		argv[argc++] = "-id";
+		sprintf( num, "%d", i );			argv[argc++] = num; num += 16;
+		argv[argc++] = "-cpus";
+		sprintf( num, "%d", 1 << (i % 6) );	argv[argc++] = num; num += 16;
+		argv[argc++] = "-mem";
+		sprintf( num, "%.3f", (i % 97) * 0.75 );	argv[argc++] = num; num += 16;
+		argv[argc++] = "-queue";
+		argv[argc++] = i % 3 ? "batch" : "interactive";
+		argv[argc++] = "-name";
+		argv[argc++] = "nightly-regression";
+		argv[argc++] = "-deps";
+		for( k = 0 ; k < i % 12 ; k++ )
+		{
+			sprintf( num, "%d", i - k - 1 );
+			argv[argc++] = num; num += 16;
+		}
+
+		records[i].argc = argc;
+		records[i].argv = argv;
+		records[i].out = &jobs[i];
+	}
+
+	for( t = 1 ; ; t = t * 2 > maxThreads && t < maxThreads ? maxThreads : t * 2 )
+	{
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ ) superParseBatch( spec, records, n, &template, sizeof(template), t );
+		t1 = now_ns();
+		report( "batch", "superParseBatch", t, (long) n * reps, t1 - t0 );
+		if( t >= maxThreads ) break;
+	}
+
+	for( i = 0 ; i < n ; i++ )
+	{
+		if( records[i].status != 0 || jobs[i].id != i ) fprintf(stderr, "batch: bad record %d\n", i);
+	}
+
+	superFreeOpt( spec );
+	free( records ); free( jobs ); free( strings ); free( text );
+}
+
+/* One *%lf or *%d run of 1K ... 1M values, converted on one thread
+	(parallelMin 0) and on maxThreads threads from its first value on
+	(parallelMin 1), which shows where SG_PARALLEL_MIN pays off. */
+static void bench_parallel( int maxThreads, int reps )
+{
+	static const int lengths[] = { 1024, 16384, 262144, 1048576 };
+	static const char *formats[] = { "-list *%lf", "-list *%d" };
+	static const char *variants[] = { "double", "int" };
+	const int maxN = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+	char **tokens = make_real_tokens( maxN );
+	char **argv = (char **) malloc( (maxN + 1) * sizeof(char *) );
+	char *ints = (char *) malloc( (size_t) maxN * 12 );
+	double *array = (double *) malloc( maxN * sizeof(double) );
+	char variant[64];
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	double t0, t1;
+	int f, l, i, r, p, n, num = 0, err, lastArg;
+
+	argv[0] = "-list";
+	for( f = 0 ; f < 2 ; f++ )
+	{
+		for( i = 0 ; i < maxN ; i++ )
+		{
+			if( f == 0 ) argv[i + 1] = tokens[i];
+			else
+			{
+				argv[i + 1] = ints + (size_t) i * 12;
+				sprintf( argv[i + 1], "%d", rand() - RAND_MAX / 2 );
+			}
+		}
+		num = maxN;
+		superCompileOpt( &spec, &err, formats[f], array, &num, "values", (char *) 0 );
+
+		for( l = 0 ; l < (int) (sizeof(lengths) / sizeof(lengths[0])) ; l++ )
+		{
+			n = lengths[l];
+			for( p = 0 ; p < 2 ; p++ )
+			{
+				superInitCtx( &ctx, spec, NULL, NULL, 0 );
+				ctx.parallelMin = p;
+				ctx.parallelThreads = maxThreads;
+
+				t0 = now_ns();
+				for( r = 0 ; r < reps ; r++ )
+				{
+					num = maxN;
+					if( superParseOptCtx( &ctx, n + 1, argv, &lastArg ) != 0 || num != n ) fprintf(stderr, "parallel: bad parse of %d values\n", n);
+				}
+				t1 = now_ns();
+				sprintf( variant, "%s_%s", p ? "threads" : "serial", variants[f] );
+				report( "parallel", variant, n, (long) n * reps, t1 - t0 );
+			}
+		}
+		superFreeOpt( spec );
+	}
+
+	free( argv ); free( ints ); free( array );
+	free_tokens( tokens, maxN );
+}
+
+/* 64 options of 256 *%lf values each, parsed eagerly and lazily, the
+	lazy runs reading 0, 1 or all 64 options' values through
+	superLazyGet(), or everything through superLazyValidate(). */
+static void bench_lazy( int reps )
+{
+	enum { OPTS = 64, VALUES = 256 };
+	static const char *variants[] = { "eager", "lazy_read0", "lazy_read1", "lazy_read64", "lazy_validate" };
+	char **tokens = make_real_tokens( OPTS * VALUES );
+	char **argv = (char **) malloc( OPTS * (VALUES + 1) * sizeof(char *) );
+	char *names = (char *) malloc( OPTS * 16 );
+	double *arrays = (double *) malloc( OPTS * VALUES * sizeof(double) );
+	int nums[OPTS], type = SG_TYPE_DOUBLE;
+	void *ptrs[OPTS];
+	SG_OPTION options[OPTS];
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	double t0, t1, value;
+	int i, k, r, v, argc = 0, err, lastArg;
+
+	for( i = 0 ; i < OPTS ; i++ )
+	{
+		sprintf( names + i * 16, "-c%d", i );
+		nums[i] = VALUES;
+		ptrs[i] = arrays + i * VALUES;
+		options[i].name = names + i * 16;
+		options[i].namelen = (int) strlen( options[i].name );
+		options[i].numargs = 1;
+		options[i].flags = SG_OPTION_VAR;
+		options[i].types = &type;
+		options[i].ptrs = &ptrs[i];
+		options[i].pNumArgs = &nums[i];
+		options[i].help = "";
+		options[i].stream = NULL;
+
+		argv[argc++] = names + i * 16;
+		for( k = 0 ; k < VALUES ; k++ ) argv[argc++] = tokens[i * VALUES + k];
+	}
+	superCompileTable( &spec, options, OPTS, &err );
+
+	for( v = 0 ; v < 5 ; v++ )
+	{
+		superInitCtx( &ctx, spec, NULL, NULL, 0 );
+		ctx.lazy = v > 0;
+
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			if( superParseOptCtx( &ctx, argc, argv, &lastArg ) != 0 ) fprintf(stderr, "lazy: bad parse\n");
+			for( i = 0 ; i < (v == 2 ? 1 : v == 3 ? OPTS : 0) ; i++ )
+			{
+				for( k = 0 ; k < VALUES ; k++ ) superLazyGet( &ctx, i, k, SG_TYPE_DOUBLE, &value );
+			}
+			if( v == 4 && superLazyValidate( &ctx, &lastArg ) != 0 ) fprintf(stderr, "lazy: bad value\n");
+		}
+		t1 = now_ns();
+		report( "lazy", variants[v], OPTS, (long) OPTS * VALUES * reps, t1 - t0 );
+	}
+
+	superFreeOpt( spec );
+	free( argv ); free( names ); free( arrays );
+	free_tokens( tokens, OPTS * VALUES );
+}
+
+/* Control-channel command lines, dispatched through superParseCommand()
+	against specs compiled once, and the old way: split into an argv by
+	hand and handed to superParseOpt() with the command's formats, which
+	compiles them again on every line. */
+static void bench_commands( int reps )
+{
+	enum { LINES = 3000 };
+	static const char *names[] = { "set", "get", "sum" };
+	static const char *templates[] = { "set -key k%d -value %d", "get -key k%d", "sum -n 1 2 3 4 5 %d 7 %d" };
+	char (*lines)[64] = (char (*)[64]) malloc( LINES * 64 );
+	char buf[64], *argv[16], *key = NULL, *p;
+	SG_SPEC *specs[3];
+	SG_COMMANDS *cmds;
+	SG_CTX ctx;
+	double t0, t1;
+	int ints[16], numInts = 16, value = 0, i, r, v, c, argc, err, lastArg, bad = 0;
+
+	for( i = 0 ; i < LINES ; i++ ) sprintf( lines[i], templates[i % 3], i, i * 7 );
+	superCompileOpt( &specs[0], &err, "-key %s", &key, "", "-value %d", &value, "", (char *) 0 );
+	superCompileOpt( &specs[1], &err, "-key %s", &key, "", (char *) 0 );
+	superCompileOpt( &specs[2], &err, "-n *%d", ints, &numInts, "", (char *) 0 );
+	superCompileCommands( &cmds, names, specs, 3 );
+	superInitCtx( &ctx, NULL, NULL, NULL, 0 );
+
+	for( v = 0 ; v < 2 ; v++ )
+	{
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			for( i = 0 ; i < LINES ; i++ )
+			{
+				strcpy( buf, lines[i] );
+				if( v == 0 )
+				{
+					bad |= superParseCommand( cmds, &ctx, buf, &c, &lastArg );
+					continue;
+				}
+
+				for( argc = 0, p = strtok( buf, " " ) ; p != NULL && argc < 16 ; p = strtok( NULL, " " ) ) argv[argc++] = p;
+				numInts = 16;
+				if( strcmp( argv[0], "set" ) == 0 ) bad |= superParseOpt( argc - 1, argv + 1, &lastArg, "-key %s", &key, "", "-value %d", &value, "", (char *) 0 );
+				else if( strcmp( argv[0], "get" ) == 0 ) bad |= superParseOpt( argc - 1, argv + 1, &lastArg, "-key %s", &key, "", (char *) 0 );
+				else bad |= superParseOpt( argc - 1, argv + 1, &lastArg, "-n *%d", ints, &numInts, "", (char *) 0 );
+			}
+		}
+		t1 = now_ns();
+		report( "commands", v ? "argv_superParseOpt" : "superParseCommand", 3, (long) LINES * reps, t1 - t0 );
+	}
+	if( bad ) fprintf(stderr, "commands: bad parse\n");
+
+	superFreeCommands( cmds );
+	for( i = 0 ; i < 3 ; i++ ) superFreeOpt( specs[i] );
+	free( lines );
+}
+
+/* A tool of 64 subcommands with 32 %d options each, started for one
+	subcommand: every table compiled up front, or a subcommand set that
+	compiles only the chosen one. Each rep is one tool start. */
+static void bench_subcommands( int reps )
+{
+	enum { SUBS = 64, OPTS = 32 };
+	static const int type = SG_TYPE_INT;
+	SG_OPTION *options = (SG_OPTION *) malloc( SUBS * OPTS * sizeof(SG_OPTION) );
+	SG_SUBCOMMAND subs[SUBS];
+	SG_SPEC *specs[SUBS];
+	SG_SUBCOMMANDS *set;
+	SG_CTX ctx;
+	char *names = (char *) malloc( SUBS * 16 + OPTS * 16 );
+	char *argv[] = { "tool", NULL, NULL, "7" };
+	int values[OPTS];
+	void *ptrs[OPTS];
+	double t0, t1;
+	int i, k, r, v, c, err, lastArg, bad = 0;
+
+	for( k = 0 ; k < OPTS ; k++ )
+	{
+		sprintf( names + SUBS * 16 + k * 16, "-option%d", k );
+		ptrs[k] = &values[k];
+	}
+	for( i = 0 ; i < SUBS ; i++ )
+	{
+		sprintf( names + i * 16, "command%d", i );
+		for( k = 0 ; k < OPTS ; k++ )
+		{
+			options[i * OPTS + k].name = names + SUBS * 16 + k * 16;
+			options[i * OPTS + k].namelen = (int) strlen( options[i * OPTS + k].name );
+			options[i * OPTS + k].numargs = 1;
+			options[i * OPTS + k].flags = 0;
+			options[i * OPTS + k].types = &type;
+			options[i * OPTS + k].ptrs = &ptrs[k];
+			options[i * OPTS + k].pNumArgs = NULL;
+			options[i * OPTS + k].help = "an option";
+			options[i * OPTS + k].stream = NULL;
+		}
+		subs[i].name = names + i * 16;
+		subs[i].options = options + i * OPTS;
+		subs[i].numOptions = OPTS;
+		subs[i].help = "a subcommand";
+	}
+	argv[1] = names + 17 * 16;
+	argv[2] = names + SUBS * 16 + 5 * 16;
+
+	for( v = 0 ; v < 2 ; v++ )
+	{
+		t0 = now_ns();
+		for( r = 0 ; r < reps ; r++ )
+		{
+			if( v == 0 )
+			{
+				for( i = 0 ; i < SUBS ; i++ ) bad |= superCompileTable( &specs[i], subs[i].options, OPTS, &err );
+				superInitCtx( &ctx, specs[17], NULL, NULL, 0 );
+				bad |= superParseOptCtx( &ctx, 2, argv + 2, &lastArg );
+				for( i = 0 ; i < SUBS ; i++ ) superFreeOpt( specs[i] );
+			}
+			else
+			{
+				bad |= superNewSubcommands( &set, subs, SUBS );
+				superInitCtx( &ctx, NULL, NULL, NULL, 0 );
+				bad |= superParseSubcommand( set, &ctx, 4, argv, &c, &lastArg );
+				superFreeSubcommands( set );
+			}
+		}
+		t1 = now_ns();
+		report( "subcommands", v ? "compile_chosen" : "compile_all", SUBS, reps, t1 - t0 );
+	}
+	if( bad || values[5] != 7 ) fprintf(stderr, "subcommands: bad parse\n");
+
+	free( options );
+	free( names );
+}
+
+int main( int argc, char *argv[] )
+{
+	int n, argPos;
+	int realsN = 100000;
+	int reps = 10;
+	int batchN = 200000;
+	int maxThreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+	int helpSet = 0;
+	char *only = NULL;
+
+	n = superGetOpt( argc, argv, &argPos,
+			"-only %s", &only, "run one benchmark: options, argv, varlists, reals, batch, parallel, lazy, commands or subcommands",
+			"-reals %d", &realsN, "number of values in the *%lf / *%f list",
+			"-batch %d", &batchN, "number of records for superParseBatch()",
+			"-threads %d", &maxThreads, "largest thread count for superParseBatch() and var lists",
+			"-reps %d", &reps, "repetitions of each measurement",
+			"-help", &helpSet, "to get this help message",
+			(char *) 0 );
+	if( n != 0 || helpSet )
+	{
+		superGetOpt( 0, NULL, &argPos, NULL );
+		return( n < 0 ? 1 : 0 );
+	}
+
+	srand( 1 );
+	printf("benchmark,variant,param,items,ns_total,ns_per_item,items_per_sec\n");
+
+#define RUN(name) (only == NULL || strcmp( only, name ) == 0)
+	if( RUN( "options" ) ) bench_options( reps );
+	if( RUN( "argv" ) ) bench_argv( reps );
+	if( RUN( "varlists" ) ) bench_varlists( reps );
+	if( RUN( "reals" ) ) bench_reals( realsN, reps );
+	if( RUN( "batch" ) ) bench_batch( batchN, maxThreads > 0 ? maxThreads : 1, reps );
+	if( RUN( "parallel" ) ) bench_parallel( maxThreads > 0 ? maxThreads : 1, reps );
+	if( RUN( "lazy" ) ) bench_lazy( reps );
+	if( RUN( "commands" ) ) bench_commands( reps );
+	if( RUN( "subcommands" ) ) bench_subcommands( reps );
+
+	return(0);
+}
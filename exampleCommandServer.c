@@ -0,0 +1,438 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Example: a command server on a UNIX socket, every client served from
+	one epoll loop. Each line a client sends is one command, parsed by
+	superParseCommand() against specs compiled once at startup, and gets
+	a one-line reply. With -clients N the program also runs N clients of
+	its own on a second thread, each sending -commands lines one at a
+	time, and reports the throughput. Linux only.
+
+	set -key K -value N	stores N under K
+	get -key K		replies with K's value
+	sum -n N ...		replies with the sum
+	quit			closes the connection
+
+	make exampleCommandServer && ./exampleCommandServer -clients 2000
+*/
+
+#define _GNU_SOURCE	// accept4()
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "supergetopt.h"
+
+#define BUF_SIZE 4096
+#define MAX_KEYS 1024
+#define MAX_VALUES 256
+
+enum { CMD_SET, CMD_GET, CMD_SUM, CMD_QUIT, NUM_CMDS };
+
+struct conn_s
+{
+	int fd;
+	int inLen;
+	int outLen;
+	int closing;
+	char in[BUF_SIZE];
+	char out[BUF_SIZE];
+};
+
+struct key_s
+{
+	char name[32];
+	int value;
+};
+
+// command outputs; the server parses on one thread only
+static char *key;
+static int value;
+static int values[MAX_VALUES];
+static int numValues = MAX_VALUES;
+
+static struct key_s keys[MAX_KEYS];
+static int numKeys;
+
+static SG_COMMANDS *cmds;
+static SG_CTX ctx;
+
+static const char *socketPath = "/tmp/sgcommands.sock";
+static int numClients = 0;
+static int numCommands = 100;
+static int stopPipe[2];
+
+static double now_s( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+static void reply( struct conn_s *conn, const char *fmt, ... )
+{
+	va_list ap;
+	int n;
+
+	va_start( ap, fmt );
+	n = vsnprintf( conn->out + conn->outLen, BUF_SIZE - conn->outLen, fmt, ap );
+	va_end( ap );
+
+	// a client that does not read its replies is dropped
+	if( n < 0 || conn->outLen + n >= BUF_SIZE ) conn->closing = 1;
+	else conn->outLen += n;
+}
+
+static struct key_s *find_key( const char *name, int create )
+{
+	int i;
+
+	for( i = 0 ; i < numKeys ; i++ )
+	{
+		if( strcmp( keys[i].name, name ) == 0 ) return( &keys[i] );
+	}
+	if( !create || numKeys == MAX_KEYS || strlen( name ) >= sizeof(keys[0].name) ) return( NULL );
+
+	strcpy( keys[numKeys].name, name );
+	return( &keys[numKeys++] );
+}
+
+static void run_command( struct conn_s *conn, char *line )
+{
+	struct key_s *k;
+	long long sum;
+	int n, c, lastArg, i;
+
+	key = NULL;
+	n = superParseCommand( cmds, &ctx, line, &c, &lastArg );
+	if( n < 0 )
+	{
+		reply( conn, "error %d\n", n );
+		return;
+	}
+
+	switch( c )
+	{
+		case -1:	// empty line
+			break;
+		case CMD_SET:
+			if( key == NULL || (k = find_key( key, 1 )) == NULL ) reply( conn, "error %d\n", SG_ERROR_MISSING_ARG );
+			else
+			{
+				k->value = value;
+				reply( conn, "ok\n" );
+			}
+			break;
+		case CMD_GET:
+			if( key == NULL || (k = find_key( key, 0 )) == NULL ) reply( conn, "none\n" );
+			else reply( conn, "%d\n", k->value );
+			break;
+		case CMD_SUM:
+			for( sum = 0, i = 0 ; i < numValues ; i++ ) sum += values[i];
+			reply( conn, "%lld\n", sum );
+			break;
+		case CMD_QUIT:
+			reply( conn, "bye\n" );
+			conn->closing = 1;
+			break;
+	}
+}
+
+/* writes what it can; EPOLLOUT is wanted while anything is left */
+static int flush_conn( int ep, struct conn_s *conn )
+{
+	struct epoll_event ev;
+	ssize_t n;
+	int pending = conn->outLen > 0;
+
+	while( conn->outLen > 0 )
+	{
+		n = write( conn->fd, conn->out, conn->outLen );
+		if( n < 0 && errno == EINTR ) continue;
+		if( n < 0 && errno == EAGAIN ) break;
+		if( n <= 0 ) return( -1 );
+
+		memmove( conn->out, conn->out + n, conn->outLen - n );
+		conn->outLen -= (int) n;
+	}
+
+	if( pending || conn->outLen > 0 )
+	{
+		ev.events = conn->outLen > 0 ? EPOLLIN | EPOLLOUT : EPOLLIN;
+		ev.data.ptr = conn;
+		epoll_ctl( ep, EPOLL_CTL_MOD, conn->fd, &ev );
+	}
+
+	return( conn->closing && conn->outLen == 0 ? -1 : 0 );
+}
+
+/* reads everything there is and runs each complete line */
+static int read_conn( struct conn_s *conn )
+{
+	char *line, *nl;
+	ssize_t n;
+
+	for( ;; )
+	{
+		n = read( conn->fd, conn->in + conn->inLen, BUF_SIZE - 1 - conn->inLen );
+		if( n < 0 && errno == EINTR ) continue;
+		if( n < 0 && errno == EAGAIN ) return(0);
+		if( n <= 0 ) return( -1 );
+
+		conn->inLen += (int) n;
+		conn->in[conn->inLen] = '\0';
+
+		for( line = conn->in ; !conn->closing && (nl = memchr( line, '\n', conn->in + conn->inLen - line )) != NULL ; line = nl + 1 )
+		{
+			*nl = '\0';
+			run_command( conn, line );
+		}
+		if( conn->closing ) return(0);
+
+		conn->inLen -= (int) (line - conn->in);
+		memmove( conn->in, line, conn->inLen );
+		if( conn->inLen == BUF_SIZE - 1 ) return( -1 );	// a line longer than the buffer
+	}
+}
+
+static void serve( int listenFd )
+{
+	struct epoll_event ev, events[256];
+	struct conn_s *conn;
+	int ep, n, i, fd;
+
+	ep = epoll_create1( 0 );
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl( ep, EPOLL_CTL_ADD, listenFd, &ev );
+	ev.data.ptr = &stopPipe;
+	epoll_ctl( ep, EPOLL_CTL_ADD, stopPipe[0], &ev );
+
+	for( ;; )
+	{
+		n = epoll_wait( ep, events, 256, -1 );
+		if( n < 0 && errno == EINTR ) continue;
+		if( n < 0 ) break;
+
+		for( i = 0 ; i < n ; i++ )
+		{
+			if( events[i].data.ptr == &stopPipe )
+			{
+				close( ep );
+				return;
+			}
+
+			if( events[i].data.ptr == NULL )
+			{
+				while( (fd = accept4( listenFd, NULL, NULL, SOCK_NONBLOCK )) >= 0 )
+				{
+					conn = (struct conn_s *) calloc( 1, sizeof(struct conn_s) );
+					if( conn == NULL )
+					{
+						close( fd );
+						continue;
+					}
+					conn->fd = fd;
+					ev.events = EPOLLIN;
+					ev.data.ptr = conn;
+					epoll_ctl( ep, EPOLL_CTL_ADD, fd, &ev );
+				}
+				continue;
+			}
+
+			conn = (struct conn_s *) events[i].data.ptr;
+			if( ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && read_conn( conn ) < 0) || flush_conn( ep, conn ) < 0 )
+			{
+				close( conn->fd );	// also takes it out of the epoll set
+				free( conn );
+			}
+		}
+	}
+
+	close( ep );
+}
+
+/* The -clients load: every client sends its next command as soon as the
+	reply to the previous one is in, so numClients commands are always in
+	flight. */
+static void *load( void *unused )
+{
+	struct epoll_event ev, events[256];
+	int *fds = (int *) malloc( numClients * sizeof(int) );
+	int *sent = (int *) calloc( numClients, sizeof(int) );
+	int *answered = (int *) calloc( numClients, sizeof(int) );
+	struct sockaddr_un addr;
+	char line[128], buf[BUF_SIZE];
+	long long done = 0, total = (long long) numClients * numCommands;
+	double t0, t;
+	int ep, i, k, n, c, open = 0;
+	ssize_t got;
+
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strncpy( addr.sun_path, socketPath, sizeof(addr.sun_path) - 1 );
+	ep = epoll_create1( 0 );
+
+	t0 = now_s();
+	for( i = 0 ; i < numClients ; i++ )
+	{
+		fds[i] = socket( AF_UNIX, SOCK_STREAM, 0 );
+		if( fds[i] < 0 || connect( fds[i], (struct sockaddr *) &addr, sizeof(addr) ) < 0 )
+		{
+			perror( "client" );
+			exit(1);
+		}
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		epoll_ctl( ep, EPOLL_CTL_ADD, fds[i], &ev );
+		open++;
+
+		n = sprintf( line, "set -key k%d -value %d\n", i, i );
+		sent[i] = 1;
+		if( write( fds[i], line, n ) != n ) exit(1);
+	}
+
+	while( open > 0 )
+	{
+		n = epoll_wait( ep, events, 256, -1 );
+		for( k = 0 ; k < n ; k++ )
+		{
+			i = (int) events[k].data.u32;
+			got = read( fds[i], buf, sizeof(buf) );
+			if( got <= 0 )
+			{
+				perror( "client read" );
+				exit(1);
+			}
+
+			for( c = 0 ; c < got ; c++ ) answered[i] += buf[c] == '\n';
+			if( answered[i] < sent[i] ) continue;	// the rest of the reply is on its way
+			if( sent[i] == numCommands )
+			{
+				close( fds[i] );
+				open--;
+				continue;
+			}
+
+			switch( sent[i]++ % 3 )
+			{
+				case 0: c = sprintf( line, "get -key k%d\n", i ); break;
+				case 1: c = sprintf( line, "sum -n %d 1 2 3 4 5 6 7\n", i ); break;
+				default: c = sprintf( line, "set -key k%d -value %d\n", i, sent[i] ); break;
+			}
+			if( write( fds[i], line, c ) != c ) exit(1);
+		}
+	}
+	t = now_s() - t0;
+	for( i = 0 ; i < numClients ; i++ ) done += answered[i];
+
+	printf("%d clients, %lld of %lld commands answered in %.3f s: %.0f commands/s\n", numClients, done, total, t, done / t);
+	close( ep );
+	free( fds );
+	free( sent );
+	free( answered );
+	if( write( stopPipe[1], "x", 1 ) != 1 ) exit(1);
+
+	return( NULL );
+}
+
+int main( int argc, char *argv[] )
+{
+	static const char *names[NUM_CMDS] = { "set", "get", "sum", "quit" };
+	SG_SPEC *specs[NUM_CMDS];
+	struct sockaddr_un addr;
+	struct rlimit rl;
+	pthread_t loader;
+	char *path = NULL;
+	int n, argPos, help = 0, fd, i;
+
+	n = superGetOpt( argc, argv, &argPos,
+			"-socket %s", &path, "socket to listen on (default /tmp/sgcommands.sock)",
+			"-clients %d", &numClients, "run this many clients of our own, then exit",
+			"-commands %d", &numCommands, "commands each of those clients sends",
+			"-help", &help, "to get this help message",
+			(char *) 0 );
+	if( n != 0 || help )
+	{
+		superGetOpt( 0, NULL, &argPos, NULL );
+		return( n < 0 ? 1 : 0 );
+	}
+	if( path != NULL ) socketPath = path;
+
+	n = superCompileOpt( &specs[CMD_SET], &argPos, "-key %s", &key, "key to set", "-value %d", &value, "its value", (char *) 0 );
+	if( n == 0 ) n = superCompileOpt( &specs[CMD_GET], &argPos, "-key %s", &key, "key to read", (char *) 0 );
+	if( n == 0 ) n = superCompileOpt( &specs[CMD_SUM], &argPos, "-n *%d", values, &numValues, "numbers to add", (char *) 0 );
+	if( n == 0 ) n = superCompileOpt( &specs[CMD_QUIT], &argPos, (char *) 0 );
+	if( n == 0 ) n = superCompileCommands( &cmds, names, specs, NUM_CMDS );
+	if( n != 0 )
+	{
+		fprintf(stderr, "cannot compile the commands: %d\n", n);
+		return(1);
+	}
+	superInitCtx( &ctx, NULL, NULL, NULL, 0 );
+
+	// two descriptors per client of our own
+	if( getrlimit( RLIMIT_NOFILE, &rl ) == 0 && rl.rlim_cur < rl.rlim_max )
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit( RLIMIT_NOFILE, &rl );
+	}
+
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strncpy( addr.sun_path, socketPath, sizeof(addr.sun_path) - 1 );
+	unlink( socketPath );
+
+	fd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+	if( fd < 0 || bind( fd, (struct sockaddr *) &addr, sizeof(addr) ) < 0 || listen( fd, SOMAXCONN ) < 0 || pipe( stopPipe ) < 0 )
+	{
+		perror( socketPath );
+		return(1);
+	}
+	printf("listening on %s\n", socketPath);
+	fflush( stdout );
+
+	if( numClients > 0 && pthread_create( &loader, NULL, load, NULL ) != 0 ) return(1);
+	serve( fd );
+	if( numClients > 0 ) pthread_join( loader, NULL );
+
+	close( fd );
+	unlink( socketPath );
+	superFreeCommands( cmds );
+	for( i = 0 ; i < NUM_CMDS ; i++ ) superFreeOpt( specs[i] );
+
+	return(0);
+}
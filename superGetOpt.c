@@ -39,27 +39,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
-#include "supergetopt.h"
+#include <stdint.h>
+#include <time.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
 
 #define DEBUG 0
 
-#define MAXARGS 10		/* no called function can have more than this number of args */
-#define MAXOPTS 50		/* only this many options total to superGetOpt() */
-#define MAXSTRING 120	/* max of any string passed through */
-
 enum 
 {
-	CHAR,
-	SHORT,
-	INT,
-	FLOAT,
-	DOUBLE,
-	STRING,
-	NUMTYPES
+	CHAR = SG_TYPE_CHAR,
+	SHORT = SG_TYPE_SHORT,
+	INT = SG_TYPE_INT,
+	FLOAT = SG_TYPE_FLOAT,
+	DOUBLE = SG_TYPE_DOUBLE,
+	STRING = SG_TYPE_STRING
 };
 
-const char typeNames[NUMTYPES][10] = { "char", "short", "int", "float", "double", "string" };
-
+// room for one value of any SG_TYPE_*
 typedef union
 {
 	char c;
@@ -68,42 +65,58 @@ typedef union
 	float f;
 	double d;
 	char *string;
+	long long ll;
+	unsigned long long ull;
 } ANYTYPE;
 
-typedef union
-{
-	char *c;
-	short *h;
-	int *i;
-	float *f;
-	double *d;
-	char **string;
-} PANYTYPE;
-
-struct optionlist_s 
+struct sg_table_s
 {
-	char name[MAXSTRING];
-	int numargs;
-	int varflag;
-	int argtype[MAXARGS];
-	PANYTYPE argptr[MAXARGS];
-	ANYTYPE argval[MAXARGS];
-	int *pNumArgs;
-	int numArgsMax;
-	char *helpString;
+	const SG_OPTION *options;
+	int numOptions;
 };
 
+#if defined(_MSC_VER)
+#define SG_THREAD_LOCAL __declspec(thread)
+#else
+#define SG_THREAD_LOCAL __thread
+#endif
+
+// last table handed to superGetOpt()/superParseOpt() on this thread, for the usage re-call
+static SG_THREAD_LOCAL SG_SPEC *lastSpec = NULL;
 
-static int superParseInternal( int argc, char **argv, int usageCall,  int *lastArg, int *pUnAccountedFor, va_list ap );
-static ANYTYPE getval(char *s, int type, int *flag);
-static char myread_char(char *s, int *flag);
-static short myread_short(char *s, int *flag);
-static int myread_int(char *s, int *flag);
-static float myread_float(char *s, int *flag);
-static double myread_double(char *s, int *flag);
-static int parse_string(char *s, struct optionlist_s *option, int *noName);
-static int check_if_option(char *s, struct optionlist_s *optionlist, int numopts);
-static int parse_format(char *s, int *argtypes);
+// arena for "+" formats parsed without one of the caller's
+static SG_THREAD_LOCAL SG_ARENA *threadArena = NULL;
+
+// statistics of the parses without a caller's context, see superGetStats()
+static SG_THREAD_LOCAL SG_STATS threadStats;
+
+static int superLegacyInternal( int argc, char **argv, int usageCall, int *lastArg, int *pUnAccountedFor, va_list ap );
+static int superParseInternal( SG_CTX *ctx, int argc, char **argv, int usageCall, int *lastArg );
+static int parse_tokens( SG_CTX *ctx, int usageCall, int *lastArg );
+static int match_tokens( SG_CTX *ctx, int usageCall, int *lastArg );
+static void *dest_ptr( const SG_CTX *ctx, void *p );
+static int append_value( const SG_CTX *ctx, const struct optionlist_s *option, const ANYTYPE *argval );
+static int list_value( SG_CTX *ctx, int type, void *out );
+static int stream_list( SG_CTX *ctx, const struct optionlist_s *option );
+static int parallel_list( SG_CTX *ctx, const struct optionlist_s *option, char *out, int done );
+static int lazy_args( SG_CTX *ctx, int option );
+static void next_token( SG_CTX *ctx );
+static int count_formats( va_list ap, int *lastArg, int *pOptnum, int *pArgslots, size_t *pNamebytes );
+static SG_SPEC *alloc_spec( int optnum, int argslots, size_t namebytes, unsigned int numSlots );
+static int fill_spec( SG_SPEC *spec, va_list ap, int *lastArg );
+static int fill_table( SG_SPEC *spec, const SG_OPTION *options, int numOptions );
+static int compile_spec( SG_SPEC **pSpec, int optnum, int argslots, size_t namebytes, int (*fill)( SG_SPEC *spec, void *src, int *lastArg ), void *src, int *lastArg );
+static int fill_from_va( SG_SPEC *spec, void *src, int *lastArg );
+static int fill_from_table( SG_SPEC *spec, void *src, int *lastArg );
+static int count_table( const SG_OPTION *options, int numOptions, int *lastArg, int *pArgslots, size_t *pNamebytes );
+static int parse_string( const char *s, int *pNameLen, int *pVarflag, int *pManaged, int *pStream, int *argtypes );
+static int parse_format( const char *s, int *argtypes );
+static int build_hash( SG_SPEC *spec );
+static int build_trie( SG_SPEC *spec );
+static int lookup_name( const SG_SPEC *spec, const char *s, SG_STATS *stats );
+static int check_if_option( const SG_SPEC *spec, const char *s, SG_STATS *stats );
+static int may_be_option( const SG_SPEC *spec, const char *s, SG_STATS *stats );
+static void expand_response( SG_CTX *ctx );
 
 int superGetOpt( int argc, char **argv, int *lastArg, ... )
 {
@@ -120,7 +133,7 @@ int superGetOpt( int argc, char **argv, int *lastArg, ... )
 
 	va_start( ap, lastArg );
 
-	n = superParseInternal( argc, argv, usageCall, lastArg, &unAccountedFor, ap );
+	n = superLegacyInternal( argc, argv, usageCall, lastArg, &unAccountedFor, ap );
 	
 	va_end( ap );
 #if DEBUG
@@ -146,7 +159,7 @@ int superParseOpt( int argc, char **argv, int *lastArg, ... )
 	
 	va_start( ap, lastArg );
 
-	n = superParseInternal( argc, argv, usageCall,lastArg, &unAccountedFor, ap );
+	n = superLegacyInternal( argc, argv, usageCall,lastArg, &unAccountedFor, ap );
 	
 	va_end( ap );
 	
@@ -159,711 +172,1864 @@ int superParseOpt( int argc, char **argv, int *lastArg, ... )
 	return(n);
 }
 
-static int superParseInternal( int argc, char **argv, int usageCall, int *lastArg, int *pUnAccountedFor, va_list ap )
+int superCompileOpt( SG_SPEC **pSpec, int *lastArg, ... )
 {
-	char *optstring[MAXOPTS+1];
-	static int optnum;
-	int argsleft;
-	register int i,j;
-	int x;
-	int good;
-	int found = 0;
-	int noName;
-	static struct optionlist_s optionlist[MAXOPTS+1]; //static allows easy re-call for usage printout
-	int return_val;
-	int lastArgProcessed = argc;
-	int lastArgProcessedSuccessfully = 1;
-	int lastFlag = 0;
-	
-	*pUnAccountedFor = 0; // args not associated with detected flags
-	
+	va_list ap;
+	int n;
+
+	va_start( ap, lastArg );
+
+	n = superCompileOptV( pSpec, lastArg, ap );
+
+	va_end( ap );
+
+	return(n);
+}
+
+int superCompileOptV( SG_SPEC **pSpec, int *lastArg, va_list ap )
+{
+	va_list aq;
+	int optnum, argslots, n;
+	size_t namebytes;
+
+	*pSpec = NULL;
 	*lastArg = 0;
-	
-	// To do: return correct value (error or last arg processed) in all cases
-	//printf("Orig optnum = %d usageCall=%d\n", optnum,usageCall);
-	return_val = 0;
-	
-	//optnum = 0;
 
-	if( argv == NULL ) argc = 0;
+	// first pass sizes the arena, second pass fills it
+	va_copy( aq, ap );
+	n = count_formats( aq, lastArg, &optnum, &argslots, &namebytes );
+	va_end( aq );
+	if( n < 0 ) return( n );
 
-	if( argc != 0 ) optnum = 0;
+	va_copy( aq, ap );
+	n = compile_spec( pSpec, optnum, argslots, namebytes, fill_from_va, &aq, lastArg );
+	va_end( aq );
 
-	// parse all passed-in option formats
-	while( /*usageCall == 0 &&*/ (optstring[optnum] = (char *) va_arg(ap, char *)) != (char *) NULL )
-	{ 
-		optionlist[optnum].numargs = parse_string(optstring[optnum],&optionlist[optnum], &noName);
-		
-		//printf("Num args to option = %d for <%s>\n",optionlist[optnum].numargs,optstring[optnum]);
-		for( i = 0 ; i < optionlist[optnum].numargs ; i++ )
-		{
-			//printf("Looping through numargs=%d at iter=%d var=%d\n", optionlist[optnum].numargs, i, optionlist[optnum].varflag);
-			if( optionlist[optnum].varflag != 1 )
-			{
-				// this only works for fixed arg formats
-				switch( optionlist[optnum].argtype[i] )
-				{
-				case CHAR: 
-					optionlist[optnum].argptr[i].c = va_arg(ap, char *);
-					//printf("Char: type=%d ret=%d val=0x%x\n",optionlist[optnum].argtype[i],good,optionlist[optnum].argptr[i].c);
-					break;
-				case SHORT: 
-					optionlist[optnum].argptr[i].h = va_arg(ap, short *);
-					break;
-				case INT: 
-					optionlist[optnum].argptr[i].i = va_arg(ap, int *);
-					break;
-				case FLOAT: 
-					optionlist[optnum].argptr[i].f = va_arg(ap, float *);
-					break;
-				case DOUBLE: 
-					optionlist[optnum].argptr[i].d = va_arg(ap, double *);
-					break;
-				case STRING: 
-					optionlist[optnum].argptr[i].string = va_arg(ap, char **);
-					break;
-				}
-			}
-			else
-			{
-				// for vararg formats, just get pointer to array and pointer to numArgs.
-				switch( optionlist[optnum].argtype[i] )
-				{
-				case CHAR: 
-					optionlist[optnum].argptr[i].c = va_arg(ap, char *);
-					if( optionlist[optnum].argptr[i].c == NULL ) return( SG_ERROR_MISSING_ARG );
-					//printf("Char: type=%d ret=%d val=0x%x pc=0x%x\n",optionlist[optnum].argtype[i],good,optionlist[optnum].argptr[i].c,pC);
-					break;
-				case SHORT: 
-					optionlist[optnum].argptr[i].h = va_arg(ap, short *);
-					if( optionlist[optnum].argptr[i].h == NULL ) return( SG_ERROR_MISSING_ARG );
-					break;
-				case INT: 
-					optionlist[optnum].argptr[i].i = va_arg(ap, int *);
-					if( optionlist[optnum].argptr[i].i == NULL ) return( SG_ERROR_MISSING_ARG );
-					break;
-				case FLOAT: 
-					optionlist[optnum].argptr[i].f = va_arg(ap, float *);
-					//printf("App passed in 0x%x pointer to float array (%d,%d)\n", optionlist[optnum].argptr[i].f,optnum,i);
-					if( optionlist[optnum].argptr[i].f == NULL ) return( SG_ERROR_MISSING_ARG );
-					break;
-				case DOUBLE: 
-					optionlist[optnum].argptr[i].d = va_arg(ap, double *);
-					if( optionlist[optnum].argptr[i].d == NULL ) return( SG_ERROR_MISSING_ARG );
-					break;
-				case STRING: 
-					optionlist[optnum].argptr[i].string = va_arg(ap, char **);
-					if( optionlist[optnum].argptr[i].string == NULL ) return( SG_ERROR_MISSING_ARG );
-					break;
-				}
+	return( n );
+}
 
-				// now pop pointer to numArgs
-				optionlist[optnum].pNumArgs = va_arg(ap, int *);
-				optionlist[optnum].numArgsMax = *optionlist[optnum].pNumArgs;
-				//printf("Varargs pNumArgs=0x%x %d\n", optionlist[optnum].pNumArgs, *optionlist[optnum].pNumArgs);
-				if( optionlist[optnum].pNumArgs == NULL )
-				{
-					return( SG_ERROR_MISSING_ARG );
-				}
-				else
-				{
-					*optionlist[optnum].pNumArgs = 0; // initialize
-				}
-			}
-		}
-		
-		// flagless arg (like -help)
-		if(optionlist[optnum].numargs == 0 /*&& usageCall == 0*/)
-		{
-			// need to pop off the 
-			//printf("flagless arg <%s>\n", optstring[optnum]);
-			optionlist[optnum].argptr[0].i = va_arg(ap, int *);
-			*optionlist[optnum].argptr[0].i = 0; // init
-		}
+int superCompileTable( SG_SPEC **pSpec, const SG_OPTION *options, int numOptions, int *lastArg )
+{
+	struct sg_table_s table;
+	int argslots, n;
+	size_t namebytes;
 
-#if SG_ENABLE_HELPSTRING
-		// get help string
-		optionlist[optnum].helpString = va_arg(ap, char *);
-#endif
-		optnum++;
-		//printf("optnum = %d\n", optnum);
-		if( optnum > MAXOPTS )
-		{
-#if DEBUG
-			fprintf(stderr, "Too many options in string. More than %d\n",MAXOPTS);
+	*pSpec = NULL;
+	*lastArg = 0;
+
+	n = count_table( options, numOptions, lastArg, &argslots, &namebytes );
+	if( n < 0 ) return( n );
+
+	table.options = options;
+	table.numOptions = numOptions;
+
+	return( compile_spec( pSpec, numOptions, argslots, namebytes, fill_from_table, &table, lastArg ) );
+}
+
+/* Allocates a spec, fills it and builds its hash. fill() runs again
+	whenever no perfect hash exists at the current table size. */
+static int compile_spec( SG_SPEC **pSpec, int optnum, int argslots, size_t namebytes, int (*fill)( SG_SPEC *spec, void *src, int *lastArg ), void *src, int *lastArg )
+{
+	SG_SPEC *spec;
+	unsigned int numSlots;
+	int n;
+#if SG_ENABLE_STATS > 1
+	unsigned long long t0 = sg_now_ns();
 #endif
-			lastArg = (int *) va_arg(ap, int *);
-			*lastArg = optnum;
-			return( SG_ERROR_TOO_MANY_OPTIONS );
-		}
-	}
 
+	for( numSlots = 4 ; numSlots < (unsigned int) 2*optnum ; numSlots <<= 1 );
 
-	// user can tell us to print usage by calling with NULL or argc = 0 or both
-    if( argv == NULL || argc == 0 /*|| usageCall == 1*/ )
+	for( ;; )
 	{
-		argc = 0; // prevent any parsing and just print out 
-		if( optnum > 0 ) fprintf(stderr, "***** Usage *****\n");
-		// print out usage!!!
-		//printf("Help optNum = %d\n", optnum);
-		for( i = 0 ; i < optnum ; i++ )
+		spec = alloc_spec( optnum, argslots, namebytes, numSlots );
+		if( spec == NULL ) return( SG_ERROR_NO_MEMORY );
+
+		n = fill( spec, src, lastArg );
+		if( n < 0 )
 		{
-			int t;
-			printf("\t %s", optionlist[i].name);
-			for( t = 0 ; t < optionlist[i].numargs ; t++ )
-			{
-				if( optionlist[i].varflag == 0 )
-				{
-				    printf( " %s", typeNames[optionlist[i].argtype[t]]);
-				}
-				else
-				{
-				    printf( " %s [%s, ...]", typeNames[optionlist[i].argtype[t]], typeNames[optionlist[i].argtype[t]]);
-				}
-			}
-#if SG_ENABLE_HELPSTRING
-			if( optionlist[i].helpString != NULL )
-			{
-				printf(" <%s>", optionlist[i].helpString);
-			}
-#endif
-			if( optnum > 0 ) printf("\n");
+			superFreeOpt( spec );
+			return( n );
 		}
-		
-		return(0);
+
+		n = build_hash( spec );
+		if( n == 0 ) n = build_trie( spec );
+		if( n == 0 ) break;
+
+		superFreeOpt( spec );
+		if( n == SG_ERROR_NO_MEMORY ) return( n );
+		numSlots <<= 1; // no perfect hash at this load; retry with a sparser table
 	}
-	
-	argsleft = argc;
-			
-	//printf("Have argsleft=%d\n", argsleft);
 
-	// now process cmdline argument list
-	while( argsleft > 0 && usageCall == 0 )
-	{
+	n = superLookupOpt( spec, "@" );
+	if( n >= 0 && spec->optionlist[n].numargs == 0 ) spec->responseOpt = n + 1;
+
+#if SG_ENABLE_STATS > 1
+	spec->setupNs = sg_now_ns() - t0;
+	threadStats.setupNs += spec->setupNs;
+#endif
+	SG_STAT( threadStats.formatsCompiled += spec->optnum );
+
+	*pSpec = spec;
+
+	return(0);
+}
+
+static int fill_from_va( SG_SPEC *spec, void *src, int *lastArg )
+{
+	va_list aq;
+	int n;
+
+	va_copy( aq, *(va_list *) src );
+	n = fill_spec( spec, aq, lastArg );
+	va_end( aq );
+
+	return( n );
+}
 
-	for( i = 0, lastFlag = 0 ; i < optnum && argsleft > 0 ; i++ )
+static int fill_from_table( SG_SPEC *spec, void *src, int *lastArg )
+{
+	const struct sg_table_s *table = (const struct sg_table_s *) src;
+
+	(void) lastArg;	// count_table() has already checked every option
+
+	return( fill_table( spec, table->options, table->numOptions ) );
+}
+
+void superFreeOpt( SG_SPEC *spec )
+{
+	if( spec == NULL ) return;
+
+	sg_free_usage( spec );
+	sg_free_env( spec );
+	free( spec );
+}
+
+/* Walks the triplets once without storing anything, counting what the
+	arena needs: options, argument slots and name bytes. */
+static int count_formats( va_list ap, int *lastArg, int *pOptnum, int *pArgslots, size_t *pNamebytes )
+{
+	char *optstring;
+	int numargs, namelen, varflag, managed, stream;
+	int i;
+
+	*pOptnum = 0;
+	*pArgslots = 0;
+	*pNamebytes = 0;
+
+	while( (optstring = (char *) va_arg(ap, char *)) != (char *) NULL )
 	{
-		//printf("Looking for option %d <%s>: argv=<%s> argsleft=%d\n", i, optionlist[i].name,argv[0],argsleft);
-		found = 0;
-		if( strcmp( argv[0], optionlist[i].name ) == 0 )
+		numargs = parse_string( optstring, &namelen, &varflag, &managed, &stream, NULL );
+		if( numargs < 0 )
 		{
-			lastFlag = i;
-			
-			found = 1;
-			argsleft--;	
-			lastArgProcessedSuccessfully++;		
-			if( argsleft > 0 ) argv++;
-			//printf("Found option <%s>\n", optionlist[i].name);
-			
-			if( optionlist[i].numargs == 0 )
-			{
-				// handle flagless arg like -help
-				*optionlist[i].argptr[0].i = 1;
-			}
-			
-			for( j = 0 ; (j < optionlist[i].numargs && optionlist[i].varflag != 1 && argsleft > 0 ) || (optionlist[i].varflag == 1 && argsleft > 0) ; j++, argsleft--, argv++ )
-			{
-				if( optionlist[i].varflag != 1 )
-				{
-					optionlist[i].argval[j] = getval(argv[0], optionlist[i].argtype[j], &good);
-					switch( optionlist[i].argtype[j] )
-					{
-						case CHAR: 
-							*optionlist[i].argptr[j].c = optionlist[i].argval[j].c;
-							//printf("got char: %c\n",optionlist[i].argval[j].c);
-							break;
-						case SHORT: 
-							*optionlist[i].argptr[j].h = optionlist[i].argval[j].h;
-							break;
-						case INT: 
-							*optionlist[i].argptr[j].i = optionlist[i].argval[j].i;
-							break;
-						case FLOAT: 
-							*optionlist[i].argptr[j].f = optionlist[i].argval[j].f;
-							break;
-						case DOUBLE: 
-							*optionlist[i].argptr[j].d = optionlist[i].argval[j].d;
-							break;
-						case STRING: 
-							//printf("For string, argval=0x%x argv=0x%x\n", optionlist[i].argval[j].string,argv[0]);
-							*optionlist[i].argptr[j].string = optionlist[i].argval[j].string;
-/* 							if( check_if_option(argv[0], optionlist, optnum) >= 0 && optionlist[i].varflag == 1 ) */
-/* 								good = -1; */
-							break;
-						default: 
-#if DEBUG
-							fprintf(stderr, "Bad argtype %d\n",optionlist[i].argtype[j]); 
-#endif
-							//*lastArg = lastArgProcessed;
-							*lastArg = lastArgProcessedSuccessfully;
-							return( SG_ERROR_BAD_ARGTYPE );
-					}
-					
-					if( good == 0 )
-					{
-						lastArgProcessed = argc - argsleft + 1;
-						lastArgProcessedSuccessfully++;		
-						//printf("good read: lastArg=%d\n",lastArgProcessed);
-					}
-					else if( good == -1 )
-					{
-						x = check_if_option(argv[0], optionlist, optnum);
-						if( x < 0 )
-						{
-#if DEBUG
-							fprintf(stderr,"User did not supply correct arguments to option name <%s>\n",optionlist[i].name);
-#endif
-							//*lastArg = lastArgProcessed;
-							*lastArg = lastArgProcessedSuccessfully;
-							return(SG_ERROR_INCORRECT_ARG);
-						}
-						else 
-						{
-#if DEBUG
-							fprintf(stderr,"User did not supply enough arguments to option name <%s>\n",optionlist[i].name);
-#endif
-							//*lastArg = lastArgProcessed;
-							*lastArg = lastArgProcessedSuccessfully;
-							return( SG_ERROR_MISSING_ARG );
-						}
-					}
-				}
-				else		/* var arg list */
-				{
-					//optionlist[i].argtype[j] = optionlist[i].argtype[0];
-					switch( optionlist[i].argtype[0] )
-					{
-						case CHAR: 
-							optionlist[i].argptr[0].c[j] = myread_char(argv[0],&good); 
-							break;
-						case SHORT: 
-							optionlist[i].argptr[0].h[j] = myread_short(argv[0],&good); 
-							break;
-						case INT: 
-							optionlist[i].argptr[0].i[j] = myread_int(argv[0],&good); 
-							break;
-						case FLOAT:
-							optionlist[i].argptr[0].f[j] = myread_float(argv[0],&good); 
-							break;
-						case DOUBLE: 
-							optionlist[i].argptr[0].d[j] = myread_double(argv[0],&good); 
-							break;
-						case STRING: 
-							x = check_if_option(argv[0], optionlist, optnum);
- 							if( x >= 0 ) /* end of var list */
-							{
-								good = -2;
-							}
-							else
-							{	
-								good = 0;
-								if( j < optionlist[i].numArgsMax )
-								{
-									optionlist[i].argptr[0].string[j] = argv[0]; 
-								}
-								else
-								{
-									good = -3;
-								}
-							} 
-								break;
-						default: 
-#if DEBUG
-							fprintf(stderr, "Bad varargtype %d\n",optionlist[i].argtype[j]); 
-#endif
-							//*lastArg = lastArgProcessed;
-							*lastArg = lastArgProcessedSuccessfully;
-							return( SG_ERROR_BAD_VARARGTYPE );
-					}
-					
-					if( good == 0 ) // good read
-					{
-						*optionlist[i].pNumArgs = j+1;
-						lastArgProcessed = argc - argsleft + 1;
-						lastArgProcessedSuccessfully++;		
-						//printf("2 good read: lastArg=%d\n",lastArgProcessed);
-					}
-					
-					if( good == -1 )	/* bad data type */
-					{
-						x = check_if_option(argv[0], optionlist, optnum);
-						if( x < 0 )
-						{
-#if DEBUG
-							fprintf(stderr, "Var arg list bad data type for option <%s>\n",optionlist[i].name);
-#endif
-							//*lastArg = lastArgProcessed;
-							*lastArg = lastArgProcessedSuccessfully;
-							return( SG_ERROR_INCORRECT_ARG );
-						}
-						else	/* next option detected -- end of var list -- move 1 arg back */
-						{
-							optionlist[i].numargs = j;
-							break;		/* get out of numargs loop and call function */
-						}
-					}
-					else if( good == -2 )	/* detected end of var list -- move 1 arg back */
-					{
-						/* Var arg string list terminates at next option */
-						optionlist[i].numargs = j;
-						break;		/* get out of numargs loop and call function */
-					}
-					else if( good == -3 ) // too many args
-					{
-#if DEBUG
-						fprintf(stderr, "Warning: too many commandline args supplied for option <%s>. Max=%d\n",optionlist[i].name,optionlist[i].numArgsMax);
-#endif
-					}
-					else if( argsleft == 1 )	/* end of command line ends var arg list */
-					{
-						optionlist[i].numargs = j+1;
-					}
-				}
-			}
+			*lastArg = *pOptnum + 1;
+			return( numargs );
+		}
 
-			if( j != optionlist[i].numargs && optionlist[i].varflag != 1 )
-			{
-#if DEBUG
-				fprintf(stderr,"User did not supply enough arguments to option name <%s> Expected %d Got %d\n",optionlist[i].name,optionlist[i].numargs,j);
-#endif
-				//*lastArg = lastArgProcessed;
-				*lastArg = lastArgProcessedSuccessfully;
-				return( SG_ERROR_MISSING_ARG );
-			}
-			i = -1;  /* experimental bug fix? */
+		if( stream )
+		{
+			(void) va_arg(ap, SG_STREAM_FN);
+			(void) va_arg(ap, void *);
 		}
 		else
 		{
-			found = 0;
-			//printf("last successful arg = %d\n",lastArgProcessedSuccessfully);
+			for( i = 0 ; i < numargs ; i++ ) (void) va_arg(ap, char *);
+			if( (varflag == 1 || managed) && numargs > 0 ) (void) va_arg(ap, int *);
 		}
-	}
-
-	if( found == 0 )
-	{
-#if DEBUG
-		fprintf(stderr,"option not found at argv=%s left=%d lastProc=%d latProcSuc=%d\n",argv[0],argsleft,lastArgProcessed,lastArgProcessedSuccessfully);
-		//fprintf(stderr,"User did not supply option name <%s>\n",optionlist[lastFlag].name);
+		if( numargs == 0 ) (void) va_arg(ap, int *);
+#if SG_ENABLE_HELPSTRING
+		(void) va_arg(ap, char *);
 #endif
-		//*lastArg = lastArgProcessed+1;
-		*lastArg = lastArgProcessedSuccessfully;
-		//return( SG_ERROR_TOO_MANY_ARGS );
-		(*pUnAccountedFor)++;
-		if( argsleft > 0 ) argv++;
-		argsleft--;
-	}
-	
+		(*pOptnum)++;
+		*pArgslots += numargs > 0 ? numargs : 1;
+		*pNamebytes += namelen + 1;
 	}
 
-	//*lastArg = lastArgProcessedSuccessfully;
-	//return_val = lastArgProcessed;
-	
-	return( return_val );
+	return(0);
 }
 
-
-static int parse_string(char *s, struct optionlist_s *option, int *noName)
+/* The whole spec lives in one allocation: header, option table, argument
+	pointers, hash tables, trie, argument types and finally the names. The
+	trie has at most one node per name byte plus the root. */
+static SG_SPEC *alloc_spec( int optnum, int argslots, size_t namebytes, unsigned int numSlots )
 {
-    size_t len;
-	int z;
-	int offset = 0;
-	char *pN, *pM;
+	SG_SPEC *spec;
+	unsigned int numBuckets;
+	size_t trieNodes = SG_ENABLE_PREFIX ? namebytes + 1 : 0;
+	size_t size;
+	char *p;
 
-	//printf("Called parse_string: s = <%s>\n", s);
-	
-	len = strlen( s );
+	for( numBuckets = 1 ; numBuckets < (unsigned int) (optnum+1)/2 ; numBuckets <<= 1 );
 
-	if( len <= 0 )
-		return(0);
+	size = sizeof(SG_SPEC)
+		+ optnum * sizeof(struct optionlist_s)
+		+ argslots * sizeof(PANYTYPE)
+		+ numSlots * sizeof(struct sg_hashslot_s)
+		+ numBuckets * sizeof(unsigned int)
+		+ trieNodes * sizeof(struct sg_trienode_s)
+		+ optnum * sizeof(int)
+		+ argslots * sizeof(int)
+		+ namebytes;
 
-	if( len < 2 )
-	{
-#if DEBUG
-		fprintf(stderr, "Parse_string: option has zero length <%s> len=%d\n", s, (int) len);
-#endif
-		return(SG_ERROR_ZERO_LEN_OPTION);
-	}
+	spec = (SG_SPEC *) malloc( size );
+	if( spec == NULL ) return( NULL );
+	memset( spec, 0, sizeof(SG_SPEC) );
 
-	pN = strstr( s, "%" );	/* explicit list implied */
-	pM = strstr( s, "*" );	/* variable argument list implied */
+	p = (char *) (spec + 1);
+	spec->optionlist = (struct optionlist_s *) p;	p += optnum * sizeof(struct optionlist_s);
+	spec->argptrs = (PANYTYPE *) p;				p += argslots * sizeof(PANYTYPE);
+	spec->slots = (struct sg_hashslot_s *) p;		p += numSlots * sizeof(struct sg_hashslot_s);
+	spec->disp = (unsigned int *) p;				p += numBuckets * sizeof(unsigned int);
+	spec->trie = (struct sg_trienode_s *) p;		p += trieNodes * sizeof(struct sg_trienode_s);
+	spec->byName = (int *) p;					p += optnum * sizeof(int);
+	spec->argtypes = (int *) p;					p += argslots * sizeof(int);
+	spec->names = p;
 
-	if( pM != NULL )		/* vararg list implied */
-	{
-		option->varflag = 1;
-		offset = 1;
-		//printf("var found\n");
-	}
-	else if( pN != NULL )	/* explicit list implied */
-	{
-		option->varflag = 0;
-		offset = 0;
-	}
-	else
-	{
-	}
-	
-	if( pN != NULL )
+	spec->bucketMask = numBuckets - 1;
+	spec->slotMask = numSlots - 1;
+
+	return( spec );
+}
+
+static int fill_spec( SG_SPEC *spec, va_list ap, int *lastArg )
+{
+	struct optionlist_s *option;
+	char *optstring;
+	char *name = spec->names;
+	int nextslot = 0;
+	int i, stream;
+
+	while( (optstring = (char *) va_arg(ap, char *)) != (char *) NULL )
 	{
-		strncpy(option->name, s, pN-s);
-		option->name[strlen(s)-strlen(pN)-1-offset] = '\0';
+		option = &spec->optionlist[spec->optnum];
+		option->argtype = &spec->argtypes[nextslot];
+		option->argptr = &spec->argptrs[nextslot];
+		option->numargs = parse_string( optstring, &option->namelen, &option->varflag, &option->managed, &stream, option->argtype );
+		option->pNumArgs = NULL;
+		option->numArgsMax = 0;
+		option->helpString = NULL;
+		option->stream = NULL;
+		nextslot += option->numargs > 0 ? option->numargs : 1;
 
-		if( pN == s )		/* no name ==> wildcard */
-			*noName = 1;
-		else
-			*noName = 0;
+		memcpy( name, optstring, option->namelen );
+		name[option->namelen] = '\0';
+		option->name = name;
+		name += option->namelen + 1;
 
-		if( pN-s >= len - 1 )
+		if( stream )
 		{
-#if DEBUG
-			fprintf(stderr, "Parse_String: No formats given in <%s>\n",s /* was scopy */);
-#endif
-			return(SG_ERROR_NO_FORMATS);
+			// the callback, then its data, which may be NULL
+			option->stream = va_arg(ap, SG_STREAM_FN);
+			option->argptr[0].c = (char *) va_arg(ap, void *);
+			if( option->stream == NULL )
+			{
+				*lastArg = spec->optnum + 1;
+				return( SG_ERROR_MISSING_ARG );
+			}
 		}
-		else
+		else if( option->managed )
 		{
-			if( option->varflag == 0 )
+			// the address of the caller's array pointer, then of its count
+			option->argptr[0].c = (char *) va_arg(ap, void **);
+			option->pNumArgs = va_arg(ap, int *);
+			if( option->argptr[0].c == NULL || option->pNumArgs == NULL )
 			{
-				return( parse_format( pN, option->argtype ) );
+				*lastArg = spec->optnum + 1;
+				return( SG_ERROR_MISSING_ARG );
 			}
-			else
+			spec->numManaged++;
+		}
+
+		for( i = 0 ; i < option->numargs && option->managed == 0 && option->stream == NULL ; i++ )
+		{
+			// fixed formats take one pointer per %; var formats take a single array pointer
+			option->argptr[i].c = (char *) va_arg(ap, void *);
+
+			if( option->varflag == 1 )
 			{
-				if( (z = parse_format( pN, option->argtype )) == 0 )
-				{
-#if DEBUG
-					fprintf(stderr,"var arg option but no valid var arg list\n");
-#endif
-					return(0);  /* newly added 9-27-92. bug if gave vararg option but no list */
-				}
-				else if( z < 0 )
+				// now pop pointer to numArgs. Its value on entry is the capacity of the array.
+				option->pNumArgs = va_arg(ap, int *);
+				if( option->argptr[i].c == NULL || option->pNumArgs == NULL )
 				{
-#if DEBUG
-					fprintf(stderr,"Incorrect var arg list\n");
-#endif
-					return(SG_ERROR_MIXED_TYPES_IN_VAR);
+					*lastArg = spec->optnum + 1;
+					return( SG_ERROR_MISSING_ARG );
 				}
-				
-				return( z );
+				option->numArgsMax = *option->pNumArgs;
 			}
 		}
-	}
-	else
-	{
-		// no arguments to this flag. Assume 1 int to be returned.
-		//printf("no_arg flag found <%s>\n",s);
 		
-		option->varflag = 0;
-		*noName = 0;
-		strcpy( option->name, s );
-		return( 0 );
+		// flagless arg (like -help)
+		if( option->numargs == 0 )
+		{
+			option->argptr[0].i = va_arg(ap, int *);
+			if( option->argptr[0].i == NULL )
+			{
+				*lastArg = spec->optnum + 1;
+				return( SG_ERROR_MISSING_ARG );
+			}
+		}
+
+#if SG_ENABLE_HELPSTRING
+		// get help string
+		option->helpString = va_arg(ap, char *);
+#endif
+		spec->optnum++;
 	}
 
+	return(0);
 }
 
-static int parse_format(char *s, int *argtypes)
+/* Checks a table for superCompileTable() and counts what the arena needs. */
+static int count_table( const SG_OPTION *options, int numOptions, int *lastArg, int *pArgslots, size_t *pNamebytes )
 {
-	char *scopy, *sp, string[MAXSTRING];
-	int len;
-	int i, numargs;
-	static char *arg[MAXARGS];
-	
-	//printf("parse_format: s = <%s>\n", s);
-	
-	sp = strstr(s,"%");	
-	if( sp == NULL )
-	{
-#if DEBUG
-		fprintf(stderr, "Bad format in <%s>. No %% sign.\n", s);
-#endif
-		return(SG_ERROR_BAD_FORMAT);
-	}
+	const SG_OPTION *o;
+	int i, t;
 
-	len = strlen( sp );
-	scopy = malloc( len + 1 );
-	strcpy( scopy, sp );
-	//scopy = (char *) strdup( sp ); // eliminate strdup call
+	*pArgslots = 0;
+	*pNamebytes = 0;
 
-	for( numargs = 0, arg[numargs] = strtok(scopy, "%");
-		(arg[++numargs] = strtok( (char *) NULL, "%")) != NULL && numargs < MAXARGS-1; )
+	for( i = 0 ; i < numOptions ; i++ )
 	{
-		//printf("strtok iteration: numargs=%d for <%s>\n",numargs, s);
-		;
-	}
-		//printf("strtok iteration: numargs=%d for <%s>\n",numargs, s);
+		o = &options[i];
+		*lastArg = i + 1;
 
-	for( i = 0 ; i < numargs ; i++ )
-	{
-		strcpy(string,"%");
-		strcat(string, arg[i]);
+		if( o->name == NULL || o->namelen < 1 ) return( SG_ERROR_ZERO_LEN_OPTION );
+		if( o->numargs < 0 ) return( SG_ERROR_BAD_FORMAT );
+		if( (o->flags & SG_OPTION_VAR) && o->numargs != 1 ) return( SG_ERROR_MIXED_TYPES_IN_VAR );
+		if( (o->flags & SG_OPTION_MANAGED) && o->numargs != 1 ) return( SG_ERROR_BAD_FORMAT );
+		if( (o->flags & SG_OPTION_STREAM) && ((o->flags & (SG_OPTION_VAR | SG_OPTION_MANAGED)) != SG_OPTION_VAR) ) return( SG_ERROR_BAD_FORMAT );
 
-		if( strstr(string, "%f") != NULL )
-			argtypes[i] = (int) FLOAT;
-		else
-		if( strstr(string, "%lf") != NULL )
-			argtypes[i] = (int) DOUBLE;
-		else
-		if( strstr(string, "%c") != NULL )
-			argtypes[i] = (int) CHAR;
-		else
-		if( strstr(string, "%hd") != NULL )
-			argtypes[i] = (int) SHORT;
-		else
-		if( strstr(string, "%d") != NULL )
-			argtypes[i] = (int) INT;
-		else
-		if( strstr(string, "%s") != NULL )
-			argtypes[i] = (int) STRING;
+		for( t = 0 ; t < o->numargs ; t++ )
+		{
+			if( o->types[t] < 0 || o->types[t] >= SG_NUM_TYPES ) return( SG_ERROR_BAD_FORMAT_TYPE );
+		}
+		if( o->flags & SG_OPTION_STREAM )
+		{
+			if( o->stream == NULL ) return( SG_ERROR_MISSING_ARG );
+		}
 		else
 		{
+			for( t = 0 ; t < (o->numargs > 0 ? o->numargs : 1) ; t++ )
+			{
+				if( o->ptrs[t] == NULL ) return( SG_ERROR_MISSING_ARG );
+			}
+			if( (o->flags & (SG_OPTION_VAR | SG_OPTION_MANAGED)) && o->pNumArgs == NULL ) return( SG_ERROR_MISSING_ARG );
+		}
+
+		*pArgslots += o->numargs > 0 ? o->numargs : 1;
+		*pNamebytes += o->namelen + 1;
+	}
+
+	*lastArg = 0;
+
+	return(0);
+}
+
+/* fill_spec() for a checked table: no formats to parse, no va_list */
+static int fill_table( SG_SPEC *spec, const SG_OPTION *options, int numOptions )
+{
+	struct optionlist_s *option;
+	const SG_OPTION *o;
+	char *name = spec->names;
+	int nextslot = 0;
+	int i, k;
+
+	for( k = 0 ; k < numOptions ; k++ )
+	{
+		o = &options[k];
+		option = &spec->optionlist[spec->optnum];
+		option->argtype = &spec->argtypes[nextslot];
+		option->argptr = &spec->argptrs[nextslot];
+		option->numargs = o->numargs;
+		option->varflag = (o->flags & SG_OPTION_VAR) ? 1 : 0;
+		option->managed = (o->flags & SG_OPTION_MANAGED) ? 1 : 0;
+		option->stream = (o->flags & SG_OPTION_STREAM) ? o->stream : NULL;
+		option->pNumArgs = option->stream == NULL ? o->pNumArgs : NULL;
+		option->numArgsMax = (option->varflag && !option->managed && option->stream == NULL) ? *o->pNumArgs : 0;
+		option->helpString = (char *) o->help;
+		option->namelen = o->namelen;
+		nextslot += option->numargs > 0 ? option->numargs : 1;
+
+		memcpy( name, o->name, option->namelen );
+		name[option->namelen] = '\0';
+		option->name = name;
+		name += option->namelen + 1;
+
+		for( i = 0 ; i < option->numargs ; i++ )
+		{
+			option->argtype[i] = o->types[i];
+			option->argptr[i].c = o->ptrs != NULL ? (char *) o->ptrs[i] : NULL;
+		}
+		if( option->numargs == 0 ) option->argptr[0].i = (int *) o->ptrs[0];
+
+		if( option->managed ) spec->numManaged++;
+		spec->optnum++;
+	}
+
+	return(0);
+}
+
+int superGetOptSpec( const SG_SPEC *spec, int argc, char **argv, int *lastArg )
+{
+	SG_CTX ctx;
+	int n;
+
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	n = superGetOptCtx( &ctx, argc, argv, lastArg );
+	SG_STAT( sg_merge_stats( &ctx ) );
+
+	return( n );
+}
+
+int superParseOptSpec( const SG_SPEC *spec, int argc, char **argv, int *lastArg )
+{
+	SG_CTX ctx;
+	int n;
+
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	n = superParseOptCtx( &ctx, argc, argv, lastArg );
+	SG_STAT( sg_merge_stats( &ctx ) );
+
+	return( n );
+}
+
+int superGetStats( const SG_CTX *ctx, SG_STATS *stats )
+{
+	if( ctx == NULL )
+	{
+		*stats = threadStats;
+	}
+	else
+	{
+		*stats = ctx->stats;
+		stats->formatsCompiled = ctx->spec->optnum;
+		stats->setupNs = ctx->spec->setupNs;
+	}
+
+	return( SG_ENABLE_STATS );
+}
+
+void superResetStats( SG_CTX *ctx )
+{
+	memset( ctx != NULL ? &ctx->stats : &threadStats, 0, sizeof(SG_STATS) );
+}
+
+void sg_merge_stats( const SG_CTX *ctx )
+{
+	int t;
+
+	threadStats.parses += ctx->stats.parses;
+	threadStats.tokensScanned += ctx->stats.tokensScanned;
+	threadStats.bytesScanned += ctx->stats.bytesScanned;
+	threadStats.lookups += ctx->stats.lookups;
+	threadStats.lookupProbes += ctx->stats.lookupProbes;
+	for( t = 0 ; t < SG_NUM_TYPES ; t++ ) threadStats.conversions[t] += ctx->stats.conversions[t];
+	threadStats.conversionFailures += ctx->stats.conversionFailures;
+	threadStats.matchNs += ctx->stats.matchNs;
+	threadStats.convertNs += ctx->stats.convertNs;
+}
+
+unsigned long long sg_now_ns( void )
+{
+	struct timespec ts;
+
+#if defined(_WIN32)
+	timespec_get( &ts, TIME_UTC );
+#else
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+#endif
+	return( ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+int superInitCtx( SG_CTX *ctx, const SG_SPEC *spec, void *origin, void *base, size_t size )
+{
+	memset( ctx, 0, sizeof(SG_CTX) );
+	ctx->spec = spec;
+	ctx->origin = (char *) origin;
+	ctx->base = (char *) base;
+	ctx->size = (origin != NULL && base != NULL) ? size : 0;
+	ctx->parallelMin = SG_PARALLEL_MIN;
+
+	if( spec != NULL && spec->resultsSize > 0 )
+	{
+		// generated specs hold offsets into the results struct at base
+		ctx->origin = NULL;
+		ctx->size = spec->resultsSize;
+		if( base == NULL ) return( SG_ERROR_BAD_FORMAT );
+	}
+
+	return(0);
+}
+
+int superGetOptCtx( SG_CTX *ctx, int argc, char **argv, int *lastArg )
+{
+	int n;
+	int usageCall = 0;
+	
+	if( argv != NULL )	argv++;
+	else usageCall = 1;
+	
+    if( argc <= 1 ) usageCall = 1;
+	else	argc--;
+
+	n = superParseInternal( ctx, argc, argv, usageCall, lastArg );
+
+	if( usageCall == 1 && *lastArg == 1 ) n = SG_ERROR_PRINT_USAGE;
+	else if( n == 0 && ctx->unAccountedFor )
+	{
+		n = ctx->unAccountedFor; // not necessarily an error, just unaccounted for args
+	}
+	
+	return(n);
+}
+
+int superParseOptCtx( SG_CTX *ctx, int argc, char **argv, int *lastArg )
+{
+	int n;
+	int usageCall = 0;
+	
+	if( argc == 0 || argv == NULL ) usageCall = 1;
+
+	n = superParseInternal( ctx, argc, argv, usageCall, lastArg );
+
+	if( usageCall == 1 && *lastArg == 1 ) n = SG_ERROR_PRINT_USAGE;
+	else if( n == 0 && ctx->unAccountedFor )
+	{
+		n = ctx->unAccountedFor; // not necessarily an error, just unaccounted for args
+	}
+		
+	return(n);
+}
+
+/* The variadic entry points compile a throwaway spec on every call. The most
+	recent one is kept so that superGetOpt(0, NULL, &err, NULL) can print it. */
+static int superLegacyInternal( int argc, char **argv, int usageCall, int *lastArg, int *pUnAccountedFor, va_list ap )
+{
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	int n;
+
+	*pUnAccountedFor = 0;
+
+	n = superCompileOptV( &spec, lastArg, ap );
+	if( n < 0 ) return( n );
+
+	if( spec->optnum == 0 && (argv == NULL || argc == 0) )
+	{
+		// usage re-call with an empty list: print the previous table
+		superFreeOpt( spec );
+		if( lastSpec != NULL ) superWriteUsage( lastSpec, SG_USAGE_TEXT, 1 );
+		return(0);
+	}
+
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	n = superParseInternal( &ctx, argc, argv, usageCall, lastArg );
+	*pUnAccountedFor = ctx.unAccountedFor;
+	SG_STAT( sg_merge_stats( &ctx ) );
+
+	superFreeOpt( lastSpec );
+	lastSpec = spec;
+
+	return(n);
+}
+
+/* Output pointers inside the context's origin block are redirected to the
+	same offset in its base block, so one spec can fill many result structs. */
+static void *dest_ptr( const SG_CTX *ctx, void *p )
+{
+	// unsigned wraparound turns the range test into one comparison
+	size_t offset = (size_t) ((uintptr_t) p - (uintptr_t) ctx->origin);
+
+	if( offset < ctx->size ) return( ctx->base + offset );
+	return( p );
+}
+
+void *sg_output( const SG_CTX *ctx, void *p )
+{
+	return( dest_ptr( ctx, p ) );
+}
+
+void sg_reset_outputs( const SG_CTX *ctx )
+{
+	const SG_SPEC *spec = ctx->spec;
+	register int i;
+
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( spec->optionlist[i].stream != NULL ) continue;
+		if( spec->optionlist[i].managed )
+		{
+			*(void **) dest_ptr( ctx, spec->optionlist[i].argptr[0].c ) = NULL;
+			*(int *) dest_ptr( ctx, spec->optionlist[i].pNumArgs ) = 0;
+		}
+		else if( spec->optionlist[i].varflag == 1 && spec->optionlist[i].numargs > 0 )
+		{
+			*(int *) dest_ptr( ctx, spec->optionlist[i].pNumArgs ) = 0;
+		}
+		else if( spec->optionlist[i].numargs == 0 )
+		{
+			*(int *) dest_ptr( ctx, spec->optionlist[i].argptr[0].i ) = 0;
+		}
+	}
+}
+
+static int superParseInternal( SG_CTX *ctx, int argc, char **argv, int usageCall, int *lastArg )
+{
+	const SG_SPEC *spec = ctx->spec;
+	int n;
+
+	// user can tell us to print usage by calling with NULL or argc = 0 or both
+    if( argv == NULL || argc == 0 )
+	{
+		*lastArg = 0;
+		ctx->unAccountedFor = 0;
+		superWriteUsage( ctx->spec, SG_USAGE_TEXT, 1 );
+		return(0);
+	}
+
+	// a generated spec's outputs are offsets, and there is no struct to add them to
+	if( spec->resultsSize > 0 && ctx->base == NULL ) return( SG_ERROR_BAD_FORMAT );
+
+	ctx->nextToken = NULL;
+	ctx->argv = argv;
+	ctx->argsleft = argc;
+	ctx->cur = argv[0];
+
+	if( sg_begin_parse( ctx ) < 0 ) return( SG_ERROR_NO_MEMORY );
+	if( spec->env != NULL )
+	{
+		ctx->seen = (unsigned char *) sg_arena_grow( ctx->outArena, NULL, 0, (spec->optnum + 7) / 8 );
+		if( ctx->seen == NULL ) return( SG_ERROR_NO_MEMORY );
+		memset( ctx->seen, 0, (spec->optnum + 7) / 8 );
+	}
+	sg_reset_outputs( ctx );
+	SG_STAT( ctx->stats.parses++ );
+	expand_response( ctx );
+
+	n = parse_tokens( ctx, usageCall, lastArg );
+
+	// options the command line did not give fall back to the environment
+	if( n == 0 && spec->env != NULL ) n = sg_parse_env( ctx );
+
+	return( n );
+}
+
+/* Token streams (config and response files) feed the parser through a
+	callback instead of an argv array. Returns like superParseOpt(). */
+int sg_parse_stream( SG_CTX *ctx, char *(*nextToken)( void *state ), void *state, int *lastArg )
+{
+	int n;
+
+	ctx->nextToken = nextToken;
+	ctx->tokenState = state;
+	ctx->argv = NULL;
+	ctx->argsleft = 0;
+	ctx->cur = nextToken( state );
+	expand_response( ctx );
+
+	n = parse_tokens( ctx, 0, lastArg );
+	if( n == 0 && ctx->unAccountedFor ) n = ctx->unAccountedFor;
+
+	return( n );
+}
+
+/* sg_parse_stream() callback over tokens that were split up front */
+char *sg_array_token( void *state )
+{
+	struct sg_tokens_s *s = (struct sg_tokens_s *) state;
+
+	if( s->next == s->num ) return( NULL );
+	return( s->tokens[s->next++] );
+}
+
+/* Stores num words as the arguments of option, converted like
+	match_tokens() converts them, but none is matched against the option
+	names or expanded as a response file: the words are known to be
+	values. Fixed arguments need exactly numargs words; a var-arg list
+	takes them all, dropping those past the caller's capacity as
+	match_tokens() does. */
+int sg_store_words( SG_CTX *ctx, int option, char **words, int num )
+{
+	const struct optionlist_s *o = &ctx->spec->optionlist[option];
+	ANYTYPE argval;
+	char *out = NULL, *values = NULL;
+	void *slot;
+	size_t width;
+	int *pNum = NULL;
+	int j, x, type;
+
+	if( o->numargs == 0 )
+	{
+		if( num > 0 ) return( SG_ERROR_TOO_MANY_ARGS );
+		*(int *) dest_ptr( ctx, o->argptr[0].i ) = 1;
+		return(0);
+	}
+
+	if( o->varflag == 0 )
+	{
+		if( num < o->numargs ) return( SG_ERROR_MISSING_ARG );
+		if( num > o->numargs ) return( SG_ERROR_TOO_MANY_ARGS );
+
+		for( j = 0 ; j < num ; j++ )
+		{
+			if( sg_converters[o->argtype[j]]( words[j], o->managed ? (void *) &argval : dest_ptr( ctx, o->argptr[j].c ) ) != 0 )
+			{
+				SG_STAT( ctx->stats.conversionFailures++ );
+				return( SG_ERROR_INCORRECT_ARG );
+			}
+			SG_STAT( ctx->stats.conversions[o->argtype[j]]++ );
+			if( o->managed && (x = append_value( ctx, o, &argval )) < 0 ) return( x );
+		}
+		return(0);
+	}
+
+	type = o->argtype[0];
+	width = sg_type_sizes[type];
+	if( o->stream != NULL )
+	{
+		values = (char *) sg_arena_grow( ctx->outArena, NULL, 0, num * width + 1 );
+		if( values == NULL ) return( SG_ERROR_NO_MEMORY );
+	}
+	else if( o->managed == 0 )
+	{
+		out = (char *) dest_ptr( ctx, o->argptr[0].c );
+		pNum = (int *) dest_ptr( ctx, o->pNumArgs );
+	}
+
+	for( j = 0 ; j < num ; j++ )
+	{
+		if( values != NULL ) slot = values + j * width;
+		else if( o->managed || j >= o->numArgsMax ) slot = &argval;
+		else slot = out + j * width;
+
+		if( sg_list_converters[type]( words[j], slot ) != 0 )
+		{
+			SG_STAT( ctx->stats.conversionFailures++ );
+			return( SG_ERROR_INCORRECT_ARG );
+		}
+		SG_STAT( ctx->stats.conversions[type]++ );
+
+		if( o->managed && (x = append_value( ctx, o, &argval )) < 0 ) return( x );
+		if( pNum != NULL && j < o->numArgsMax ) *pNum = j + 1;
+	}
+
+	for( j = 0 ; values != NULL && j < num ; j += SG_STREAM_CHUNK )
+	{
+		if( o->stream( o->argptr[0].c, values + j * width, num - j < SG_STREAM_CHUNK ? num - j : SG_STREAM_CHUNK ) != 0 ) return( SG_ERROR_CALLBACK );
+	}
+
+	return(0);
+}
+
+/* Bytes sg_copy_option() moves for an option: its flag, its fixed
+	arguments, or a var list's count and whole array. Not for "+" and ">"
+	options, whose values are not in the outputs. */
+size_t sg_option_bytes( const SG_SPEC *spec, int option )
+{
+	const struct optionlist_s *o = &spec->optionlist[option];
+	size_t n = 0;
+	int j;
+
+	if( o->numargs == 0 ) return( sizeof(int) );
+	if( o->varflag ) return( sizeof(int) + o->numArgsMax * sg_type_sizes[o->argtype[0]] );
+	for( j = 0 ; j < o->numargs ; j++ ) n += sg_type_sizes[o->argtype[j]];
+
+	return( n );
+}
+
+static void copy_bytes( void *out, char *buf, size_t n, int save )
+{
+	if( save ) memcpy( buf, out, n );
+	else memcpy( out, buf, n );
+}
+
+/* copies an option's outputs to buf (save) or back from it */
+void sg_copy_option( const SG_CTX *ctx, int option, void *buf, int save )
+{
+	const struct optionlist_s *o = &ctx->spec->optionlist[option];
+	char *b = (char *) buf;
+	int j;
+
+	if( o->numargs == 0 )
+	{
+		copy_bytes( dest_ptr( ctx, o->argptr[0].i ), b, sizeof(int), save );
+	}
+	else if( o->varflag )
+	{
+		copy_bytes( dest_ptr( ctx, o->pNumArgs ), b, sizeof(int), save );
+		copy_bytes( dest_ptr( ctx, o->argptr[0].c ), b + sizeof(int), o->numArgsMax * sg_type_sizes[o->argtype[0]], save );
+	}
+	else for( j = 0 ; j < o->numargs ; b += sg_type_sizes[o->argtype[j]], j++ )
+	{
+		copy_bytes( dest_ptr( ctx, o->argptr[j].c ), b, sg_type_sizes[o->argtype[j]], save );
+	}
+}
+
+static int same_value( int type, const char *a, const char *b )
+{
+	const char *s, *t;
+
+	if( type != STRING ) return( memcmp( a, b, sg_type_sizes[type] ) == 0 );
+
+	// strings are equal by content, wherever they point
+	memcpy( &s, a, sizeof(char *) );
+	memcpy( &t, b, sizeof(char *) );
+	if( s == NULL || t == NULL ) return( s == t );
+	return( strcmp( s, t ) == 0 );
+}
+
+/* 1 if an option's outputs no longer match what sg_copy_option() saved */
+int sg_option_differs( const SG_CTX *ctx, int option, const void *buf )
+{
+	const struct optionlist_s *o = &ctx->spec->optionlist[option];
+	const char *b = (const char *) buf;
+	const char *out;
+	int j, num;
+
+	if( o->numargs == 0 ) return( memcmp( dest_ptr( ctx, o->argptr[0].i ), b, sizeof(int) ) != 0 );
+
+	if( o->varflag )
+	{
+		memcpy( &num, b, sizeof(int) );
+		if( num != *(int *) dest_ptr( ctx, o->pNumArgs ) ) return(1);
+
+		out = (const char *) dest_ptr( ctx, o->argptr[0].c );
+		b += sizeof(int);
+		for( j = 0 ; j < num && j < o->numArgsMax ; j++ )
+		{
+			if( !same_value( o->argtype[0], out + j * sg_type_sizes[o->argtype[0]], b + j * sg_type_sizes[o->argtype[0]] ) ) return(1);
+		}
+		return(0);
+	}
+
+	for( j = 0 ; j < o->numargs ; b += sg_type_sizes[o->argtype[j]], j++ )
+	{
+		if( !same_value( o->argtype[j], (const char *) dest_ptr( ctx, o->argptr[j].c ), b ) ) return(1);
+	}
+
+	return(0);
+}
+
+int superLookupOpt( const SG_SPEC *spec, const char *name )
+{
+	SG_STATS unused;
+
+	return( lookup_name( spec, name, &unused ) );
+}
+
+int sg_parse_format( const char *format, int *pNameLen, int *pVarflag, int *pManaged, int *pStream, int *argtypes )
+{
+	return( parse_string( format, pNameLen, pVarflag, pManaged, pStream, argtypes ) );
+}
+
+int sg_spec_needs_arena( const SG_SPEC *spec )
+{
+	return( spec->numManaged > 0 || spec->responseOpt > 0 || spec->env != NULL );
+}
+
+int sg_begin_parse( SG_CTX *ctx )
+{
+	ctx->outArena = ctx->arena;
+	ctx->tokenError = 0;
+	ctx->responseDepth = 0;
+	ctx->seen = NULL;
+	ctx->given = NULL;
+	ctx->lazySpans = NULL;
+	if( ctx->arena == NULL && (ctx->lazy || sg_spec_needs_arena( ctx->spec )) )
+	{
+		if( threadArena == NULL && superNewArena( &threadArena ) < 0 ) return( SG_ERROR_NO_MEMORY );
+		superResetArena( threadArena );
+		ctx->outArena = threadArena;
+	}
+	if( ctx->lazy ) return( sg_lazy_begin( ctx ) );
+
+	return(0);
+}
+
+/* appends one converted value to a "+" option's array */
+static int append_value( const SG_CTX *ctx, const struct optionlist_s *option, const ANYTYPE *argval )
+{
+	char **pArray = (char **) dest_ptr( ctx, option->argptr[0].c );
+	int *pNum = (int *) dest_ptr( ctx, option->pNumArgs );
+	size_t width = sg_type_sizes[option->argtype[0]];
+	char *array;
+
+	if( ctx->outArena == NULL ) return( SG_ERROR_NO_ARENA );
+
+	array = (char *) sg_arena_grow( ctx->outArena, *pArray, *pNum * width, (*pNum + 1) * width );
+	if( array == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	memcpy( array + *pNum * width, argval, width );
+	*pArray = array;
+	(*pNum)++;
+
+	return(0);
+}
+
+/* the next token of the innermost response file, or of the context's own
+	input once every response file has run out */
+static char *raw_token( SG_CTX *ctx )
+{
+	char *token;
+
+	while( ctx->responseDepth > 0 )
+	{
+		token = sg_file_token( ctx->response[ctx->responseDepth-1] );
+		if( token != NULL ) return( token );
+
+		ctx->tokenError = sg_file_error( ctx->response[ctx->responseDepth-1] );
+		if( ctx->tokenError < 0 ) return( NULL );
+		ctx->responseDepth--;
+	}
+
+	if( ctx->nextToken != NULL ) return( ctx->nextToken( ctx->tokenState ) );
+	if( --ctx->argsleft > 0 ) return( *++ctx->argv );
+	return( NULL );
+}
+
+/* Replaces an @path token in cur by the first token of that file. The
+	file's mapping goes to the output arena, since results point into it. */
+static void expand_response( SG_CTX *ctx )
+{
+	const SG_SPEC *spec = ctx->spec;
+	SG_FILE *file;
+	int n;
+
+	while( ctx->cur != NULL && ctx->cur[0] == '@' && ctx->cur[1] != '\0' && spec->responseOpt > 0 )
+	{
+		if( ctx->responseDepth == SG_MAX_RESPONSE_DEPTH ) n = SG_ERROR_RESPONSE_DEPTH;
+		else if( ctx->outArena == NULL ) n = SG_ERROR_NO_ARENA;
+		else n = superOpenFile( &file, ctx->cur + 1 );
+		if( n < 0 )
+		{
+			ctx->tokenError = n;
+			ctx->cur = NULL;
+			return;
+		}
+
+		sg_arena_keep_file( ctx->outArena, file );
+		ctx->response[ctx->responseDepth++] = file;
+		*(int *) dest_ptr( ctx, spec->optionlist[spec->responseOpt-1].argptr[0].i ) = 1;
+
+		ctx->cur = raw_token( ctx );
+	}
+}
+
+/* Converts the var-list token at cur into out. Returns 0, 1 when the
+	token is an option (or an ambiguous abbreviation) that ends the list,
+	or SG_ERROR_INCORRECT_ARG. */
+static int list_value( SG_CTX *ctx, int type, void *out )
+{
+	/* Var arg string list terminates at next option */
+	if( type == STRING && check_if_option( ctx->spec, ctx->cur, &ctx->stats ) != -1 ) return(1);
+
+	if( sg_list_converters[type]( ctx->cur, out ) == 0 ) return(0);
+	if( check_if_option( ctx->spec, ctx->cur, &ctx->stats ) != -1 ) return(1);
+
+	SG_STAT( ctx->stats.conversionFailures++ );
+	return( SG_ERROR_INCORRECT_ARG );
+}
+
+/* The rest of a var list that has reached ctx->parallelMin values, done
+	of them already stored. Its tokens are gathered up to the one that
+	ends the list: a token that names an option ends it only if it does
+	not convert, so just those are converted here, and a walk of the
+	trie keeps the full lookup off the plain numbers. The others go to
+	sg_convert_run(), and a failure there is the same error list_value()
+	would have returned at that token. */
+static int parallel_list( SG_CTX *ctx, const struct optionlist_s *option, char *out, int done )
+{
+	const int type = option->argtype[0];
+	const size_t width = sg_type_sizes[type];
+	char **tokens = NULL, **more;
+	int num = 0, max = 0, first, stored;
+	char **pArray = NULL;
+	int *pNum = NULL;
+	ANYTYPE argval;
+
+	for( ; ctx->cur != NULL ; next_token( ctx ) )
+	{
+		SG_STAT( ctx->stats.tokensScanned++ );
+		SG_STAT_DETAIL( ctx->stats.bytesScanned += strlen( ctx->cur ) );
+
+		if( may_be_option( ctx->spec, ctx->cur, &ctx->stats ) && check_if_option( ctx->spec, ctx->cur, &ctx->stats ) != -1
+				&& sg_list_converters[type]( ctx->cur, &argval ) < 0 ) break;
+
+		if( num == max )
+		{
+			max = max ? 2 * max : 4096;
+			more = (char **) realloc( tokens, max * sizeof(char *) );
+			if( more == NULL )
+			{
+				free( tokens );
+				return( SG_ERROR_NO_MEMORY );
+			}
+			tokens = more;
+		}
+		tokens[num++] = ctx->cur;
+	}
+	if( num == 0 ) return(0);
+
+	if( option->managed )
+	{
+		pArray = (char **) dest_ptr( ctx, option->argptr[0].c );
+		pNum = (int *) dest_ptr( ctx, option->pNumArgs );
+		out = (char *) sg_arena_grow( ctx->outArena, *pArray, *pNum * width, (*pNum + num) * width );
+		if( out == NULL )
+		{
+			free( tokens );
+			return( SG_ERROR_NO_MEMORY );
+		}
+		*pArray = out;
+		out += *pNum * width;
+		done = 0;
+		max = num;
+	}
+	else
+	{
+		max = option->numArgsMax - done;
+		if( max < 0 )
+		{
+			// the caller's array filled up before the list got long
+			done = option->numArgsMax;
+			max = 0;
+		}
+	}
+
+	first = sg_convert_run( tokens, num, type, out + done * width, max, ctx->parallelThreads );
+	free( tokens );
+
+	// values past the caller's array are checked but neither kept nor counted
+	stored = first < max ? first : max;
+	if( option->managed ) *pNum += stored;
+	else *(int *) dest_ptr( ctx, option->pNumArgs ) = done + stored;
+	ctx->lastArgProcessedSuccessfully += stored;
+	SG_STAT( ctx->stats.conversions[type] += stored );
+
+	if( first < num )
+	{
+		SG_STAT( ctx->stats.conversionFailures++ );
+		return( SG_ERROR_INCORRECT_ARG );
+	}
+	return(0);
+}
+
+/* A lazy parse records where an option's numeric arguments are instead
+	of converting them (see superGetOptLazy.c). Its tokens are taken the
+	way parallel_list() takes them: only one that names an option is
+	converted, to see whether it ends the var list or leaves a fixed
+	argument missing, and %s arguments are stored at once. */
+static int lazy_args( SG_CTX *ctx, int option )
+{
+	const struct optionlist_s *o = &ctx->spec->optionlist[option];
+	const int first = ctx->lazySpans->numTokens;
+	const int pos = ctx->lastArgProcessedSuccessfully;
+	int type, x, j;
+	ANYTYPE argval;
+
+	for( j = 0 ; ctx->cur != NULL && (j < o->numargs || o->varflag == 1) ; j++, next_token( ctx ) )
+	{
+		SG_STAT( ctx->stats.tokensScanned++ );
+		SG_STAT_DETAIL( ctx->stats.bytesScanned += strlen( ctx->cur ) );
+
+		type = o->argtype[o->varflag ? 0 : j];
+		if( may_be_option( ctx->spec, ctx->cur, &ctx->stats ) && (x = check_if_option( ctx->spec, ctx->cur, &ctx->stats )) != -1
+				&& (o->varflag ? sg_list_converters : sg_converters)[type]( ctx->cur, &argval ) < 0 )
+		{
+			if( o->varflag ) break;	/* next option detected -- end of var list */
+			SG_STAT( ctx->stats.conversionFailures++ );
+			return( x == SG_ERROR_AMBIGUOUS_OPTION ? x : SG_ERROR_MISSING_ARG );
+		}
+
+		if( type == STRING )
+		{
+			*(char **) dest_ptr( ctx, o->argptr[j].c ) = ctx->cur;
+			SG_STAT( ctx->stats.conversions[STRING]++ );
+		}
+		if( (x = sg_lazy_token( ctx, ctx->cur, type == STRING )) < 0 ) return( x );
+
+		if( o->varflag == 0 || j < o->numArgsMax ) ctx->lastArgProcessedSuccessfully++;
+	}
+
+	if( o->varflag != 1 && j != o->numargs ) return( SG_ERROR_MISSING_ARG );
+	if( j == 0 ) return(0);
+	if( o->varflag == 1 ) *(int *) dest_ptr( ctx, o->pNumArgs ) = j < o->numArgsMax ? j : o->numArgsMax;
+
+	return( sg_lazy_span( ctx, option, first, j, pos ) );
+}
+
+/* Converts a ">*%X" list into a chunk on the stack and hands each full
+	chunk, and the rest at the end of the list, to the option's callback. */
+static int stream_list( SG_CTX *ctx, const struct optionlist_s *option )
+{
+	union
+	{
+		char c[SG_STREAM_CHUNK];
+		short h[SG_STREAM_CHUNK];
+		int i[SG_STREAM_CHUNK];
+		float f[SG_STREAM_CHUNK];
+		double d[SG_STREAM_CHUNK];
+		char *string[SG_STREAM_CHUNK];
+		long long ll[SG_STREAM_CHUNK];
+	} chunk;
+	const int type = option->argtype[0];
+	const size_t width = sg_type_sizes[type];
+	int n = 0, x;
+
+	for( ; ctx->cur != NULL ; next_token( ctx ) )
+	{
+		SG_STAT( ctx->stats.tokensScanned++ );
+		SG_STAT_DETAIL( ctx->stats.bytesScanned += strlen( ctx->cur ) );
+
+		x = list_value( ctx, type, chunk.c + n * width );
+		if( x < 0 ) return( x );
+		if( x > 0 ) break;
+
+		SG_STAT( ctx->stats.conversions[type]++ );
+		ctx->lastArgProcessedSuccessfully++;
+
+		if( ++n == SG_STREAM_CHUNK )
+		{
+			if( option->stream( option->argptr[0].c, chunk.c, n ) != 0 ) return( SG_ERROR_CALLBACK );
+			n = 0;
+		}
+	}
+
+	if( n > 0 && option->stream( option->argptr[0].c, chunk.c, n ) != 0 ) return( SG_ERROR_CALLBACK );
+
+	return(0);
+}
+
+/* moves the context to its next input token; cur is NULL at the end */
+static void next_token( SG_CTX *ctx )
+{
+	ctx->cur = raw_token( ctx );
+	if( ctx->cur != NULL && ctx->cur[0] == '@' ) expand_response( ctx );
+}
+
+/* match_tokens() with its time split into matching and conversion */
+static int parse_tokens( SG_CTX *ctx, int usageCall, int *lastArg )
+{
+#if SG_ENABLE_STATS > 1
+	unsigned long long t0 = sg_now_ns();
+	unsigned long long convertNs = ctx->stats.convertNs;
+	int n;
+
+	n = match_tokens( ctx, usageCall, lastArg );
+	ctx->stats.matchNs += sg_now_ns() - t0 - (ctx->stats.convertNs - convertNs);
+#else
+	int n = match_tokens( ctx, usageCall, lastArg );
+#endif
+
+	// a response file that failed ended the input early
+	if( ctx->tokenError < 0 )
+	{
+		*lastArg = ctx->lastArgProcessedSuccessfully;
+		return( ctx->tokenError );
+	}
+
+	return( n );
+}
+
+static int match_tokens( SG_CTX *ctx, int usageCall, int *lastArg )
+{
+	const SG_SPEC *spec = ctx->spec;
+	const struct optionlist_s *optionlist = spec->optionlist;
+	PANYTYPE out;
+	int *pNumArgs = NULL;
+	register int i,j;
+	int x;
+	int good;
+	ANYTYPE argval;
+	size_t width;
+	int return_val;
+#if SG_ENABLE_STATS > 1
+	unsigned long long t0;
+#endif
+	
+	out.c = NULL;
+	ctx->unAccountedFor = 0; // args not associated with detected flags
+	ctx->lastArgProcessedSuccessfully = 1;
+	
+	*lastArg = 0;
+	
+	return_val = 0;
+			
+	// now process cmdline argument list
+	while( ctx->cur != NULL && usageCall == 0 )
+	{
+		SG_STAT( ctx->stats.tokensScanned++ );
+		SG_STAT_DETAIL( ctx->stats.bytesScanned += strlen( ctx->cur ) );
+		i = check_if_option( spec, ctx->cur, &ctx->stats );
+		if( i == SG_ERROR_AMBIGUOUS_OPTION )
+		{
+			*lastArg = ctx->lastArgProcessedSuccessfully;
+			return( i );
+		}
+		if( i < 0 )
+		{
+#if DEBUG
+			fprintf(stderr,"option not found at argv=%s latProcSuc=%d\n",ctx->cur,ctx->lastArgProcessedSuccessfully);
+#endif
+			*lastArg = ctx->lastArgProcessedSuccessfully;
+			ctx->unAccountedFor++;
+			next_token( ctx );
+			continue;
+		}
+
+		ctx->lastArgProcessedSuccessfully++;		
+		if( ctx->seen != NULL && !(ctx->seen[i >> 3] & (1 << (i & 7))) )
+		{
+			ctx->seen[i >> 3] |= 1 << (i & 7);
+			if( ctx->given != NULL ) ctx->given[ctx->numGiven++] = i;
+		}
+		next_token( ctx );
+		
+		if( optionlist[i].numargs == 0 )
+		{
+			// handle flagless arg like -help
+			*(int *) dest_ptr( ctx, optionlist[i].argptr[0].i ) = 1;
+		}
+		else if( optionlist[i].varflag == 1 && optionlist[i].stream == NULL )
+		{
+			out.c = (char *) dest_ptr( ctx, optionlist[i].argptr[0].c );
+			pNumArgs = (int *) dest_ptr( ctx, optionlist[i].pNumArgs );
+		}
+
+		// a lazy parse leaves numeric lists and fixed arguments for later
+		if( ctx->lazySpans != NULL && optionlist[i].numargs > 0 && optionlist[i].managed == 0 && optionlist[i].stream == NULL
+				&& !(optionlist[i].varflag == 1 && optionlist[i].argtype[0] == STRING) )
+		{
+			x = lazy_args( ctx, i );
+			if( x < 0 )
+			{
+				*lastArg = ctx->lastArgProcessedSuccessfully;
+				return( x );
+			}
+			continue;
+		}
+		
+#if SG_ENABLE_STATS > 1
+		t0 = sg_now_ns();
+#endif
+		j = 0;
+		if( optionlist[i].stream != NULL )
+		{
+			x = stream_list( ctx, &optionlist[i] );
+			if( x < 0 )
+			{
+				*lastArg = ctx->lastArgProcessedSuccessfully;
+				return( x );
+			}
+		}
+		else for( j = 0 ; ctx->cur != NULL && (j < optionlist[i].numargs || optionlist[i].varflag == 1) ; j++, next_token( ctx ) )
+		{
+			SG_STAT( ctx->stats.tokensScanned++ );
+			SG_STAT_DETAIL( ctx->stats.bytesScanned += strlen( ctx->cur ) );
+
+			if( optionlist[i].varflag != 1 )
+			{
+				// a "+" value goes through argval, anything else straight to its output
+				good = sg_converters[optionlist[i].argtype[j]]( ctx->cur, optionlist[i].managed ? (void *) &argval : dest_ptr( ctx, optionlist[i].argptr[j].c ) );
+				if( good == 0 ) SG_STAT( ctx->stats.conversions[optionlist[i].argtype[j]]++ );
 #if DEBUG
-			fprintf(stderr, "Parse_Format: Bad format <%s> len=%d arg0=%s\n",string,len,arg[0]);
+				if( good != 0 ) fprintf(stderr," Bad argument <%s>. Expected %s\n", ctx->cur, sg_type_names[optionlist[i].argtype[j]]);
 #endif
-			
-			free(scopy); /* memleak!!!! */
-			
-			return(SG_ERROR_BAD_FORMAT_TYPE);
+				if( optionlist[i].managed && good == 0 && (x = append_value( ctx, &optionlist[i], &argval )) < 0 )
+				{
+					*lastArg = ctx->lastArgProcessedSuccessfully;
+					return( x );
+				}
+				
+				if( good == 0 )
+				{
+					ctx->lastArgProcessedSuccessfully++;		
+				}
+				else if( good == -1 )
+				{
+					SG_STAT( ctx->stats.conversionFailures++ );
+					x = check_if_option( spec, ctx->cur, &ctx->stats );
+					if( x == SG_ERROR_AMBIGUOUS_OPTION )
+					{
+						*lastArg = ctx->lastArgProcessedSuccessfully;
+						return( x );
+					}
+					else if( x < 0 )
+					{
+#if DEBUG
+						fprintf(stderr,"User did not supply correct arguments to option name <%s>\n",optionlist[i].name);
+#endif
+						*lastArg = ctx->lastArgProcessedSuccessfully;
+						return(SG_ERROR_INCORRECT_ARG);
+					}
+					else 
+					{
+#if DEBUG
+						fprintf(stderr,"User did not supply enough arguments to option name <%s>\n",optionlist[i].name);
+#endif
+						*lastArg = ctx->lastArgProcessedSuccessfully;
+						return( SG_ERROR_MISSING_ARG );
+					}
+				}
+			}
+			else		/* var arg list */
+			{
+				width = sg_type_sizes[optionlist[i].argtype[0]];
+				good = list_value( ctx, optionlist[i].argtype[0], optionlist[i].managed || j >= optionlist[i].numArgsMax ? (void *) &argval : out.c + j * width );
+				if( good < 0 )
+				{
+#if DEBUG
+					fprintf(stderr, "Var arg list bad data type for option <%s>\n",optionlist[i].name);
+#endif
+					*lastArg = ctx->lastArgProcessedSuccessfully;
+					return( good );
+				}
+				if( good > 0 ) break;	/* next option detected -- end of var list */
+
+				if( optionlist[i].managed )
+				{
+					if( (x = append_value( ctx, &optionlist[i], &argval )) < 0 )
+					{
+						*lastArg = ctx->lastArgProcessedSuccessfully;
+						return( x );
+					}
+				}
+				else if( j >= optionlist[i].numArgsMax )
+				{
+					good = -3; // caller's array is full
+#if DEBUG
+					fprintf(stderr, "Warning: too many commandline args supplied for option <%s>. Max=%d\n",optionlist[i].name,optionlist[i].numArgsMax);
+#endif
+				}
+				
+				if( good == 0 ) // good read
+				{
+					SG_STAT( ctx->stats.conversions[optionlist[i].argtype[0]]++ );
+					if( optionlist[i].managed == 0 ) *pNumArgs = j+1;
+					ctx->lastArgProcessedSuccessfully++;		
+				}
+
+				// a long numeric list converts the rest of its values on threads
+				if( j + 1 == ctx->parallelMin && optionlist[i].argtype[0] != STRING && sg_run_threads( ctx->parallelThreads ) > 1 )
+				{
+					next_token( ctx );
+					x = parallel_list( ctx, &optionlist[i], out.c, j + 1 );
+					if( x < 0 )
+					{
+						*lastArg = ctx->lastArgProcessedSuccessfully;
+						return( x );
+					}
+					break;
+				}
+			}
+		}
+
+#if SG_ENABLE_STATS > 1
+		ctx->stats.convertNs += sg_now_ns() - t0;
+#endif
+
+		if( j != optionlist[i].numargs && optionlist[i].varflag != 1 )
+		{
+#if DEBUG
+			fprintf(stderr,"User did not supply enough arguments to option name <%s> Expected %d Got %d\n",optionlist[i].name,optionlist[i].numargs,j);
+#endif
+			*lastArg = ctx->lastArgProcessedSuccessfully;
+			return( SG_ERROR_MISSING_ARG );
 		}
 	}
-	
-	free(scopy); /* memleak!!!! */
 
-	//printf("final numargs=%d for <%s>\n",numargs, s);
-	return( numargs );
+	return( return_val );
 }
 
 
-static ANYTYPE getval(char *s, int type, int *flag)
+/* Splits a format like "-name %d %s" or "-name *%f" into its name (the text
+	before the first '*' or '%', trailing blanks dropped) and its argument
+	types. argtypes may be NULL when only the counts are wanted. Returns the
+	number of arguments or an SG_ERROR code. */
+static int parse_string( const char *s, int *pNameLen, int *pVarflag, int *pManaged, int *pStream, int *argtypes )
 {
-	ANYTYPE value;
-	value.d = 0.0;
+	size_t len;
+	const char *pN, *pM, *pEnd;
+	int numargs;
+
+	len = strlen( s );
+	*pVarflag = 0;
+	*pManaged = 0;
+	*pStream = 0;
+	*pNameLen = (int) len;
 
-	*flag = 0;
+	if( len <= 0 )
+		return(0);
 
-	switch( type )
+	if( len < 2 && s[0] != '@' )	// "@" alone turns on response files
 	{
-		case CHAR:
-			if( sscanf( s, "%c", &value.c ) != 1 )
-			{
 #if DEBUG
-				fprintf(stderr," Getval: Bad argument. Expected character\n");
+		fprintf(stderr, "Parse_string: option has zero length <%s> len=%d\n", s, (int) len);
 #endif
-				*flag = -1;
-				return( value );
-			}
-			else  return( value ); 	
-		case SHORT:
-			if( sscanf( s, "%hd", &value.h ) != 1 )
-			{
+		return(SG_ERROR_ZERO_LEN_OPTION);
+	}
+
+	pN = strchr( s, '%' );	/* explicit list implied */
+	if( pN == NULL )
+	{
+		// no arguments to this flag. Assume 1 int to be returned.
+		return( 0 );
+	}
+
+	pM = strchr( s, '*' );	/* variable argument list implied */
+	if( pM != NULL ) *pVarflag = 1;
+
+	pEnd = (pM != NULL && pM < pN) ? pM : pN;
+	if( pEnd - s >= 2 && pEnd[-1] == '+' && (pEnd[-2] == ' ' || pEnd[-2] == '\t') )
+	{
+		*pManaged = 1;	// " +%d" or " +*%d": library-managed array
+		pEnd--;
+	}
+	else if( pEnd - s >= 2 && pEnd[-1] == '>' && (pEnd[-2] == ' ' || pEnd[-2] == '\t') )
+	{
+		*pStream = 1;	// " >*%d": values go to a callback
+		pEnd--;
+	}
+	while( pEnd > s && (pEnd[-1] == ' ' || pEnd[-1] == '\t') ) pEnd--;
+	*pNameLen = (int) (pEnd - s);
+
+	if( (size_t) (pN - s) >= len - 1 )
+	{
 #if DEBUG
-				fprintf(stderr," Getval: Bad argument. Expected short\n");
+		fprintf(stderr, "Parse_String: No formats given in <%s>\n",s);
 #endif
-				*flag = -1;
-				return( value );
-			}
-			else return( value ); 	
-		case INT:
-			if( sscanf( s, "%d", &value.i ) != 1 )
-			{
+		return(SG_ERROR_NO_FORMATS);
+	}
+
+	numargs = parse_format( pN, argtypes );
+	if( numargs > 1 && *pVarflag == 1 )
+	{
 #if DEBUG
-				fprintf(stderr," Getval: Bad argument. Expected integer\n");
+		fprintf(stderr,"Incorrect var arg list\n");
 #endif
-				*flag = -1;
-				return( value );
-			}
-			else return( value ); 	
-		case FLOAT:
-			if( sscanf( s, "%f", &value.f ) != 1 )
-			{
+		return(SG_ERROR_MIXED_TYPES_IN_VAR);
+	}
+	if( numargs > 1 && *pManaged == 1 )
+	{
 #if DEBUG
-				fprintf(stderr," Getval: Bad argument. Expected float\n");
+		fprintf(stderr,"Managed array option takes one format\n");
 #endif
-				*flag = -1;
-				return( value );
-			}
-			else return( value ); 	
-		case DOUBLE:
-			if( sscanf( s, "%lf", &value.d ) != 1 )
-			{
+		return(SG_ERROR_BAD_FORMAT);
+	}
+	if( *pStream == 1 && *pVarflag == 0 )
+	{
 #if DEBUG
-				fprintf(stderr," Getval: Bad argument. Expected double\n");
+		fprintf(stderr,"Only var arg lists can be streamed\n");
 #endif
-				*flag = -1;
-				return( value );
-			}
-			else return( value ); 	
-		case STRING:
-			//strcpy( value.string, s );
-			value.string = s;
-			return( value );
-		default:
+		return(SG_ERROR_BAD_FORMAT);
+	}
+
+	return( numargs );
+}
+
+static const struct
+{
+	const char *format;
+	int type;
+} formatTypes[] =
+{
+	{ "lld", SG_TYPE_LLONG },
+	{ "llu", SG_TYPE_ULLONG },
+	{ "lf", DOUBLE },
+	{ "hd", SHORT },
+	{ "zu", SG_TYPE_SIZE },
+	{ "f", FLOAT },
+	{ "c", CHAR },
+	{ "d", INT },
+	{ "u", SG_TYPE_UINT },
+	{ "x", SG_TYPE_HEX },
+	{ "s", STRING },
+	{ "B", SG_TYPE_BYTES },
+	{ "T", SG_TYPE_DURATION }
+};
+
+static int parse_format( const char *s, int *argtypes )
+{
+	int i, numargs;
+	size_t n;
+
+	if( *s != '%' )
+	{
+#if DEBUG
+		fprintf(stderr, "Bad format in <%s>. No %% sign.\n", s);
+#endif
+		return(SG_ERROR_BAD_FORMAT);
+	}
+
+	for( numargs = 0 ; s != NULL ; s = strchr( s, '%' ) )
+	{
+		while( *s == '%' ) s++;	// empty conversions are skipped, as strtok() did
+		if( *s == '\0' ) break;
+
+		for( i = 0 ; i < (int) (sizeof(formatTypes) / sizeof(formatTypes[0])) ; i++ )
+		{
+			n = strlen( formatTypes[i].format );
+			if( strncmp( s, formatTypes[i].format, n ) == 0 ) break;
+		}
+		if( i == (int) (sizeof(formatTypes) / sizeof(formatTypes[0])) )
+		{
 #if DEBUG
-			fprintf(stderr, "Getval: Bad argument type %d\n",type);
+			fprintf(stderr, "Parse_Format: Bad format <%%%s>\n",s);
 #endif
-			*flag = -1;
-			return( value );
-	} 	
+			return(SG_ERROR_BAD_FORMAT_TYPE);
+		}
+
+		if( argtypes != NULL ) argtypes[numargs] = formatTypes[i].type;
+		numargs++;
+	}
+
+	return( numargs );
+}
+
+#define HASH_SEED 0xcbf29ce484222325ULL
+#define HASH_MAXDISP 65536	/* displacements tried per bucket before the table is made sparser */
+
+static unsigned long long mix_hash( unsigned long long h )
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return( h );
 }
 
-static char myread_char(char *s, int *flag)
+/* FNV-1a over the name, stopping early once it is longer than any option */
+static unsigned long long hash_name( const char *s, int maxLen, int *pLen )
 {
-	char x;
-	*flag = 0;
-	if( sscanf( s, "%c", &x ) != 1 || strlen(s) > 1 )
+	unsigned long long h = HASH_SEED;
+	register const unsigned char *p = (const unsigned char *) s;
+
+	while( *p != '\0' )
 	{
-		*flag = -1;
+		if( p - (const unsigned char *) s >= maxLen )
+		{
+			*pLen = -1;
+			return( 0 );
+		}
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
 	}
-	return( x );
-} 	
-static short myread_short(char *s, int *flag)
+	*pLen = (int) (p - (const unsigned char *) s);
+	return( mix_hash( h ) );
+}
+
+static unsigned int hash_slot( unsigned long long h, unsigned int d, unsigned int mask )
+{
+	return( (unsigned int) mix_hash( h ^ ((unsigned long long) d * 0x9e3779b97f4a7c15ULL) ) & mask );
+}
+
+struct sg_hashkey_s
 {
-	short x;
-	*flag = 0;
-	if( sscanf( s, "%hd", &x ) != 1 )
+	unsigned long long h;
+	unsigned int bucket;
+	int option;
+};
+
+struct sg_hashbucket_s
+{
+	int first;
+	int size;
+};
+
+static int compare_keys( const void *a, const void *b )
+{
+	const struct sg_hashkey_s *x = (const struct sg_hashkey_s *) a, *y = (const struct sg_hashkey_s *) b;
+
+	if( x->bucket != y->bucket ) return( x->bucket < y->bucket ? -1 : 1 );
+	if( x->h != y->h ) return( x->h < y->h ? -1 : 1 );
+	return( x->option - y->option );
+}
+
+static int compare_buckets( const void *a, const void *b )
+{
+	// biggest buckets first, while the table is still mostly empty
+	return( ((const struct sg_hashbucket_s *) b)->size - ((const struct sg_hashbucket_s *) a)->size );
+}
+
+/* Fills the spec's slot and displacement tables. Returns -1 if some bucket
+	found no free placement at this table size, so the caller can retry
+	with a sparser table. */
+static int build_hash( SG_SPEC *spec )
+{
+	int n = spec->optnum;
+	struct sg_hashkey_s *keys;
+	struct sg_hashbucket_s *buckets;
+	unsigned int *placed;
+	unsigned int d, s;
+	int i, k, m, b, nb, len;
+
+	spec->maxNameLen = 0;
+	memset( spec->firstBytes, 0, sizeof(spec->firstBytes) );
+	for( i = 0 ; i < n ; i++ )
 	{
-		*flag = -1;
+		const unsigned char c = (unsigned char) spec->optionlist[i].name[0];
+
+		if( spec->optionlist[i].namelen > spec->maxNameLen ) spec->maxNameLen = spec->optionlist[i].namelen;
+		spec->firstBytes[c >> 3] |= (unsigned char) (1 << (c & 7));
 	}
-	return( x );
-} 	
-static int myread_int(char *s, int *flag)
-{
-	int x;
-	*flag = 0;
-	if( sscanf( s, "%d", &x ) != 1 )
+
+	for( s = 0 ; s <= spec->slotMask ; s++ ) spec->slots[s].option = -1;
+	for( s = 0 ; s <= spec->bucketMask ; s++ ) spec->disp[s] = 0;
+
+	keys = (struct sg_hashkey_s *) malloc( (n+1) * sizeof(struct sg_hashkey_s) );
+	buckets = (struct sg_hashbucket_s *) malloc( (n+1) * sizeof(struct sg_hashbucket_s) );
+	placed = (unsigned int *) malloc( (n+1) * sizeof(unsigned int) );
+	if( keys == NULL || buckets == NULL || placed == NULL )
 	{
-		*flag = -1;
+		free( keys ); free( buckets ); free( placed );
+		return( SG_ERROR_NO_MEMORY );
 	}
-	return( x );
-} 	
-static float myread_float(char *s, int *flag)
-{
-	float x;
-	*flag = 0;
-	if( sscanf( s, "%f", &x ) != 1 )
+
+	for( i = 0 ; i < n ; i++ )
+	{
+		keys[i].h = hash_name( spec->optionlist[i].name, spec->maxNameLen + 1, &len );
+		keys[i].bucket = (unsigned int) (keys[i].h & spec->bucketMask);
+		keys[i].option = i;
+	}
+	qsort( keys, n, sizeof(struct sg_hashkey_s), compare_keys );
+
+	// drop repeated names (the first one always won the old linear scan) and group into buckets
+	for( m = 0, nb = 0, i = 0 ; i < n ; i++ )
+	{
+		for( k = m - 1 ; k >= 0 && keys[k].h == keys[i].h ; k-- )
+		{
+			if( strcmp( spec->optionlist[keys[k].option].name, spec->optionlist[keys[i].option].name ) == 0 ) break;
+		}
+		if( k >= 0 && keys[k].h == keys[i].h ) continue;
+
+		if( nb == 0 || keys[buckets[nb-1].first].bucket != keys[i].bucket )
+		{
+			buckets[nb].first = m;
+			buckets[nb].size = 0;
+			nb++;
+		}
+		buckets[nb-1].size++;
+		keys[m++] = keys[i];
+	}
+	qsort( buckets, nb, sizeof(struct sg_hashbucket_s), compare_buckets );
+
+	for( b = 0 ; b < nb ; b++ )
 	{
-		*flag = -1;
+		const struct sg_hashkey_s *bk = &keys[buckets[b].first];
+
+		for( d = 0 ; d < HASH_MAXDISP ; d++ )
+		{
+			for( k = 0 ; k < buckets[b].size ; k++ )
+			{
+				placed[k] = hash_slot( bk[k].h, d, spec->slotMask );
+				if( spec->slots[placed[k]].option >= 0 ) break;
+				for( i = 0 ; i < k && placed[i] != placed[k] ; i++ );
+				if( i < k ) break;
+			}
+			if( k == buckets[b].size ) break;
+		}
+		if( d == HASH_MAXDISP ) break;
+
+		spec->disp[bk[0].bucket] = d;
+		for( k = 0 ; k < buckets[b].size ; k++ )
+		{
+			spec->slots[placed[k]].option = bk[k].option;
+			spec->slots[placed[k]].namelen = spec->optionlist[bk[k].option].namelen;
+		}
 	}
-	return( x );
-} 	
-static double myread_double(char *s, int *flag)
+
+	free( keys ); free( buckets ); free( placed );
+
+	return( b == nb ? 0 : -1 );
+}
+
+static const char *option_name( const SG_SPEC *spec, int sorted )
+{
+	return( spec->optionlist[spec->byName[sorted]].name );
+}
+
+struct sg_namekey_s
+{
+	const char *name;
+	int option;
+};
+
+static int compare_names( const void *a, const void *b )
+{
+	const struct sg_namekey_s *x = (const struct sg_namekey_s *) a, *y = (const struct sg_namekey_s *) b;
+	int n = strcmp( x->name, y->name );
+
+	return( n != 0 ? n : x->option - y->option );
+}
+
+/* Lays out the children of node, which has the names byName[lo..hi) that
+	share its first depth bytes, then their subtrees. Returns the next free
+	node. */
+static int fill_trie( SG_SPEC *spec, int node, int depth, int next )
 {
-	double x;
-	*flag = 0;
-	if( sscanf( s, "%lf", &x ) != 1 )
+	struct sg_trienode_s *t = spec->trie;
+	int i, k, first;
+
+	// the name that ends here, if any, sorts first
+	i = t[node].lo;
+	if( i < t[node].hi && option_name( spec, i )[depth] == '\0' ) i++;
+
+	first = next;
+	t[node].firstChild = first;
+	t[node].numChildren = 0;
+	while( i < t[node].hi )
 	{
-		*flag = -1;
+		const unsigned char c = (unsigned char) option_name( spec, i )[depth];
+
+		for( k = i + 1 ; k < t[node].hi && (unsigned char) option_name( spec, k )[depth] == c ; k++ );
+		t[next].c = c;
+		t[next].lo = i;
+		t[next].hi = k;
+		t[node].numChildren++;
+		next++;
+		i = k;
 	}
-	return( x );
-} 	
- 
-static int check_if_option(char *s, struct optionlist_s *optionlist, int numopts)
+
+	for( k = first ; k < first + t[node].numChildren ; k++ ) next = fill_trie( spec, k, depth + 1, next );
+
+	return( next );
+}
+
+/* Sorts the names into byName and builds the abbreviation trie. */
+static int build_trie( SG_SPEC *spec )
 {
+	struct sg_namekey_s *keys;
+	int i, m;
 
-	register int i;
+	if( SG_ENABLE_PREFIX == 0 )
+	{
+		spec->trie = NULL;
+		return(0);
+	}
 
-	for( i = 0 ; i < numopts ; i++ )
+	keys = (struct sg_namekey_s *) malloc( (spec->optnum+1) * sizeof(struct sg_namekey_s) );
+	if( keys == NULL ) return( SG_ERROR_NO_MEMORY );
+	for( i = 0 ; i < spec->optnum ; i++ )
 	{
-		if( strcmp( s, optionlist[i].name ) == 0 )
-			return( i );
+		keys[i].name = spec->optionlist[i].name;
+		keys[i].option = i;
+	}
+	qsort( keys, spec->optnum, sizeof(struct sg_namekey_s), compare_names );
+
+	// a repeated name keeps its first option, as in the hash
+	for( m = 0, i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( m > 0 && strcmp( option_name( spec, m-1 ), keys[i].name ) == 0 ) continue;
+		spec->byName[m++] = keys[i].option;
+	}
+	free( keys );
+
+	spec->trie[0].c = 0;
+	spec->trie[0].lo = 0;
+	spec->trie[0].hi = m;
+	fill_trie( spec, 0, 0, 1 );
+
+	return(0);
+}
+
+/* The trie node reached by the bytes of s, or NULL when no name starts
+	with s. */
+static const struct sg_trienode_s *find_prefix( const SG_SPEC *spec, const char *s )
+{
+	const struct sg_trienode_s *node = spec->trie, *child;
+	const unsigned char *p;
+	int k;
+
+	for( p = (const unsigned char *) s ; *p != '\0' ; p++ )
+	{
+		child = &spec->trie[node->firstChild];
+		for( k = 0 ; k < node->numChildren && child[k].c < *p ; k++ );
+		if( k == node->numChildren || child[k].c != *p ) return( NULL );
+		node = &child[k];
 	}
 
-	return( -1 );
+	return( node );
+}
+
+/* Abbreviation of a token that is not an option name: the option it
+	starts, -1 if none, SG_ERROR_AMBIGUOUS_OPTION if several. Dashes alone
+	("-", "--") abbreviate nothing. */
+static int match_prefix( const SG_SPEC *spec, const char *s )
+{
+	const struct sg_trienode_s *node;
+	const char *p;
+
+	for( p = s ; *p == '-' ; p++ );
+	if( *p == '\0' ) return( -1 );
+
+	node = find_prefix( spec, s );
+	if( node == NULL ) return( -1 );
+	if( node->hi - node->lo == 1 ) return( spec->byName[node->lo] );
+
+	return( SG_ERROR_AMBIGUOUS_OPTION );
+}
+
+void superPrefixOpt( SG_SPEC *spec, int enable )
+{
+	spec->prefixes = enable && spec->trie != NULL;
+}
+
+int superPrefixMatches( const SG_SPEC *spec, const char *prefix, const char **names, int max )
+{
+	const struct sg_trienode_s *node;
+	int i;
+
+	if( spec->trie == NULL ) return(0);
+
+	node = find_prefix( spec, prefix );
+	if( node == NULL ) return(0);
+
+	for( i = node->lo ; i < node->hi && i - node->lo < max ; i++ ) names[i - node->lo] = option_name( spec, i );
+
+	return( node->hi - node->lo );
+}
+
+/* returns the option index for s, -1 if s is not an option name or an
+	abbreviation of one, or SG_ERROR_AMBIGUOUS_OPTION */
+static int check_if_option( const SG_SPEC *spec, const char *s, SG_STATS *stats )
+{
+	int i = lookup_name( spec, s, stats );
+
+	if( i < 0 && spec->prefixes ) i = match_prefix( spec, s );
+
+	return( i );
+}
+
+/* 0 if s is surely neither an option name nor an abbreviation of one;
+	cheaper than check_if_option() for tokens that fall off the trie early */
+static int may_be_option( const SG_SPEC *spec, const char *s, SG_STATS *stats )
+{
+	const unsigned char c = (unsigned char) s[0];
+
+	if( (spec->firstBytes[c >> 3] & (1 << (c & 7))) == 0 ) return(0);
+	if( spec->prefixes ) return( find_prefix( spec, s ) != NULL );
+
+	return( lookup_name( spec, s, stats ) >= 0 );
+}
+
+/* returns the option index for s, or -1 if s is not an option name */
+static int lookup_name( const SG_SPEC *spec, const char *s, SG_STATS *stats )
+{
+	const unsigned char c = (unsigned char) s[0];
+	const struct sg_hashslot_s *slot;
+	unsigned long long h;
+	int len;
+
+	SG_STAT( stats->lookups++ );
+	if( (spec->firstBytes[c >> 3] & (1 << (c & 7))) == 0 ) return( -1 );
+
+	h = hash_name( s, spec->maxNameLen, &len );
+	if( len < 0 ) return( -1 );
+	SG_STAT( stats->lookupProbes++ );
+
+	slot = &spec->slots[hash_slot( h, spec->disp[h & spec->bucketMask], spec->slotMask )];
+	if( slot->option < 0 || slot->namelen != len ) return( -1 );
+	if( memcmp( s, spec->optionlist[slot->option].name, len ) != 0 ) return( -1 );
+
+	return( slot->option );
 }
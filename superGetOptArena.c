@@ -0,0 +1,182 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Arenas for library-managed result arrays (the "+" formats). Memory
+	comes from a list of chunks and is only given back by superResetArena(),
+	which keeps the chunks for the next parse, or superFreeArena(). An array
+	that has to grow is extended in place when it is the newest allocation
+	of its chunk, otherwise it moves to twice its size; either way appending
+	n values costs O(n) and at most half the array's space is ever slack. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+
+#define CHUNK_MIN 4096
+#define ALIGN 16
+#define ARRAY_MIN 64	// bytes in a fresh array
+
+struct sg_chunk_s
+{
+	struct sg_chunk_s *next;
+	size_t size;	// usable bytes after the header
+	size_t used;
+	double align[1];	// data starts here
+};
+
+struct sg_arena_s
+{
+	struct sg_chunk_s *first;
+	struct sg_chunk_s *cur;
+	char *top;		// start of the newest allocation in cur
+	SG_FILE *files;	// response files whose tokens results may point into
+};
+
+/* in front of every array: its capacity in bytes, padded to ALIGN */
+typedef union
+{
+	size_t capacity;
+	char pad[ALIGN];
+} ARRAYHEAD;
+
+#define CHUNK_DATA( c ) ((char *) (c)->align)
+#define ROUND_UP( n ) (((n) + ALIGN - 1) & ~(size_t) (ALIGN - 1))
+
+int superNewArena( SG_ARENA **pArena )
+{
+	*pArena = (SG_ARENA *) calloc( 1, sizeof(SG_ARENA) );
+	if( *pArena == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	return(0);
+}
+
+void superResetArena( SG_ARENA *arena )
+{
+	struct sg_chunk_s *c;
+
+	for( c = arena->first ; c != NULL ; c = c->next ) c->used = 0;
+	arena->cur = arena->first;
+	arena->top = NULL;
+	sg_file_close_all( &arena->files );
+}
+
+void superFreeArena( SG_ARENA *arena )
+{
+	struct sg_chunk_s *c, *next;
+
+	if( arena == NULL ) return;
+
+	sg_file_close_all( &arena->files );
+	for( c = arena->first ; c != NULL ; c = next )
+	{
+		next = c->next;
+		free( c );
+	}
+	free( arena );
+}
+
+void sg_arena_keep_file( SG_ARENA *arena, SG_FILE *file )
+{
+	sg_file_push( &arena->files, file );
+}
+
+static void *arena_alloc( SG_ARENA *arena, size_t n )
+{
+	struct sg_chunk_s *c, *last;
+	char *p;
+
+	n = ROUND_UP( n );
+
+	// the current chunk, then any emptied chunk after it
+	for( c = arena->cur ; c != NULL ; c = c->next )
+	{
+		if( c->size - c->used >= n ) break;
+	}
+
+	if( c == NULL )
+	{
+		size_t size = CHUNK_MIN;
+
+		for( last = arena->first ; last != NULL && last->next != NULL ; last = last->next );
+		if( last != NULL && last->size >= size ) size = 2 * last->size;
+		if( size < n ) size = n;
+
+		c = (struct sg_chunk_s *) malloc( sizeof(struct sg_chunk_s) + size );
+		if( c == NULL ) return( NULL );
+		c->next = NULL;
+		c->size = size;
+		c->used = 0;
+		if( last != NULL ) last->next = c;
+		else arena->first = c;
+	}
+
+	arena->cur = c;
+	p = CHUNK_DATA( c ) + c->used;
+	c->used += n;
+	arena->top = p;
+
+	return( p );
+}
+
+/* Returns array (or its new location) with room for need bytes, NULL when
+	out of memory. array is NULL for a new one. */
+void *sg_arena_grow( SG_ARENA *arena, void *array, size_t used, size_t need )
+{
+	ARRAYHEAD *head;
+	size_t capacity;
+	char *p;
+
+	if( array != NULL )
+	{
+		head = (ARRAYHEAD *) array - 1;
+		if( need <= head->capacity ) return( array );
+
+		capacity = 2 * head->capacity;
+		if( capacity < need ) capacity = need;
+		capacity = ROUND_UP( capacity );
+
+		// newest allocation in its chunk: just move the chunk's end
+		if( (char *) head == arena->top && arena->cur->size - (arena->top - CHUNK_DATA( arena->cur )) >= sizeof(ARRAYHEAD) + capacity )
+		{
+			arena->cur->used = (arena->top - CHUNK_DATA( arena->cur )) + sizeof(ARRAYHEAD) + capacity;
+			head->capacity = capacity;
+			return( array );
+		}
+	}
+	else
+	{
+		capacity = ROUND_UP( need > ARRAY_MIN ? need : ARRAY_MIN );
+	}
+
+	p = (char *) arena_alloc( arena, sizeof(ARRAYHEAD) + capacity );
+	if( p == NULL ) return( NULL );
+
+	head = (ARRAYHEAD *) p;
+	head->capacity = capacity;
+	if( array != NULL ) memcpy( head + 1, array, used );
+
+	return( head + 1 );
+}
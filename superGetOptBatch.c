@@ -0,0 +1,221 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* superParseBatch(): a small work-stealing pool. Every worker owns a
+	contiguous range of records packed into one 64-bit word (lo, hi). The
+	owner takes a few records at a time off the front; an idle worker
+	steals the back half of somebody else's range. Both sides move the
+	range with compare-and-swap, and an index is handed out only once, so
+	a stale (lo, hi) pair can never reappear. */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "superGetOptInt.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define MAX_GRAIN 64	// records per local take
+#define CACHE_LINE 64
+
+struct sg_worker_s
+{
+	uint64_t range;	// lo in the low half, hi in the high half
+	int id;
+	struct sg_batch_s *batch;
+#ifndef _WIN32
+	pthread_t thread;
+#endif
+	char pad[CACHE_LINE];
+};
+
+struct sg_batch_s
+{
+	const SG_SPEC *spec;
+	SG_RECORD *records;
+	void *origin;
+	size_t size;
+	int grain;
+	int numWorkers;
+	struct sg_worker_s *workers;
+	int failed;	// records with status < 0
+};
+
+static void *run_worker( void *arg );
+static void parse_range( struct sg_batch_s *batch, int lo, int hi );
+
+#define PACK( lo, hi ) ((uint64_t) (uint32_t) (lo) | ((uint64_t) (uint32_t) (hi) << 32))
+#define RANGE_LO( r ) ((int) (uint32_t) (r))
+#define RANGE_HI( r ) ((int) ((r) >> 32))
+
+int superParseBatch( const SG_SPEC *spec, SG_RECORD *records, int numRecords, void *origin, size_t size, int numThreads )
+{
+	struct sg_batch_s batch;
+	int i, started;
+
+	if( numRecords <= 0 ) return(0);
+
+	// a record's arrays would need an arena that outlives the batch
+	if( sg_spec_needs_arena( spec ) ) return( SG_ERROR_NO_ARENA );
+
+#ifndef _WIN32
+	if( numThreads <= 0 ) numThreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	if( numThreads <= 0 ) numThreads = 1;
+	if( numThreads > numRecords ) numThreads = numRecords;
+
+	batch.spec = spec;
+	batch.records = records;
+	batch.origin = origin;
+	batch.size = size;
+	batch.failed = 0;
+
+	// small takes near the end keep the tail balanced, large ones keep CAS traffic down
+	batch.grain = numRecords / (numThreads * 16);
+	if( batch.grain < 1 ) batch.grain = 1;
+	if( batch.grain > MAX_GRAIN ) batch.grain = MAX_GRAIN;
+
+	if( numThreads == 1 )
+	{
+		parse_range( &batch, 0, numRecords );
+		return( batch.failed );
+	}
+
+	batch.workers = (struct sg_worker_s *) calloc( numThreads, sizeof(struct sg_worker_s) );
+	if( batch.workers == NULL ) return( SG_ERROR_NO_MEMORY );
+	batch.numWorkers = numThreads;
+
+	for( i = 0 ; i < numThreads ; i++ )
+	{
+		batch.workers[i].id = i;
+		batch.workers[i].batch = &batch;
+		batch.workers[i].range = PACK( (long long) numRecords * i / numThreads, (long long) numRecords * (i + 1) / numThreads );
+	}
+
+	// the caller is worker 0; a worker that cannot start has its range stolen
+	started = 1;
+#ifndef _WIN32
+	for( i = 1 ; i < numThreads ; i++ )
+	{
+		if( pthread_create( &batch.workers[i].thread, NULL, run_worker, &batch.workers[i] ) != 0 ) break;
+		started++;
+	}
+#endif
+	run_worker( &batch.workers[0] );
+#ifndef _WIN32
+	for( i = 1 ; i < started ; i++ ) pthread_join( batch.workers[i].thread, NULL );
+#endif
+	// anything left behind by workers that never started
+	for( i = started ; i < numThreads ; i++ )
+	{
+		parse_range( &batch, RANGE_LO( batch.workers[i].range ), RANGE_HI( batch.workers[i].range ) );
+	}
+
+	free( batch.workers );
+
+	return( batch.failed );
+}
+
+static void *run_worker( void *arg )
+{
+	struct sg_worker_s *self = (struct sg_worker_s *) arg;
+	struct sg_batch_s *batch = self->batch;
+	uint64_t r;
+	int lo, hi, n, v, k;
+
+	for( ;; )
+	{
+		// drain our own range from the front
+		r = __atomic_load_n( &self->range, __ATOMIC_ACQUIRE );
+		lo = RANGE_LO( r );
+		hi = RANGE_HI( r );
+		if( lo < hi )
+		{
+			n = hi - lo < batch->grain ? hi - lo : batch->grain;
+			if( __atomic_compare_exchange_n( &self->range, &r, PACK( lo + n, hi ), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+			{
+				parse_range( batch, lo, lo + n );
+			}
+			continue;
+		}
+
+		// out of work: steal the back half of the first non-empty range
+		for( k = 1 ; k < batch->numWorkers ; k++ )
+		{
+			struct sg_worker_s *victim = &batch->workers[(self->id + k) % batch->numWorkers];
+
+			r = __atomic_load_n( &victim->range, __ATOMIC_ACQUIRE );
+			lo = RANGE_LO( r );
+			hi = RANGE_HI( r );
+			while( lo < hi )
+			{
+				v = lo + (hi - lo) / 2;
+				if( __atomic_compare_exchange_n( &victim->range, &r, PACK( lo, v ), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+				{
+					__atomic_store_n( &self->range, PACK( v, hi ), __ATOMIC_RELEASE );
+					break;
+				}
+				lo = RANGE_LO( r );
+				hi = RANGE_HI( r );
+			}
+			if( lo < hi ) break;
+		}
+		if( k == batch->numWorkers ) break;	// everything is taken
+	}
+
+	return( NULL );
+}
+
+static void parse_range( struct sg_batch_s *batch, int lo, int hi )
+{
+	SG_CTX ctx;
+	SG_RECORD *rec;
+	int i, failed = 0;
+
+	for( i = lo ; i < hi ; i++ )
+	{
+		rec = &batch->records[i];
+		superInitCtx( &ctx, batch->spec, batch->origin, rec->out, batch->size );
+		ctx.parallelMin = 0;	// the records already keep every thread busy
+
+		if( rec->argc <= 0 || rec->argv == NULL )
+		{
+			// an empty record is not a request for the usage message
+			sg_reset_outputs( &ctx );
+			rec->status = 0;
+			rec->lastArg = 0;
+		}
+		else
+		{
+			rec->status = superParseOptCtx( &ctx, rec->argc, rec->argv, &rec->lastArg );
+		}
+		if( rec->status < 0 ) failed++;
+	}
+
+	if( failed ) __atomic_fetch_add( &batch->failed, failed, __ATOMIC_RELAXED );
+}
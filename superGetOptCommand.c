@@ -0,0 +1,334 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Command interpreters. A command set is one heap block: the names, a
+	power-of-two table of command indices probed linearly from each name's
+	FNV-1a hash, and the caller's specs. A command line is tokenized in
+	place through an SG_FILE on the stack and its words after the first go
+	straight to sg_parse_stream(), so a parse allocates nothing beyond what
+	the spec itself needs and never looks at a format string. The set is
+	not modified after it is built and can be shared between threads.
+
+	Subcommand sets find their word through a command set with no specs
+	and keep the caller's option tables instead. A subcommand's table is
+	compiled the first time it is chosen and the spec published with a
+	compare-and-swap, as superUsageText() publishes its text; a thread
+	that loses the race frees its own copy. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+struct sg_commands_s
+{
+	int num;
+	unsigned int mask;
+	int *slots;		// command index, -1 if the slot is empty
+	const char **names;
+	const SG_SPEC **specs;
+};
+
+struct sg_subcommands_s
+{
+	int num;
+	const SG_SUBCOMMAND *subs;	// the caller's table
+	SG_COMMANDS *index;
+	SG_SPEC **specs;	// by subcommand, NULL until first chosen
+	int nameWidth;		// of the longest name, for the listing
+};
+
+static unsigned int name_hash( const char *s );
+static int find_command( const SG_COMMANDS *cmds, const char *word );
+static char *command_token( void *state );
+
+int superCompileCommands( SG_COMMANDS **pCmds, const char * const *names, SG_SPEC * const *specs, int num )
+{
+	SG_COMMANDS *cmds;
+	unsigned int size, h;
+	size_t bytes = 0;
+	char *p;
+	int i;
+
+	*pCmds = NULL;
+	if( num <= 0 ) return( SG_ERROR_NO_FORMATS );
+	for( i = 0 ; i < num ; i++ )
+	{
+		if( names[i] == NULL || names[i][0] == '\0' ) return( SG_ERROR_ZERO_LEN_OPTION );
+		bytes += strlen( names[i] ) + 1;
+	}
+	for( size = 4 ; size < 2 * (unsigned int) num ; size *= 2 );
+
+	cmds = (SG_COMMANDS *) malloc( sizeof(SG_COMMANDS) + size * sizeof(int) + num * (sizeof(char *) + sizeof(SG_SPEC *)) + bytes );
+	if( cmds == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	cmds->num = num;
+	cmds->mask = size - 1;
+	cmds->names = (const char **) (cmds + 1);
+	cmds->specs = (const SG_SPEC **) (cmds->names + num);
+	cmds->slots = (int *) (cmds->specs + num);
+	p = (char *) (cmds->slots + size);
+	for( h = 0 ; h < size ; h++ ) cmds->slots[h] = -1;
+
+	for( i = 0 ; i < num ; i++ )
+	{
+		if( find_command( cmds, names[i] ) >= 0 )
+		{
+#if DEBUG
+			fprintf(stderr,"superCompileCommands: command <%s> given twice\n",names[i]);
+#endif
+			free( cmds );
+			return( SG_ERROR_BAD_FORMAT );
+		}
+
+		strcpy( p, names[i] );
+		cmds->names[i] = p;
+		cmds->specs[i] = specs[i];
+		p += strlen( p ) + 1;
+
+		for( h = name_hash( names[i] ) & cmds->mask ; cmds->slots[h] >= 0 ; h = (h + 1) & cmds->mask );
+		cmds->slots[h] = i;
+	}
+
+	*pCmds = cmds;
+
+	return(0);
+}
+
+void superFreeCommands( SG_COMMANDS *cmds )
+{
+	free( cmds );
+}
+
+int superCommandLookup( const SG_COMMANDS *cmds, const char *name )
+{
+	return( find_command( cmds, name ) );
+}
+
+int superParseCommand( const SG_COMMANDS *cmds, SG_CTX *ctx, char *line, int *pCommand, int *lastArg )
+{
+	SG_FILE file;
+	char *word;
+	int c, n;
+
+	*pCommand = -1;
+	*lastArg = 0;
+
+	sg_file_buffer( &file, line, strlen( line ) );
+	word = sg_file_line_token( &file );
+	if( word == NULL ) return( sg_file_error( &file ) );	// nothing but blanks or a comment
+
+	c = find_command( cmds, word );
+	if( c < 0 ) return( SG_ERROR_UNKNOWN_COMMAND );
+	*pCommand = c;
+
+	ctx->spec = cmds->specs[c];
+	if( sg_begin_parse( ctx ) < 0 ) return( SG_ERROR_NO_MEMORY );
+	sg_reset_outputs( ctx );
+	SG_STAT( ctx->stats.parses++ );
+
+	n = sg_parse_stream( ctx, command_token, &file, lastArg );
+	if( sg_file_error( &file ) < 0 ) return( sg_file_error( &file ) );
+
+	return( n );
+}
+
+int superNewSubcommands( SG_SUBCOMMANDS **pSet, const SG_SUBCOMMAND *subs, int num )
+{
+	SG_SUBCOMMANDS *set;
+	const char **names;
+	int i, n;
+
+	*pSet = NULL;
+	if( num <= 0 ) return( SG_ERROR_NO_FORMATS );
+
+	set = (SG_SUBCOMMANDS *) calloc( 1, sizeof(SG_SUBCOMMANDS) + num * sizeof(SG_SPEC *) );
+	names = (const char **) malloc( num * sizeof(char *) );
+	if( set == NULL || names == NULL )
+	{
+		free( set );
+		free( names );
+		return( SG_ERROR_NO_MEMORY );
+	}
+
+	set->num = num;
+	set->subs = subs;
+	set->specs = (SG_SPEC **) (set + 1);
+	for( i = 0 ; i < num ; i++ )
+	{
+		names[i] = subs[i].name;
+		if( subs[i].name != NULL && (int) strlen( subs[i].name ) > set->nameWidth ) set->nameWidth = (int) strlen( subs[i].name );
+	}
+
+	n = superCompileCommands( &set->index, names, set->specs, num );
+	free( names );
+	if( n < 0 )
+	{
+		free( set );
+		return( n );
+	}
+
+	*pSet = set;
+
+	return(0);
+}
+
+void superFreeSubcommands( SG_SUBCOMMANDS *set )
+{
+	int i;
+
+	if( set == NULL ) return;
+
+	for( i = 0 ; i < set->num ; i++ ) superFreeOpt( set->specs[i] );
+	superFreeCommands( set->index );
+	free( set );
+}
+
+int superSubcommandSpec( const SG_SUBCOMMANDS *set, int command, const SG_SPEC **pSpec, int *lastArg )
+{
+	SG_SUBCOMMANDS *cache = (SG_SUBCOMMANDS *) set;	// the specs are a cache
+	SG_SPEC *spec, *expected = NULL;
+	int n;
+
+	*pSpec = NULL;
+	*lastArg = 0;
+	if( command < 0 || command >= set->num ) return( SG_ERROR_UNKNOWN_COMMAND );
+
+	spec = __atomic_load_n( &cache->specs[command], __ATOMIC_ACQUIRE );
+	if( spec == NULL )
+	{
+		n = superCompileTable( &spec, set->subs[command].options, set->subs[command].numOptions, lastArg );
+		if( n < 0 ) return( n );
+
+		if( !__atomic_compare_exchange_n( &cache->specs[command], &expected, spec, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+		{
+			superFreeOpt( spec );
+			spec = expected;
+		}
+	}
+	*pSpec = spec;
+
+	return(0);
+}
+
+int superParseSubcommand( const SG_SUBCOMMANDS *set, SG_CTX *ctx, int argc, char **argv, int *pCommand, int *lastArg )
+{
+	const SG_SPEC *spec;
+	int c, n;
+
+	*pCommand = -1;
+	*lastArg = 0;
+	if( argv == NULL || argc < 2 ) return( SG_ERROR_PRINT_USAGE );
+
+	c = superCommandLookup( set->index, argv[1] );
+	if( c < 0 ) return( SG_ERROR_UNKNOWN_COMMAND );
+	*pCommand = c;
+
+	n = superSubcommandSpec( set, c, &spec, lastArg );
+	if( n < 0 ) return( n );
+	ctx->spec = spec;
+
+	if( argc > 2 ) return( superParseOptCtx( ctx, argc - 2, argv + 2, lastArg ) );
+
+	// no words after the subcommand: just the defaults
+	if( sg_begin_parse( ctx ) < 0 ) return( SG_ERROR_NO_MEMORY );
+	sg_reset_outputs( ctx );
+	SG_STAT( ctx->stats.parses++ );
+
+	return(0);
+}
+
+int superWriteSubcommands( const SG_SUBCOMMANDS *set, int fd )
+{
+	size_t len = 0, done;
+	char *text;
+	long n;
+	int i;
+
+	for( i = 0 ; i < set->num ; i++ ) len += set->nameWidth + 4 + (set->subs[i].help != NULL ? strlen( set->subs[i].help ) : 0);
+	text = (char *) malloc( len + 1 );
+	if( text == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	for( len = 0, i = 0 ; i < set->num ; i++ )
+	{
+		len += sprintf( text + len, "  %-*s %s\n", set->nameWidth, set->subs[i].name, set->subs[i].help != NULL ? set->subs[i].help : "" );
+	}
+
+	if( fd == 1 ) fflush( stdout );
+	else if( fd == 2 ) fflush( stderr );
+
+	for( done = 0 ; done < len ; done += (size_t) n )
+	{
+		n = (long) write( fd, text + done, len - done );
+		if( n <= 0 )
+		{
+			free( text );
+			return( SG_ERROR_FILE );
+		}
+	}
+	free( text );
+
+	return(0);
+}
+
+/* FNV-1a, folded to the table's width */
+static unsigned int name_hash( const char *s )
+{
+	unsigned long long h = 14695981039346656037ULL;
+
+	for( ; *s != '\0' ; s++ )
+	{
+		h ^= (unsigned char) *s;
+		h *= 1099511628211ULL;
+	}
+
+	return( (unsigned int) (h ^ (h >> 32)) );
+}
+
+static int find_command( const SG_COMMANDS *cmds, const char *word )
+{
+	unsigned int h;
+	int i;
+
+	for( h = name_hash( word ) & cmds->mask ; (i = cmds->slots[h]) >= 0 ; h = (h + 1) & cmds->mask )
+	{
+		if( strcmp( cmds->names[i], word ) == 0 ) return( i );
+	}
+
+	return( -1 );
+}
+
+/* the words of the command's first line only */
+static char *command_token( void *state )
+{
+	return( sg_file_line_token( (SG_FILE *) state ) );
+}
@@ -0,0 +1,400 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Token conversion, one converter per SG_TYPE_*. A converter takes the
+	whole token or nothing: it stores the value and returns 0, or returns
+	-1 and leaves the output alone. The parser calls through
+	sg_converters[] (fixed arguments) and sg_list_converters[] (var-arg
+	lists, which may use the SIMD digit kernel), so a new type is a new
+	row in these tables and costs the existing ones nothing. Nothing here
+	uses the locale or stdio, and every converter is safe on any thread. */
+
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include "superGetOptInt.h"
+
+
+/* Signed integers. The whole token must be an optional sign followed by
+	decimal digits; anything else, or a value outside [lo, hi], fails. No
+	locale, no stdio. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SG_SIMD_DIGITS 1
+#include <immintrin.h>
+
+static const unsigned char alignDigits[32] =
+{
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+/* Converts the leading run of up to 15 digits of s in one 16-byte pass.
+	Returns the number of digits, or -1 if the run is 16+ digits long (the
+	caller falls back to scalar). The load may run past the token's NUL,
+	but never into the next page: a token within 16 bytes of a page end is
+	copied into a zeroed buffer first. The sanitizers would flag the bytes
+	past the NUL, which are read but never used. */
+__attribute__((target("ssse3"), no_sanitize_address, no_sanitize_thread))
+static int read_digits_ssse3( const char *s, unsigned long long *pValue )
+{
+	char buf[16] = { 0 };
+	__m128i v, d, hi, lo;
+	unsigned int mask;
+	size_t n;
+	int len;
+
+	if( ((uintptr_t) s & 4095) > 4096 - 16 )
+	{
+		for( n = 0 ; n < sizeof(buf) && s[n] != '\0' ; n++ ) buf[n] = s[n];
+		s = buf;
+	}
+
+	v = _mm_loadu_si128( (const __m128i *) s );
+	lo = _mm_cmplt_epi8( v, _mm_set1_epi8( '0' ) );
+	hi = _mm_cmpgt_epi8( v, _mm_set1_epi8( '9' ) );
+	mask = (unsigned int) _mm_movemask_epi8( _mm_or_si128( lo, hi ) );
+	if( mask == 0 ) return( -1 );
+	len = __builtin_ctz( mask );
+
+	// right-align the digits so that lane 15 is the units digit, zeros in front
+	d = _mm_sub_epi8( v, _mm_set1_epi8( '0' ) );
+	d = _mm_shuffle_epi8( d, _mm_loadu_si128( (const __m128i *) (alignDigits + len) ) );
+
+	d = _mm_maddubs_epi16( d, _mm_setr_epi8( 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1 ) );
+	d = _mm_madd_epi16( d, _mm_setr_epi16( 100, 1, 100, 1, 100, 1, 100, 1 ) );
+	d = _mm_packs_epi32( d, d );
+	d = _mm_madd_epi16( d, _mm_setr_epi16( 10000, 1, 10000, 1, 10000, 1, 10000, 1 ) );
+
+	*pValue = (unsigned long long) (unsigned int) _mm_cvtsi128_si32( d ) * 100000000ULL
+		+ (unsigned int) _mm_cvtsi128_si32( _mm_srli_si128( d, 4 ) );
+
+	return( len );
+}
+
+/* __builtin_cpu_supports() reads the CPU model libgcc filled in at start-up */
+static int have_ssse3( void )
+{
+	return( __builtin_cpu_supports( "ssse3" ) ? 1 : 0 );
+}
+#endif
+
+static int read_integer( const char *s, long long lo, long long hi, int simd, long long *pValue )
+{
+	unsigned long long value = 0, limit;
+	const char *p = s;
+	int negative = 0;
+	int n;
+
+	if( *p == '-' || *p == '+' )
+	{
+		negative = (*p == '-');
+		p++;
+	}
+	limit = negative ? (unsigned long long) -(lo + 1) + 1 : (unsigned long long) hi;
+
+#ifdef SG_SIMD_DIGITS
+	if( simd && have_ssse3() && (n = read_digits_ssse3( p, &value )) >= 0 )
+	{
+		// 15 digits cannot overflow the accumulator, only the target type
+		if( n == 0 || p[n] != '\0' || value > limit ) return( -1 );
+		*pValue = negative ? (long long) (0 - value) : (long long) value;
+		return( 0 );
+	}
+	value = 0;
+#endif
+
+	for( n = 0 ; *p >= '0' && *p <= '9' ; p++, n++ )
+	{
+		if( value > (limit - (unsigned long long) (*p - '0')) / 10 ) return( -1 );
+		value = value * 10 + (unsigned long long) (*p - '0');
+	}
+	if( n == 0 || *p != '\0' ) return( -1 );
+
+	*pValue = negative ? (long long) (0 - value) : (long long) value;
+	return( 0 );
+}
+
+
+static unsigned int digit_value( char c )
+{
+	if( c >= '0' && c <= '9' ) return( (unsigned int) (c - '0') );
+	if( c >= 'a' && c <= 'f' ) return( (unsigned int) (c - 'a' + 10) );
+	if( c >= 'A' && c <= 'F' ) return( (unsigned int) (c - 'A' + 10) );
+	return( 99 );
+}
+
+/* Unsigned integers: decimal digits, or hex digits after 0x. With hex
+	set the digits are always hex and the 0x is optional. No sign. */
+static int read_unsigned( const char *s, unsigned long long hi, int hex, unsigned long long *pValue )
+{
+	unsigned long long value = 0;
+	const char *p = s;
+	unsigned int base = hex ? 16 : 10, d;
+	int n;
+
+	if( p[0] == '0' && (p[1] == 'x' || p[1] == 'X') )
+	{
+		base = 16;
+		p += 2;
+	}
+
+	for( n = 0 ; (d = digit_value( *p )) < base ; p++, n++ )
+	{
+		if( value > (hi - d) / base ) return( -1 );
+		value = value * base + d;
+	}
+	if( n == 0 || *p != '\0' ) return( -1 );
+
+	*pValue = value;
+	return( 0 );
+}
+
+/* A decimal number with an optional fraction at *pp, as whole plus
+	frac / scale (fraction digits past the 18th are dropped). Moves *pp
+	past it; -1 if there are no digits or the whole part overflows. */
+static int scan_decimal( const char **pp, unsigned long long *pWhole, unsigned long long *pFrac, unsigned long long *pScale )
+{
+	const char *p = *pp;
+	unsigned long long whole = 0, frac = 0, scale = 1;
+	int n = 0;
+
+	for( ; *p >= '0' && *p <= '9' ; p++, n++ )
+	{
+		if( whole > (ULLONG_MAX - (unsigned long long) (*p - '0')) / 10 ) return( -1 );
+		whole = whole * 10 + (unsigned long long) (*p - '0');
+	}
+	if( *p == '.' )
+	{
+		for( p++ ; *p >= '0' && *p <= '9' ; p++, n++ )
+		{
+			if( scale > ULLONG_MAX / 100 ) continue;
+			frac = frac * 10 + (unsigned long long) (*p - '0');
+			scale *= 10;
+		}
+	}
+	if( n == 0 ) return( -1 );
+
+	*pp = p;
+	*pWhole = whole;
+	*pFrac = frac;
+	*pScale = scale;
+	return( 0 );
+}
+
+/* (whole + frac / scale) * unit, rounded down; -1 if it exceeds max */
+static int scale_value( unsigned long long whole, unsigned long long frac, unsigned long long scale, unsigned long long unit, unsigned long long max, unsigned long long *pValue )
+{
+	unsigned long long part;
+
+	if( whole > max / unit ) return( -1 );
+	// long double keeps the product of two 64-bit values exact enough to truncate
+	part = frac == 0 ? 0 : (unsigned long long) ((long double) frac * unit / scale);
+	if( whole * unit > max - part ) return( -1 );
+
+	*pValue = whole * unit + part;
+	return( 0 );
+}
+
+/* Byte counts: a number, then optionally K, M, G, T, P or E (either
+	case, powers of 1024) and B or iB after it. A fraction needs a
+	multiplier: "1.5G" is fine, "1.5" and "1.5B" are not. */
+static int read_bytes( const char *s, unsigned long long *pValue )
+{
+	static const char units[] = "kmgtpe";
+	const char *p = s, *u;
+	unsigned long long whole, frac, scale, unit = 1;
+
+	if( scan_decimal( &p, &whole, &frac, &scale ) < 0 ) return( -1 );
+
+	if( *p != '\0' && (u = strchr( units, *p | 0x20 )) != NULL )
+	{
+		unit = 1ULL << (10 * (u - units + 1));
+		p++;
+		if( *p == 'i' ) p++;
+		if( *p == 'B' || *p == 'b' ) p++;
+		else if( p[-1] == 'i' ) return( -1 );
+	}
+	else if( *p == 'B' || *p == 'b' ) p++;
+
+	if( *p != '\0' || (unit == 1 && frac != 0) ) return( -1 );
+
+	return( scale_value( whole, frac, scale, unit, ULLONG_MAX, pValue ) );
+}
+
+/* Durations in nanoseconds: one or more number and unit pairs, units
+	ns, us, ms, s, m, h and d, as in "250ms", "1.5s" or "1h30m". A number
+	alone is seconds. */
+static int read_duration( const char *s, long long *pValue )
+{
+	static const struct
+	{
+		const char *name;
+		unsigned long long ns;
+	} units[] =
+	{
+		{ "ns", 1ULL }, { "us", 1000ULL }, { "ms", 1000000ULL }, { "s", 1000000000ULL },
+		{ "m", 60000000000ULL }, { "h", 3600000000000ULL }, { "d", 86400000000000ULL }
+	};
+	const char *p = s, *start;
+	unsigned long long whole, frac, scale, part, total = 0;
+	size_t n;
+	int k;
+
+	do
+	{
+		start = p;
+		if( scan_decimal( &p, &whole, &frac, &scale ) < 0 ) return( -1 );
+
+		for( k = 0 ; k < (int) (sizeof(units) / sizeof(units[0])) ; k++ )
+		{
+			n = strlen( units[k].name );
+			if( strncmp( p, units[k].name, n ) == 0 ) break;
+		}
+		if( k == (int) (sizeof(units) / sizeof(units[0])) )
+		{
+			// only a lone number may leave out its unit
+			if( *p != '\0' || start != s ) return( -1 );
+			k = 3;
+			n = 0;
+		}
+		p += n;
+
+		if( scale_value( whole, frac, scale, units[k].ns, LLONG_MAX, &part ) < 0 ) return( -1 );
+		if( part > (unsigned long long) LLONG_MAX - total ) return( -1 );
+		total += part;
+	}
+	while( *p != '\0' );
+
+	*pValue = (long long) total;
+	return( 0 );
+}
+
+/* the converters, by type */
+
+static int convert_char( const char *s, void *out )
+{
+	if( s[0] == '\0' || s[1] != '\0' ) return( -1 );
+	*(char *) out = s[0];
+	return( 0 );
+}
+
+#define SIGNED_CONVERTER( name, type, lo, hi, simd ) \
+	static int name( const char *s, void *out ) \
+	{ \
+		long long x; \
+		if( read_integer( s, lo, hi, simd, &x ) < 0 ) return( -1 ); \
+		*(type *) out = (type) x; \
+		return( 0 ); \
+	}
+
+#define UNSIGNED_CONVERTER( name, type, hi, hex ) \
+	static int name( const char *s, void *out ) \
+	{ \
+		unsigned long long x; \
+		if( read_unsigned( s, hi, hex, &x ) < 0 ) return( -1 ); \
+		*(type *) out = (type) x; \
+		return( 0 ); \
+	}
+
+// var-arg lists of %hd, %d and %lld go through the SIMD digit kernel when the CPU has one
+SIGNED_CONVERTER( convert_short, short, SHRT_MIN, SHRT_MAX, 0 )
+SIGNED_CONVERTER( convert_short_list, short, SHRT_MIN, SHRT_MAX, 1 )
+SIGNED_CONVERTER( convert_int, int, INT_MIN, INT_MAX, 0 )
+SIGNED_CONVERTER( convert_int_list, int, INT_MIN, INT_MAX, 1 )
+SIGNED_CONVERTER( convert_llong, long long, LLONG_MIN, LLONG_MAX, 0 )
+SIGNED_CONVERTER( convert_llong_list, long long, LLONG_MIN, LLONG_MAX, 1 )
+UNSIGNED_CONVERTER( convert_ullong, unsigned long long, ULLONG_MAX, 0 )
+UNSIGNED_CONVERTER( convert_uint, unsigned int, UINT_MAX, 0 )
+UNSIGNED_CONVERTER( convert_size, size_t, SIZE_MAX, 0 )
+UNSIGNED_CONVERTER( convert_hex, unsigned int, UINT_MAX, 1 )
+
+static int convert_float( const char *s, void *out )
+{
+	float x;
+
+	if( sg_read_float( s, &x ) < 0 ) return( -1 );
+	*(float *) out = x;
+	return( 0 );
+}
+
+static int convert_double( const char *s, void *out )
+{
+	double x;
+
+	if( sg_read_double( s, &x ) < 0 ) return( -1 );
+	*(double *) out = x;
+	return( 0 );
+}
+
+static int convert_string( const char *s, void *out )
+{
+	*(const char **) out = s;
+	return( 0 );
+}
+
+static int convert_bytes( const char *s, void *out )
+{
+	unsigned long long x;
+
+	if( read_bytes( s, &x ) < 0 ) return( -1 );
+	*(unsigned long long *) out = x;
+	return( 0 );
+}
+
+static int convert_duration( const char *s, void *out )
+{
+	long long x;
+
+	if( read_duration( s, &x ) < 0 ) return( -1 );
+	*(long long *) out = x;
+	return( 0 );
+}
+
+const char sg_type_names[SG_NUM_TYPES][10] =
+{
+	"char", "short", "int", "float", "double", "string",
+	"llong", "ullong", "uint", "size", "hex", "bytes", "duration"
+};
+
+const size_t sg_type_sizes[SG_NUM_TYPES] =
+{
+	sizeof(char), sizeof(short), sizeof(int), sizeof(float), sizeof(double), sizeof(char *),
+	sizeof(long long), sizeof(unsigned long long), sizeof(unsigned int), sizeof(size_t),
+	sizeof(unsigned int), sizeof(unsigned long long), sizeof(long long)
+};
+
+const SG_CONVERT_FN sg_converters[SG_NUM_TYPES] =
+{
+	convert_char, convert_short, convert_int, convert_float, convert_double, convert_string,
+	convert_llong, convert_ullong, convert_uint, convert_size, convert_hex, convert_bytes, convert_duration
+};
+
+const SG_CONVERT_FN sg_list_converters[SG_NUM_TYPES] =
+{
+	convert_char, convert_short_list, convert_int_list, convert_float, convert_double, convert_string,
+	convert_llong_list, convert_ullong, convert_uint, convert_size, convert_hex, convert_bytes, convert_duration
+};
@@ -0,0 +1,298 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+
+/* Environment fallback (superEnvOpt). The environment is indexed once per
+	process: a single pass over environ hashes every name into an open
+	addressing table, which is published with a compare-and-swap like the
+	usage cache, so a parse looks each unset option up with one probe
+	sequence instead of a getenv() scan. Values are split into words that
+	go straight to the option's converters, so they convert exactly like
+	command-line arguments but never match another option. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+#ifdef _WIN32
+#define environ _environ
+#else
+extern char **environ;
+#endif
+
+struct sg_envslot_s
+{
+	const char *entry;	// "NAME=value" in environ, NULL if the slot is empty
+	int namelen;
+	unsigned long long hash;
+};
+
+struct sg_envindex_s
+{
+	unsigned int mask;
+	struct sg_envslot_s slots[1];
+};
+
+static struct sg_envindex_s *envIndex;
+
+static unsigned long long env_hash( const char *s, int len );
+static const struct sg_envindex_s *get_index( void );
+static const char *env_value( const struct sg_envindex_s *index, const struct sg_envname_s *var );
+static int env_option( SG_CTX *ctx, int option, const char *value );
+
+int superEnvOpt( SG_SPEC *spec, const char *prefix, const char * const *names )
+{
+	struct sg_envname_s *env;
+	const char *name;
+	char *p;
+	size_t bytes = 0, plen = prefix != NULL ? strlen( prefix ) : 0, k;
+	int i;
+
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( names != NULL && names[i] != NULL ) bytes += strlen( names[i] ) + 1;
+		else if( prefix != NULL ) bytes += plen + spec->optionlist[i].namelen + 1;
+	}
+
+	env = (struct sg_envname_s *) malloc( spec->optnum * sizeof(struct sg_envname_s) + bytes );
+	if( env == NULL ) return( SG_ERROR_NO_MEMORY );
+	p = (char *) (env + spec->optnum);
+
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		env[i].name = NULL;
+		env[i].namelen = 0;
+		env[i].hash = 0;
+
+		if( names != NULL && names[i] != NULL )
+		{
+			strcpy( p, names[i] );
+		}
+		else if( prefix != NULL && i != spec->responseOpt - 1 )
+		{
+			// "-max-conns" -> prefix "MAX_CONNS"
+			memcpy( p, prefix, plen );
+			p[plen] = '\0';
+			for( name = spec->optionlist[i].name ; *name == '-' ; name++ );
+			for( k = plen ; *name != '\0' ; name++, k++ )
+			{
+				if( *name >= 'a' && *name <= 'z' ) p[k] = *name - 'a' + 'A';
+				else if( (*name >= 'A' && *name <= 'Z') || (*name >= '0' && *name <= '9') ) p[k] = *name;
+				else p[k] = '_';
+			}
+			p[k] = '\0';
+		}
+		else continue;
+
+		if( *p == '\0' )
+		{
+			free( env );
+			return( SG_ERROR_ZERO_LEN_OPTION );
+		}
+
+		env[i].name = p;
+		env[i].namelen = (int) strlen( p );
+		env[i].hash = env_hash( p, env[i].namelen );
+		p += env[i].namelen + 1;
+	}
+
+	sg_free_env( spec );
+	spec->env = env;
+
+	return(0);
+}
+
+void sg_free_env( SG_SPEC *spec )
+{
+	free( spec->env );
+	spec->env = NULL;
+}
+
+/* Fills every mapped option that ctx->seen does not have from its
+	variable. Returns 0 or the SG_ERROR code of the first bad value. */
+int sg_parse_env( SG_CTX *ctx )
+{
+	const SG_SPEC *spec = ctx->spec;
+	const struct sg_envindex_s *index = get_index();
+	const unsigned char *seen = ctx->seen;
+	const char *value;
+	int lastArgProcessedSuccessfully = ctx->lastArgProcessedSuccessfully;
+	int unAccountedFor = ctx->unAccountedFor;
+	int i, n = 0;
+
+	if( index == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	ctx->seen = NULL;
+	for( i = 0 ; i < spec->optnum && n == 0 ; i++ )
+	{
+		if( spec->env[i].name == NULL || (seen[i >> 3] & (1 << (i & 7))) ) continue;
+
+		value = env_value( index, &spec->env[i] );
+		if( value != NULL && *value != '\0' ) n = env_option( ctx, i, value );
+	}
+
+	// the command line's bookkeeping is what the caller sees
+	ctx->lastArgProcessedSuccessfully = lastArgProcessedSuccessfully;
+	ctx->unAccountedFor = unAccountedFor;
+
+	return( n );
+}
+
+/* FNV-1a */
+static unsigned long long env_hash( const char *s, int len )
+{
+	unsigned long long h = 14695981039346656037ULL;
+	int i;
+
+	for( i = 0 ; i < len ; i++ )
+	{
+		h ^= (unsigned char) s[i];
+		h *= 1099511628211ULL;
+	}
+
+	return( h );
+}
+
+/* The process's index, built on first use. NULL if out of memory. */
+static const struct sg_envindex_s *get_index( void )
+{
+	struct sg_envindex_s *index, *expected = NULL;
+	struct sg_envslot_s *vars = NULL, *grown, *slot;
+	const char *eq;
+	unsigned int size;
+	int num = 0, max = 0, i;
+	char **e;
+
+	index = __atomic_load_n( &envIndex, __ATOMIC_ACQUIRE );
+	if( index != NULL ) return( index );
+
+	// the one pass over environ: hash every name
+	for( e = environ ; e != NULL && *e != NULL ; e++ )
+	{
+		if( num == max )
+		{
+			max = max > 0 ? 2 * max : 64;
+			grown = (struct sg_envslot_s *) realloc( vars, max * sizeof(struct sg_envslot_s) );
+			if( grown == NULL )
+			{
+				free( vars );
+				return( NULL );
+			}
+			vars = grown;
+		}
+
+		eq = strchr( *e, '=' );
+		vars[num].entry = *e;
+		vars[num].namelen = eq != NULL ? (int) (eq - *e) : (int) strlen( *e );
+		vars[num].hash = env_hash( *e, vars[num].namelen );
+		num++;
+	}
+
+	// at most half full, so probe sequences stay short
+	for( size = 16 ; size < 2 * (unsigned int) num ; size *= 2 );
+	index = (struct sg_envindex_s *) calloc( 1, sizeof(struct sg_envindex_s) + (size - 1) * sizeof(struct sg_envslot_s) );
+	if( index == NULL )
+	{
+		free( vars );
+		return( NULL );
+	}
+	index->mask = size - 1;
+
+	for( i = 0 ; i < num ; i++ )
+	{
+		for( slot = &index->slots[vars[i].hash & index->mask] ; slot->entry != NULL ; )
+		{
+			// a repeated name keeps its first value, as getenv() does
+			if( slot->hash == vars[i].hash && slot->namelen == vars[i].namelen && memcmp( slot->entry, vars[i].entry, vars[i].namelen ) == 0 ) break;
+			slot = &index->slots[(slot - index->slots + 1) & index->mask];
+		}
+		if( slot->entry == NULL ) *slot = vars[i];
+	}
+	free( vars );
+
+	if( !__atomic_compare_exchange_n( &envIndex, &expected, index, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+	{
+		free( index );
+		index = expected;
+	}
+
+	return( index );
+}
+
+static const char *env_value( const struct sg_envindex_s *index, const struct sg_envname_s *var )
+{
+	const struct sg_envslot_s *slot;
+	unsigned int k;
+
+	for( k = var->hash & index->mask ; index->slots[k].entry != NULL ; k = (k + 1) & index->mask )
+	{
+		slot = &index->slots[k];
+		if( slot->hash == var->hash && slot->namelen == var->namelen && memcmp( slot->entry, var->name, var->namelen ) == 0 )
+		{
+			return( slot->entry[var->namelen] == '=' ? slot->entry + var->namelen + 1 : "" );
+		}
+	}
+
+	return( NULL );
+}
+
+/* Splits a copy of value, kept in the output arena where %s results may
+	point, into the option's arguments. The words are values only: one
+	that looks like an option name or an @file is stored as it is. */
+static int env_option( SG_CTX *ctx, int option, const char *value )
+{
+	const struct optionlist_s *o = &ctx->spec->optionlist[option];
+	size_t len = strlen( value );
+	char *copy, *p;
+	char **words;
+	int num = 0;
+
+	if( o->numargs == 0 && strcmp( value, "0" ) == 0 ) return(0);
+
+	copy = (char *) sg_arena_grow( ctx->outArena, NULL, 0, len + 1 );
+	words = (char **) sg_arena_grow( ctx->outArena, NULL, 0, (len / 2 + 1) * sizeof(char *) );
+	if( copy == NULL || words == NULL ) return( SG_ERROR_NO_MEMORY );
+	memcpy( copy, value, len + 1 );
+
+	if( o->numargs == 1 && o->varflag == 0 && o->argtype[0] == SG_TYPE_STRING )
+	{
+		words[num++] = copy;
+	}
+	else if( o->numargs > 0 )
+	{
+		// words are at least one byte and one blank apart
+		for( p = copy ; *p != '\0' ; )
+		{
+			while( *p == ' ' || *p == '\t' ) *p++ = '\0';
+			if( *p == '\0' ) break;
+			words[num++] = p;
+			while( *p != '\0' && *p != ' ' && *p != '\t' ) p++;
+		}
+	}
+
+	return( sg_store_words( ctx, option, words, num ) );
+}
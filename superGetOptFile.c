@@ -0,0 +1,456 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Config files parsed in place. The file is mapped private and writable,
+	so the tokenizer can unescape each token over its own bytes and end it
+	with a NUL without a separate copy; %s results point straight into the
+	mapping. One extra zero byte after the data is always addressable and
+	doubles as a sentinel for the scanning loops. Pipes and other files
+	that cannot be mapped are read into a heap buffer instead. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define READ_CHUNK 65536
+
+enum { PLAIN, BLANK, NEWLINE, SPECIAL };
+
+static unsigned char charClass[256];
+
+static void init_classes( void );
+static int load_file( SG_FILE *file, const char *path );
+static char *file_next_token( void *state );
+
+int superOpenFile( SG_FILE **pFile, const char *path )
+{
+	SG_FILE *file;
+	int n;
+
+	*pFile = NULL;
+
+	file = (SG_FILE *) calloc( 1, sizeof(SG_FILE) );
+	if( file == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	n = load_file( file, path );
+	if( n < 0 )
+	{
+		free( file );
+		return( n );
+	}
+
+	init_classes();
+
+	file->pos = file->data;
+	file->line = 1;
+	file->tokenLine = 1;
+	*pFile = file;
+
+	return(0);
+}
+
+void superCloseFile( SG_FILE *file )
+{
+	if( file == NULL ) return;
+
+#ifndef _WIN32
+	if( file->mapSize > 0 ) munmap( file->data, file->mapSize );
+	else
+#endif
+	free( file->data );
+
+	free( file );
+}
+
+int superFileLine( const SG_FILE *file )
+{
+	return( file->tokenLine );
+}
+
+int superParseFile( const SG_SPEC *spec, SG_FILE *file, int *lastArg )
+{
+	SG_CTX ctx;
+	int n;
+
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	n = superParseFileCtx( &ctx, file, lastArg );
+	SG_STAT( sg_merge_stats( &ctx ) );
+
+	return( n );
+}
+
+int superParseFileCtx( SG_CTX *ctx, SG_FILE *file, int *lastArg )
+{
+	int n;
+	int unAccountedFor = 0;
+
+	*lastArg = 0;
+	if( file->parsed ) return( SG_ERROR_FILE );
+	file->parsed = 1;
+
+	if( sg_begin_parse( ctx ) < 0 ) return( SG_ERROR_NO_MEMORY );
+	sg_reset_outputs( ctx );
+	SG_STAT( ctx->stats.parses++ );
+
+	// one stream per line; file_next_token() returns NULL at each line end
+	while( file->pos < file->end || file->pendingNewline )
+	{
+		n = sg_parse_stream( ctx, file_next_token, file, lastArg );
+		if( file->error < 0 ) return( file->error );
+		if( n < 0 ) return( n );
+		unAccountedFor += n;
+	}
+
+	ctx->unAccountedFor = unAccountedFor;
+
+	return( unAccountedFor );
+}
+
+/* Response files ignore line ends: keep asking until the data runs out. */
+char *sg_file_token( SG_FILE *file )
+{
+	char *token;
+
+	while( (token = file_next_token( file )) == NULL )
+	{
+		if( file->error < 0 ) return( NULL );
+		if( file->pos >= file->end && !file->pendingNewline ) return( NULL );
+	}
+
+	return( token );
+}
+
+void sg_file_buffer( SG_FILE *file, char *data, size_t len )
+{
+	init_classes();
+
+	memset( file, 0, sizeof(SG_FILE) );
+	file->data = data;
+	file->pos = data;
+	file->end = data + len;
+	file->line = 1;
+	file->tokenLine = 1;
+}
+
+int sg_file_error( const SG_FILE *file )
+{
+	return( file->error );
+}
+
+char *sg_file_line_token( SG_FILE *file )
+{
+	return( file_next_token( file ) );
+}
+
+int sg_file_more( const SG_FILE *file )
+{
+	return( file->error == 0 && (file->pos < file->end || file->pendingNewline) );
+}
+
+void sg_file_push( SG_FILE **list, SG_FILE *file )
+{
+	file->next = *list;
+	*list = file;
+}
+
+void sg_file_close_all( SG_FILE **list )
+{
+	SG_FILE *file, *next;
+
+	for( file = *list ; file != NULL ; file = next )
+	{
+		next = file->next;
+		superCloseFile( file );
+	}
+	*list = NULL;
+}
+
+static void init_classes( void )
+{
+	// idempotent, so racing first opens on several threads are harmless
+	charClass[' '] = BLANK;
+	charClass['\t'] = BLANK;
+	charClass['\r'] = BLANK;
+	charClass['\f'] = BLANK;
+	charClass['\v'] = BLANK;
+	charClass['\n'] = NEWLINE;
+	charClass['"'] = SPECIAL;
+	charClass['\''] = SPECIAL;
+	charClass['\\'] = SPECIAL;
+	charClass[0] = SPECIAL;
+}
+
+#ifndef _WIN32
+
+static int load_file( SG_FILE *file, const char *path )
+{
+	struct stat st;
+	char *base;
+	size_t size, cap;
+	ssize_t got;
+	int fd;
+
+	fd = open( path, O_RDONLY );
+	if( fd < 0 ) return( SG_ERROR_FILE );
+
+	if( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) )
+	{
+		size = (size_t) st.st_size;
+
+		// reserve one byte more than the file, then map the file over the
+		// front; the byte past the data is zero even at a page boundary
+		base = (char *) mmap( NULL, size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if( base == MAP_FAILED )
+		{
+			close( fd );
+			return( SG_ERROR_NO_MEMORY );
+		}
+
+		if( size > 0 && mmap( base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+		{
+			munmap( base, size + 1 );
+			close( fd );
+			return( SG_ERROR_FILE );
+		}
+		close( fd );
+
+#ifdef MADV_SEQUENTIAL
+		madvise( base, size + 1, MADV_SEQUENTIAL );
+#endif
+		file->data = base;
+		file->mapSize = size + 1;
+		file->end = base + size;
+		return(0);
+	}
+
+	// not mappable: read it all
+	size = 0;
+	cap = READ_CHUNK;
+	base = (char *) malloc( cap + 1 );
+	while( base != NULL )
+	{
+		got = read( fd, base + size, cap - size );
+		if( got < 0 )
+		{
+			free( base );
+			close( fd );
+			return( SG_ERROR_FILE );
+		}
+		if( got == 0 ) break;
+
+		size += (size_t) got;
+		if( size == cap )
+		{
+			char *grown = (char *) realloc( base, 2 * cap + 1 );
+			if( grown == NULL ) free( base );
+			base = grown;
+			cap *= 2;
+		}
+	}
+	close( fd );
+	if( base == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	base[size] = 0;
+	file->data = base;
+	file->end = base + size;
+	return(0);
+}
+
+#else
+
+static int load_file( SG_FILE *file, const char *path )
+{
+	FILE *fp;
+	char *base;
+	size_t size, cap, got;
+
+	fp = fopen( path, "rb" );
+	if( fp == NULL ) return( SG_ERROR_FILE );
+
+	size = 0;
+	cap = READ_CHUNK;
+	base = (char *) malloc( cap + 1 );
+	while( base != NULL && (got = fread( base + size, 1, cap - size, fp )) > 0 )
+	{
+		size += got;
+		if( size == cap )
+		{
+			char *grown = (char *) realloc( base, 2 * cap + 1 );
+			if( grown == NULL ) free( base );
+			base = grown;
+			cap *= 2;
+		}
+	}
+	if( base != NULL && ferror( fp ) )
+	{
+		free( base );
+		base = NULL;
+		fclose( fp );
+		return( SG_ERROR_FILE );
+	}
+	fclose( fp );
+	if( base == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	base[size] = 0;
+	file->data = base;
+	file->end = base + size;
+	return(0);
+}
+
+#endif
+
+/* Returns the next token on the current line, or NULL at the end of the
+	line, the end of the file or a syntax error (file->error). */
+static char *file_next_token( void *state )
+{
+	SG_FILE *file = (SG_FILE *) state;
+	char *r = file->pos;
+	char *end = file->end;
+	char *w, *token;
+	int quote;
+
+	if( file->error < 0 ) return( NULL );
+
+	if( file->pendingNewline )
+	{
+		file->pendingNewline = 0;
+		file->line++;
+		return( NULL );
+	}
+
+	// blanks, comments and line continuations between tokens
+	for( ;; )
+	{
+		while( charClass[(unsigned char) *r] == BLANK ) r++;
+
+		if( r >= end )
+		{
+			file->pos = end;
+			return( NULL );
+		}
+		if( *r == '\n' )
+		{
+			file->pos = r + 1;
+			file->line++;
+			return( NULL );
+		}
+		if( *r == '#' )
+		{
+			while( r < end && *r != '\n' ) r++;
+			continue;
+		}
+		if( *r == '\\' && (r[1] == '\n' || (r[1] == '\r' && r[2] == '\n')) )
+		{
+			r += r[1] == '\n' ? 2 : 3;
+			file->line++;
+			continue;
+		}
+		if( *r == 0 )
+		{
+			r++;	// stray NUL in the data
+			continue;
+		}
+		break;
+	}
+
+	token = r;
+	file->tokenLine = file->line;
+
+	// plain bytes stay where they are until the first escape or quote
+	while( charClass[(unsigned char) *r] == PLAIN ) r++;
+	w = r;
+
+	quote = 0;
+	while( r < end )
+	{
+		int c = (unsigned char) *r;
+
+		if( quote == 0 )
+		{
+			if( charClass[c] == PLAIN ) *w++ = *r++;
+			else if( charClass[c] != SPECIAL || c == 0 ) break;
+			else if( c == '"' || c == '\'' )
+			{
+				quote = c;
+				r++;
+			}
+			else if( r + 1 >= end ) r++;	// trailing backslash
+			else if( r[1] == '\n' || (r[1] == '\r' && r[2] == '\n') )
+			{
+				r += r[1] == '\n' ? 2 : 3;
+				file->line++;
+			}
+			else
+			{
+				*w++ = r[1];
+				r += 2;
+			}
+		}
+		else if( c == quote )
+		{
+			quote = 0;
+			r++;
+		}
+		else if( quote == '"' && c == '\\' && r + 1 < end && (r[1] == '"' || r[1] == '\\' || r[1] == '\n') )
+		{
+			if( r[1] == '\n' ) file->line++;
+			else *w++ = r[1];
+			r += 2;
+		}
+		else
+		{
+			if( c == '\n' ) file->line++;
+			*w++ = *r++;
+		}
+	}
+
+	if( quote != 0 )
+	{
+		file->error = SG_ERROR_UNTERMINATED_QUOTE;
+		file->pos = end;
+		return( NULL );
+	}
+
+	// the terminator goes at w; when w == r it replaces the separator
+	if( r < end )
+	{
+		if( *r == '\n' && w == r ) file->pendingNewline = 1;
+		else if( *r == '\n' ) r--;	// keep it for the next call
+		r++;
+	}
+	*w = 0;
+	file->pos = r;
+
+	return( token );
+}
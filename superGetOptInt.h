@@ -0,0 +1,169 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Declarations shared between the library's source files. Not installed. */
+
+#ifndef __SUPERGETOPTINT
+#define __SUPERGETOPTINT
+
+#include "supergetopt.h"
+
+#ifndef SG_ENABLE_STATS
+#define SG_ENABLE_STATS 1	// 0: off, 1: counters, 2: counters, bytes and timings
+#endif
+
+#ifndef SG_ENABLE_PREFIX
+#define SG_ENABLE_PREFIX 1	// 0: option names match exactly only
+#endif
+
+#if SG_ENABLE_STATS
+#define SG_STAT( x ) (x)
+#else
+#define SG_STAT( x ) ((void) 0)
+#endif
+
+#if SG_ENABLE_STATS > 1
+#define SG_STAT_DETAIL( x ) (x)
+#else
+#define SG_STAT_DETAIL( x ) ((void) 0)
+#endif
+
+// superGetOptFloat.c: strict, locale independent, correctly rounded. 0 or -1.
+int sg_read_double( const char *s, double *pValue );
+int sg_read_float( const char *s, float *pValue );
+
+// superGetOpt.c: parse tokens from nextToken() until it returns NULL,
+// without clearing outputs first. Returns like superParseOpt().
+void sg_reset_outputs( const SG_CTX *ctx );
+// where ctx puts the output a compiled pointer names (see SG_CTX)
+void *sg_output( const SG_CTX *ctx, void *p );
+int sg_parse_stream( SG_CTX *ctx, char *(*nextToken)( void *state ), void *state, int *lastArg );
+// a token stream over an array; state is a struct sg_tokens_s
+struct sg_tokens_s
+{
+	char **tokens;
+	int num;
+	int next;
+};
+char *sg_array_token( void *state );
+// stores words as option's arguments, converting each against its type
+// with no option matching; 0 or an SG_ERROR code
+int sg_store_words( SG_CTX *ctx, int option, char **words, int num );
+// an option's outputs saved to and restored from a buffer, and compared
+// with one (strings by content); not for "+" and ">" options
+size_t sg_option_bytes( const SG_SPEC *spec, int option );
+void sg_copy_option( const SG_CTX *ctx, int option, void *buf, int save );
+int sg_option_differs( const SG_CTX *ctx, int option, const void *buf );
+// picks ctx->outArena for one parse; SG_ERROR_NO_MEMORY or 0
+int sg_begin_parse( SG_CTX *ctx );
+// "+" formats, response files and environment fallback need an arena
+int sg_spec_needs_arena( const SG_SPEC *spec );
+// parse_string() for superSpecGen: argument count or SG_ERROR_*
+int sg_parse_format( const char *format, int *pNameLen, int *pVarflag, int *pManaged, int *pStream, int *argtypes );
+// adds a context's counters to this thread's totals (superGetStats( NULL ))
+void sg_merge_stats( const SG_CTX *ctx );
+unsigned long long sg_now_ns( void );
+
+// superGetOptUsage.c: frees the usage renderings cached in a compiled spec
+void sg_free_usage( SG_SPEC *spec );
+
+// superGetOptEnv.c: fills the options ctx->seen lacks from the environment
+int sg_parse_env( SG_CTX *ctx );
+void sg_free_env( SG_SPEC *spec );
+
+// superGetOptConvert.c: "char", "short", ... their sizes and converters,
+// by SG_TYPE_*. A converter stores the whole token's value in out and
+// returns 0, or returns -1 and stores nothing. Safe on any thread.
+typedef int (*SG_CONVERT_FN)( const char *token, void *out );
+extern const char sg_type_names[SG_NUM_TYPES][10];
+extern const size_t sg_type_sizes[SG_NUM_TYPES];
+extern const SG_CONVERT_FN sg_converters[SG_NUM_TYPES];	// fixed arguments
+extern const SG_CONVERT_FN sg_list_converters[SG_NUM_TYPES];	// var-arg lists
+
+// superGetOptParallel.c: converts tokens[0..num) into out on up to
+// numThreads threads (0: one per online CPU), storing the first max of
+// them. Returns the index of the first token that does not convert, or num.
+int sg_convert_run( char **tokens, int num, int type, void *out, int max, int numThreads );
+// the number of threads that numThreads stands for
+int sg_run_threads( int numThreads );
+
+// superGetOptLazy.c: a lazy parse's record. Each option occurrence is a
+// span of tokens, the last one per option being the one its outputs hold.
+struct sg_span_s
+{
+	int option;
+	int first;	// index into tokens
+	int num;
+	int pos;	// lastArg of its first value
+};
+struct sg_lazy_s
+{
+	char **tokens;
+	unsigned char *converted;	// bit per token: stored already
+	int numTokens;
+	struct sg_span_s *spans;
+	int numSpans;
+	int *lastSpan;	// by option, -1: no values recorded
+};
+// starts ctx->lazySpans in ctx->outArena; 0 or SG_ERROR_NO_MEMORY
+int sg_lazy_begin( SG_CTX *ctx );
+int sg_lazy_token( SG_CTX *ctx, char *token, int converted );
+int sg_lazy_span( SG_CTX *ctx, int option, int first, int num, int pos );
+
+// superGetOptArena.c: room for need bytes in a growable array
+void *sg_arena_grow( SG_ARENA *arena, void *array, size_t used, size_t need );
+// the arena closes file when it is reset or freed
+void sg_arena_keep_file( SG_ARENA *arena, SG_FILE *file );
+
+// superGetOptFile.c: an open config or response file, or a command line
+struct sg_file_s
+{
+	char *data;
+	size_t mapSize;	// 0 when data is a heap buffer
+	char *pos;
+	char *end;		// *end is always 0
+	int line;		// line of pos
+	int tokenLine;	// line of the last token handed out
+	int pendingNewline;	// the last token's NUL overwrote a newline
+	int error;
+	int parsed;
+	struct sg_file_s *next;	// in the arena that owns it (response files)
+};
+// tokenizes data[0..len), which the caller owns and data[len] == 0 ends
+void sg_file_buffer( SG_FILE *file, char *data, size_t len );
+// a file's tokens across lines; NULL at the end or on
+// a syntax error, which sg_file_error() then returns
+char *sg_file_token( SG_FILE *file );
+int sg_file_error( const SG_FILE *file );
+// one line's tokens at a time: NULL at the end of each line; 0 from
+// sg_file_more() once the data is used up
+char *sg_file_line_token( SG_FILE *file );
+int sg_file_more( const SG_FILE *file );
+// lists of open files, linked through the files themselves
+void sg_file_push( SG_FILE **list, SG_FILE *file );
+void sg_file_close_all( SG_FILE **list );
+
+#endif
@@ -0,0 +1,205 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Lazy conversion. The parse leaves each numeric argument as the token
+	it came from, remembered per option occurrence as a span of a token
+	array in the output arena, with a bit per token once it is stored.
+	Only the last span of an option feeds its outputs; earlier ones are
+	kept so that superLazyValidate() reports the same first bad token a
+	full parse would. Values past a var list's numArgsMax are checked but
+	go nowhere, as in the parse. */
+
+#include <stdio.h>
+#include <string.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+int sg_lazy_begin( SG_CTX *ctx )
+{
+	struct sg_lazy_s *lazy;
+	int i;
+
+	lazy = (struct sg_lazy_s *) sg_arena_grow( ctx->outArena, NULL, 0, sizeof(struct sg_lazy_s) );
+	if( lazy == NULL ) return( SG_ERROR_NO_MEMORY );
+	memset( lazy, 0, sizeof(struct sg_lazy_s) );
+
+	lazy->lastSpan = (int *) sg_arena_grow( ctx->outArena, NULL, 0, ctx->spec->optnum * sizeof(int) );
+	if( lazy->lastSpan == NULL ) return( SG_ERROR_NO_MEMORY );
+	for( i = 0 ; i < ctx->spec->optnum ; i++ ) lazy->lastSpan[i] = -1;
+
+	ctx->lazySpans = lazy;
+
+	return(0);
+}
+
+int sg_lazy_token( SG_CTX *ctx, char *token, int converted )
+{
+	struct sg_lazy_s *lazy = ctx->lazySpans;
+	char **tokens;
+	unsigned char *bits;
+	int n = lazy->numTokens;
+
+	tokens = (char **) sg_arena_grow( ctx->outArena, lazy->tokens, n * sizeof(char *), (n + 1) * sizeof(char *) );
+	if( tokens == NULL ) return( SG_ERROR_NO_MEMORY );
+	lazy->tokens = tokens;
+
+	bits = (unsigned char *) sg_arena_grow( ctx->outArena, lazy->converted, (n + 7) / 8, n / 8 + 1 );
+	if( bits == NULL ) return( SG_ERROR_NO_MEMORY );
+	lazy->converted = bits;
+
+	if( converted ) bits[n >> 3] |= 1 << (n & 7);
+	else bits[n >> 3] &= ~(1 << (n & 7));
+	tokens[n] = token;
+	lazy->numTokens++;
+
+	return(0);
+}
+
+int sg_lazy_span( SG_CTX *ctx, int option, int first, int num, int pos )
+{
+	struct sg_lazy_s *lazy = ctx->lazySpans;
+	struct sg_span_s *spans;
+	int n = lazy->numSpans;
+
+	spans = (struct sg_span_s *) sg_arena_grow( ctx->outArena, lazy->spans, n * sizeof(struct sg_span_s), (n + 1) * sizeof(struct sg_span_s) );
+	if( spans == NULL ) return( SG_ERROR_NO_MEMORY );
+	lazy->spans = spans;
+
+	spans[n].option = option;
+	spans[n].first = first;
+	spans[n].num = num;
+	spans[n].pos = pos;
+	lazy->lastSpan[option] = n;
+	lazy->numSpans++;
+
+	return(0);
+}
+
+/* stores token t into out unless it was stored before */
+static int convert_token( SG_CTX *ctx, int t, int type, int list, void *out )
+{
+	struct sg_lazy_s *lazy = ctx->lazySpans;
+
+	if( lazy->converted[t >> 3] & (1 << (t & 7)) ) return(0);
+
+	if( (list ? sg_list_converters : sg_converters)[type]( lazy->tokens[t], out ) < 0 )
+	{
+#if DEBUG
+		fprintf(stderr," Bad argument <%s>. Expected %s\n", lazy->tokens[t], sg_type_names[type]);
+#endif
+		SG_STAT( ctx->stats.conversionFailures++ );
+		return( SG_ERROR_INCORRECT_ARG );
+	}
+
+	SG_STAT( ctx->stats.conversions[type]++ );
+	lazy->converted[t >> 3] |= 1 << (t & 7);
+
+	return(0);
+}
+
+int superLazyGet( SG_CTX *ctx, int option, int arg, int type, void *value )
+{
+	const struct optionlist_s *o;
+	const struct sg_lazy_s *lazy = ctx->lazySpans;
+	char *slot;
+	int x;
+
+	if( option < 0 || option >= ctx->spec->optnum || arg < 0 || type < 0 || type >= SG_NUM_TYPES ) return( SG_ERROR_BAD_ARGTYPE );
+	o = &ctx->spec->optionlist[option];
+
+	if( o->stream != NULL ) return( SG_ERROR_BAD_ARGTYPE );
+	if( o->numargs == 0 )
+	{
+		if( arg > 0 || type != SG_TYPE_INT ) return( SG_ERROR_BAD_ARGTYPE );
+		slot = (char *) sg_output( ctx, o->argptr[0].i );
+	}
+	else if( o->varflag )
+	{
+		if( type != o->argtype[0] ) return( SG_ERROR_BAD_ARGTYPE );
+		if( arg >= *(int *) sg_output( ctx, o->pNumArgs ) ) return( SG_ERROR_MISSING_ARG );
+
+		slot = (char *) sg_output( ctx, o->argptr[0].c );
+		if( o->managed ) slot = *(char **) slot;
+		slot += arg * sg_type_sizes[type];
+	}
+	else
+	{
+		if( arg >= o->numargs || type != o->argtype[arg] ) return( SG_ERROR_BAD_ARGTYPE );
+		slot = (char *) sg_output( ctx, o->argptr[arg].c );
+	}
+
+	// the first read of a recorded value converts it into its output
+	if( lazy != NULL && lazy->lastSpan[option] >= 0 )
+	{
+		x = convert_token( ctx, lazy->spans[lazy->lastSpan[option]].first + arg, type, o->varflag, slot );
+		if( x < 0 ) return( x );
+	}
+
+	memcpy( value, slot, sg_type_sizes[type] );
+
+	return(0);
+}
+
+int superLazyValidate( SG_CTX *ctx, int *lastArg )
+{
+	const struct sg_lazy_s *lazy = ctx->lazySpans;
+	const struct sg_span_s *span;
+	const struct optionlist_s *o;
+	union
+	{
+		long long ll;
+		double d;
+		char *string;
+	} scratch;
+	void *out;
+	int s, k, type;
+
+	if( lazy == NULL ) return(0);
+
+	for( s = 0 ; s < lazy->numSpans ; s++ )
+	{
+		span = &lazy->spans[s];
+		o = &ctx->spec->optionlist[span->option];
+
+		for( k = 0 ; k < span->num ; k++ )
+		{
+			type = o->argtype[o->varflag ? 0 : k];
+
+			// overridden occurrences and values past the array are only checked
+			out = &scratch;
+			if( lazy->lastSpan[span->option] == s && !o->varflag ) out = sg_output( ctx, o->argptr[k].c );
+			else if( lazy->lastSpan[span->option] == s && k < o->numArgsMax ) out = (char *) sg_output( ctx, o->argptr[0].c ) + k * sg_type_sizes[type];
+
+			if( convert_token( ctx, span->first + k, type, o->varflag, out ) < 0 )
+			{
+				*lastArg = span->pos + (o->varflag && k > o->numArgsMax ? o->numArgsMax : k);
+				return( SG_ERROR_INCORRECT_ARG );
+			}
+		}
+	}
+
+	return(0);
+}
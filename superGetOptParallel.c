@@ -0,0 +1,148 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Long var-arg runs converted on several threads. By the time a run gets
+	here the parser has already gathered its tokens and knows which one
+	ends it, so every token is a value and converting them is independent
+	work. The run is cut into fixed chunks that the threads claim in order
+	off a shared counter, and each value is written straight into its slot
+	of the output array. A thread that meets a bad token lowers the run's
+	first failing index and stops; chunks that start past that index are
+	not worth converting, so the answer is the lowest failing index no
+	matter how the chunks were scheduled. A value is stored only while its
+	index is below the lowest failure found so far, but a chunk past the
+	failing token may have stored values before that failure was found. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define CHUNK 4096	// tokens per claim
+#define MAX_THREADS 64
+
+struct sg_run_s
+{
+	char **tokens;
+	int num;
+	int type;
+	char *out;
+	int max;	// tokens past this are converted but not stored
+	size_t width;
+	int numChunks;
+	int next;	// next chunk to claim
+	int first;	// lowest failing index so far, num if none
+};
+
+static void *run_worker( void *arg );
+static void convert_chunks( struct sg_run_s *run );
+
+int sg_run_threads( int numThreads )
+{
+#ifndef _WIN32
+	if( numThreads <= 0 ) numThreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+	if( numThreads > MAX_THREADS ) numThreads = MAX_THREADS;
+#endif
+	return( numThreads > 0 ? numThreads : 1 );
+}
+
+int sg_convert_run( char **tokens, int num, int type, void *out, int max, int numThreads )
+{
+	struct sg_run_s run;
+#ifndef _WIN32
+	pthread_t threads[MAX_THREADS];
+	int i, started;
+#endif
+
+	run.tokens = tokens;
+	run.num = num;
+	run.type = type;
+	run.out = (char *) out;
+	run.max = max;
+	run.width = sg_type_sizes[type];
+	run.numChunks = (num + CHUNK - 1) / CHUNK;
+	run.next = 0;
+	run.first = num;
+
+#ifndef _WIN32
+	numThreads = sg_run_threads( numThreads );
+	if( numThreads > run.numChunks ) numThreads = run.numChunks;
+
+	// the caller converts too; chunks a thread that cannot start would
+	// have taken are left to the others
+	for( started = 1 ; started < numThreads ; started++ )
+	{
+		if( pthread_create( &threads[started], NULL, run_worker, &run ) != 0 ) break;
+	}
+	convert_chunks( &run );
+	for( i = 1 ; i < started ; i++ ) pthread_join( threads[i], NULL );
+#else
+	convert_chunks( &run );
+#endif
+
+	return( run.first );
+}
+
+static void *run_worker( void *arg )
+{
+	convert_chunks( (struct sg_run_s *) arg );
+	return( NULL );
+}
+
+static void convert_chunks( struct sg_run_s *run )
+{
+	double value;	// wide enough for any type
+	int c, k, lo, hi, first;
+
+	for( ;; )
+	{
+		c = __atomic_fetch_add( &run->next, 1, __ATOMIC_RELAXED );
+		if( c >= run->numChunks ) break;
+
+		// chunks are claimed in order, so every later one starts further out
+		lo = c * CHUNK;
+		if( lo >= __atomic_load_n( &run->first, __ATOMIC_RELAXED ) ) break;
+		hi = lo + CHUNK < run->num ? lo + CHUNK : run->num;
+
+		for( k = lo ; k < hi ; k++ )
+		{
+			if( sg_list_converters[run->type]( run->tokens[k], &value ) == 0 )
+			{
+				// the eager path stops at a bad token; store nothing known to be past one
+				if( k < run->max && k < __atomic_load_n( &run->first, __ATOMIC_RELAXED ) ) memcpy( run->out + k * run->width, &value, run->width );
+				continue;
+			}
+
+			first = __atomic_load_n( &run->first, __ATOMIC_RELAXED );
+			while( k < first && !__atomic_compare_exchange_n( &run->first, &first, k, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) ;
+			break;
+		}
+	}
+}
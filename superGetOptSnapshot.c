@@ -0,0 +1,530 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+
+/* Snapshots of parsed values (superWriteSnapshot). The layout is
+
+	header | option table | byName | type bytes | values | string pool
+
+	with every reference an offset from the start. Var-arg, "+" and flag
+	values are packed arrays of their type; fixed arguments, whose types
+	may differ, get 8 bytes each. Strings, option names included, are
+	interned into the pool and referred to by offset, 0 meaning NULL. The
+	pool ends in a NUL, so checking that an offset falls inside it is
+	enough to read the string safely. */
+
+#ifdef __linux__
+#define _GNU_SOURCE	// memfd_create()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <io.h>
+#endif
+
+#define SNAP_MAGIC "SGSNAP1"
+#define SNAP_ORDER 0x01020304u
+#define SLOT 8		// bytes per fixed argument and per string reference
+#define ALIGN( n ) (((n) + 7) & ~(size_t) 7)
+
+struct sg_snaphead_s
+{
+	char magic[8];
+	unsigned int order;		// SNAP_ORDER, to catch the other byte order
+	unsigned int optnum;
+	unsigned long long size;	// of the whole snapshot
+	unsigned long long options;	// offset of the option table
+	unsigned long long byName;	// offset of optnum ints: options sorted by name
+	unsigned long long strings;	// offset and size of the string pool
+	unsigned long long stringBytes;
+};
+
+struct sg_snapopt_s
+{
+	unsigned long long name;	// offset of the name in the pool
+	unsigned long long types;	// offset of the type bytes: one if packed, else one per value
+	unsigned long long values;
+	int count;
+	int packed;
+};
+
+struct sg_byname_s
+{
+	const char *name;
+	int option;
+};
+
+// strings being interned: pool offsets by hash, open addressing
+struct sg_pool_s
+{
+	char *text;
+	size_t len;
+	size_t cap;
+	size_t *slots;	// 1 + offset, 0 if empty
+	size_t mask;
+	size_t used;
+};
+
+static int compare_names( const void *a, const void *b );
+static int values_of( const SG_CTX *ctx, const struct optionlist_s *o, const char **pArray );
+static const char *value_at( const SG_CTX *ctx, const struct optionlist_s *o, const char *array, int k );
+static int type_at( const struct optionlist_s *o, int k );
+static size_t value_width( int type, int packed );
+static size_t string_hash( const char *s );
+static long intern( struct sg_pool_s *pool, const char *s );
+static int write_all( int fd, const char *buf, size_t len );
+static int check_snapshot( const char *base, size_t size );
+
+int superWriteSnapshot( const SG_CTX *ctx, int fd )
+{
+	const SG_SPEC *spec = ctx->spec;
+	const struct optionlist_s *o;
+	struct sg_snaphead_s *head;
+	struct sg_snapopt_s *opts;
+	struct sg_pool_s pool;
+	struct sg_byname_s *byName;
+	const char *array, *value;
+	char *buf = NULL, *types, *values;
+	unsigned long long offset;
+	size_t typeBytes = 0, valueBytes = 0, at;
+	int i, k, type, n = 0;
+
+	memset( &pool, 0, sizeof(pool) );
+
+	// sizes, and every string into the pool
+	for( i = 0 ; i < spec->optnum && n == 0 ; i++ )
+	{
+		o = &spec->optionlist[i];
+		k = values_of( ctx, o, &array );
+		typeBytes += array != NULL || k == 0 ? 1 : k;
+		valueBytes += ALIGN( k * value_width( type_at( o, 0 ), array != NULL ) );
+		if( intern( &pool, o->name ) < 0 ) n = SG_ERROR_NO_MEMORY;
+		while( --k >= 0 && n == 0 )
+		{
+			if( type_at( o, k ) != SG_TYPE_STRING ) continue;
+			memcpy( &value, value_at( ctx, o, array, k ), sizeof(char *) );
+			if( value != NULL && intern( &pool, value ) < 0 ) n = SG_ERROR_NO_MEMORY;
+		}
+	}
+	if( n == 0 && intern( &pool, "" ) < 0 ) n = SG_ERROR_NO_MEMORY;	// the pool is never empty
+
+	at = sizeof(struct sg_snaphead_s) + spec->optnum * (sizeof(struct sg_snapopt_s) + sizeof(int));
+	byName = (struct sg_byname_s *) malloc( (spec->optnum + 1) * sizeof(struct sg_byname_s) );
+	if( n == 0 && byName != NULL ) buf = (char *) calloc( 1, ALIGN( at + typeBytes ) + valueBytes + pool.len );
+	if( buf == NULL )
+	{
+		free( byName );
+		free( pool.text );
+		free( pool.slots );
+		return( n < 0 ? n : SG_ERROR_NO_MEMORY );
+	}
+
+	head = (struct sg_snaphead_s *) buf;
+	memcpy( head->magic, SNAP_MAGIC, sizeof(head->magic) );
+	head->order = SNAP_ORDER;
+	head->optnum = spec->optnum;
+	head->options = sizeof(struct sg_snaphead_s);
+	head->byName = head->options + spec->optnum * sizeof(struct sg_snapopt_s);
+	head->strings = ALIGN( at + typeBytes ) + valueBytes;
+	head->stringBytes = pool.len;
+	head->size = head->strings + pool.len;
+	memcpy( buf + head->strings, pool.text, pool.len );
+
+	opts = (struct sg_snapopt_s *) (buf + head->options);
+	types = buf + at;
+	values = buf + ALIGN( at + typeBytes );
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		o = &spec->optionlist[i];
+		byName[i].name = o->name;
+		byName[i].option = i;
+		opts[i].name = head->strings + intern( &pool, o->name );
+		opts[i].count = values_of( ctx, o, &array );
+		opts[i].packed = array != NULL || opts[i].count == 0;
+		opts[i].types = types - buf;
+		opts[i].values = values - buf;
+
+		for( k = 0 ; k < (opts[i].packed ? 1 : opts[i].count) ; k++ ) *types++ = (char) type_at( o, k );
+
+		for( k = 0 ; k < opts[i].count ; k++ )
+		{
+			type = type_at( o, k );
+			value = value_at( ctx, o, array, k );
+			if( type == SG_TYPE_STRING )
+			{
+				memcpy( &value, value, sizeof(char *) );
+				offset = value != NULL ? head->strings + intern( &pool, value ) : 0;
+				memcpy( values, &offset, SLOT );
+			}
+			else memcpy( values, value, sg_type_sizes[type] );
+			values += value_width( type, opts[i].packed );
+		}
+		values = buf + ALIGN( values - buf );
+	}
+
+	qsort( byName, spec->optnum, sizeof(struct sg_byname_s), compare_names );
+	for( i = 0 ; i < spec->optnum ; i++ ) ((int *) (buf + head->byName))[i] = byName[i].option;
+
+	n = write_all( fd, buf, head->size );
+
+	free( buf );
+	free( byName );
+	free( pool.text );
+	free( pool.slots );
+
+	return( n );
+}
+
+int superSnapshotFd( const SG_CTX *ctx, int *pFd )
+{
+	int fd = -1, n;
+
+	*pFd = -1;
+
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+	fd = memfd_create( "supergetopt-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING );
+#endif
+	if( fd < 0 )
+	{
+		FILE *fp = tmpfile();
+
+		if( fp == NULL ) return( SG_ERROR_FILE );
+#ifndef _WIN32
+		fd = dup( fileno( fp ) );
+#else
+		fd = _dup( _fileno( fp ) );
+#endif
+		fclose( fp );
+		if( fd < 0 ) return( SG_ERROR_FILE );
+	}
+
+	n = superWriteSnapshot( ctx, fd );
+	if( n < 0 )
+	{
+#ifndef _WIN32
+		close( fd );
+#else
+		_close( fd );
+#endif
+		return( n );
+	}
+
+#if defined(__linux__) && defined(F_ADD_SEALS)
+	// nobody can change it under the processes that map it
+	fcntl( fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL );
+#endif
+
+	*pFd = fd;
+
+	return(0);
+}
+
+int superMapSnapshot( const SG_SNAPSHOT **pSnap, int fd )
+{
+	char *base;
+	size_t size;
+	int n;
+#ifndef _WIN32
+	struct stat st;
+#else
+	long end;
+#endif
+
+	*pSnap = NULL;
+
+#ifndef _WIN32
+	if( fstat( fd, &st ) < 0 ) return( SG_ERROR_FILE );
+	size = (size_t) st.st_size;
+	if( size < sizeof(struct sg_snaphead_s) ) return( SG_ERROR_BAD_SNAPSHOT );
+
+	base = (char *) mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+	if( base == MAP_FAILED ) return( SG_ERROR_FILE );
+#else
+	end = _lseek( fd, 0, SEEK_END );
+	if( end < (long) sizeof(struct sg_snaphead_s) ) return( end < 0 ? SG_ERROR_FILE : SG_ERROR_BAD_SNAPSHOT );
+	size = (size_t) end;
+	base = (char *) malloc( size );
+	if( base == NULL ) return( SG_ERROR_NO_MEMORY );
+	if( _lseek( fd, 0, SEEK_SET ) != 0 || _read( fd, base, (unsigned int) size ) != (int) size )
+	{
+		free( base );
+		return( SG_ERROR_FILE );
+	}
+#endif
+
+	// a refused file's header is not to be trusted, its size included
+	n = check_snapshot( base, size );
+	if( n < 0 )
+	{
+#ifndef _WIN32
+		munmap( base, size );
+#else
+		free( base );
+#endif
+		return( n );
+	}
+
+	*pSnap = (const SG_SNAPSHOT *) base;
+
+	return(0);
+}
+
+/* snap passed check_snapshot(), so its size is the mapping's */
+void superUnmapSnapshot( const SG_SNAPSHOT *snap )
+{
+	if( snap == NULL ) return;
+
+#ifndef _WIN32
+	munmap( (void *) snap, ((const struct sg_snaphead_s *) snap)->size );
+#else
+	free( (void *) snap );
+#endif
+}
+
+int superSnapLookup( const SG_SNAPSHOT *snap, const char *name )
+{
+	const char *base = (const char *) snap;
+	const struct sg_snaphead_s *head = (const struct sg_snaphead_s *) base;
+	const struct sg_snapopt_s *opts = (const struct sg_snapopt_s *) (base + head->options);
+	const int *byName = (const int *) (base + head->byName);
+	int lo = 0, hi = (int) head->optnum, mid, c;
+
+	while( lo < hi )
+	{
+		mid = (lo + hi) / 2;
+		c = strcmp( base + opts[byName[mid]].name, name );
+		if( c == 0 ) return( byName[mid] );
+		if( c < 0 ) lo = mid + 1;
+		else hi = mid;
+	}
+
+	return(-1);
+}
+
+int superSnapCount( const SG_SNAPSHOT *snap, int option )
+{
+	const struct sg_snaphead_s *head = (const struct sg_snaphead_s *) snap;
+
+	if( option < 0 || option >= (int) head->optnum ) return(-1);
+	return( ((const struct sg_snapopt_s *) ((const char *) snap + head->options))[option].count );
+}
+
+const void *superSnapValue( const SG_SNAPSHOT *snap, int option, int arg, int *pType )
+{
+	const char *base = (const char *) snap;
+	const struct sg_snaphead_s *head = (const struct sg_snaphead_s *) base;
+	const struct sg_snapopt_s *opt;
+	unsigned long long offset;
+	const char *p;
+	int type;
+
+	if( option < 0 || option >= (int) head->optnum ) return( NULL );
+	opt = (const struct sg_snapopt_s *) (base + head->options) + option;
+	if( arg < 0 || arg >= opt->count ) return( NULL );
+
+	type = base[opt->types + (opt->packed ? 0 : arg)];
+	p = base + opt->values + arg * value_width( type, opt->packed );
+	if( pType != NULL ) *pType = type;
+	if( type != SG_TYPE_STRING ) return( p );
+
+	memcpy( &offset, p, SLOT );
+	if( offset < head->strings || offset >= head->size ) return( NULL );
+	return( base + offset );
+}
+
+static int compare_names( const void *a, const void *b )
+{
+	return( strcmp( ((const struct sg_byname_s *) a)->name, ((const struct sg_byname_s *) b)->name ) );
+}
+
+/* Number of values an option's outputs hold. *pArray is set to them when
+	they are consecutive (flags, var-arg and "+" lists), else to NULL. */
+static int values_of( const SG_CTX *ctx, const struct optionlist_s *o, const char **pArray )
+{
+	int count;
+
+	*pArray = NULL;
+	if( o->stream != NULL ) return(0);
+	if( o->numargs == 0 )
+	{
+		*pArray = (const char *) sg_output( ctx, o->argptr[0].i );
+		return(1);
+	}
+	if( o->managed )
+	{
+		*pArray = *(const char **) sg_output( ctx, o->argptr[0].c );
+		count = *(int *) sg_output( ctx, o->pNumArgs );
+		return( *pArray != NULL ? count : 0 );
+	}
+	if( o->varflag )
+	{
+		*pArray = (const char *) sg_output( ctx, o->argptr[0].c );
+		count = *(int *) sg_output( ctx, o->pNumArgs );
+		return( count < o->numArgsMax ? count : o->numArgsMax );
+	}
+
+	return( o->numargs );
+}
+
+static const char *value_at( const SG_CTX *ctx, const struct optionlist_s *o, const char *array, int k )
+{
+	if( array != NULL ) return( array + k * sg_type_sizes[type_at( o, k )] );
+	return( (const char *) sg_output( ctx, o->argptr[k].c ) );
+}
+
+static int type_at( const struct optionlist_s *o, int k )
+{
+	if( o->numargs == 0 ) return( SG_TYPE_INT );
+	return( o->argtype[o->varflag || o->managed ? 0 : k] );
+}
+
+static size_t value_width( int type, int packed )
+{
+	if( !packed || type == SG_TYPE_STRING ) return( SLOT );
+	return( sg_type_sizes[type] );
+}
+
+/* FNV-1a, cut to a size_t */
+static size_t string_hash( const char *s )
+{
+	unsigned long long h = 14695981039346656037ULL;
+
+	for( ; *s != '\0' ; s++ ) h = (h ^ (unsigned char) *s) * 1099511628211ULL;
+
+	return( (size_t) h );
+}
+
+/* s's offset in the pool, adding it if new; -1 if out of memory */
+static long intern( struct sg_pool_s *pool, const char *s )
+{
+	size_t len = strlen( s ), h = string_hash( s ), k;
+	size_t *slots;
+
+	for( k = h & pool->mask ; pool->slots != NULL && pool->slots[k] != 0 ; k = (k + 1) & pool->mask )
+	{
+		if( strcmp( pool->text + pool->slots[k] - 1, s ) == 0 ) return( (long) (pool->slots[k] - 1) );
+	}
+
+	if( 2 * (pool->used + 1) > pool->mask + 1 || pool->slots == NULL )
+	{
+		// rehash into twice the slots
+		size_t size = pool->slots != NULL ? 2 * (pool->mask + 1) : 256, j, g;
+
+		slots = (size_t *) calloc( size, sizeof(size_t) );
+		if( slots == NULL ) return(-1);
+		for( j = 0 ; pool->slots != NULL && j <= pool->mask ; j++ )
+		{
+			if( pool->slots[j] == 0 ) continue;
+			for( g = string_hash( pool->text + pool->slots[j] - 1 ) & (size - 1) ; slots[g] != 0 ; g = (g + 1) & (size - 1) );
+			slots[g] = pool->slots[j];
+		}
+		free( pool->slots );
+		pool->slots = slots;
+		pool->mask = size - 1;
+		for( k = h & pool->mask ; pool->slots[k] != 0 ; k = (k + 1) & pool->mask );
+	}
+
+	if( pool->len + len + 1 > pool->cap )
+	{
+		size_t cap = pool->cap > 0 ? 2 * pool->cap : 4096;
+		char *text;
+
+		while( cap < pool->len + len + 1 ) cap *= 2;
+		text = (char *) realloc( pool->text, cap );
+		if( text == NULL ) return(-1);
+		pool->text = text;
+		pool->cap = cap;
+	}
+
+	memcpy( pool->text + pool->len, s, len + 1 );
+	pool->slots[k] = pool->len + 1;
+	pool->len += len + 1;
+	pool->used++;
+
+	return( (long) (pool->slots[k] - 1) );
+}
+
+static int write_all( int fd, const char *buf, size_t len )
+{
+	long n;
+
+	while( len > 0 )
+	{
+#ifndef _WIN32
+		n = (long) write( fd, buf, len );
+#else
+		n = _write( fd, buf, (unsigned int) len );
+#endif
+		if( n <= 0 ) return( SG_ERROR_FILE );
+		buf += n;
+		len -= (size_t) n;
+	}
+
+	return(0);
+}
+
+/* Everything the accessors rely on: the header, the tables inside the
+	snapshot, known types and names inside the pool. */
+static int check_snapshot( const char *base, size_t size )
+{
+	const struct sg_snaphead_s *head = (const struct sg_snaphead_s *) base;
+	const struct sg_snapopt_s *opt;
+	unsigned long long n;
+	int i, k;
+
+	if( memcmp( head->magic, SNAP_MAGIC, sizeof(head->magic) ) != 0 || head->order != SNAP_ORDER || head->size != size ) return( SG_ERROR_BAD_SNAPSHOT );
+	if( head->options > size || head->optnum > (size - head->options) / sizeof(struct sg_snapopt_s) ) return( SG_ERROR_BAD_SNAPSHOT );
+	if( head->byName > size || head->optnum > (size - head->byName) / sizeof(int) ) return( SG_ERROR_BAD_SNAPSHOT );
+	if( head->strings > size || head->stringBytes == 0 || head->stringBytes != size - head->strings || base[size-1] != '\0' ) return( SG_ERROR_BAD_SNAPSHOT );
+
+	for( i = 0 ; i < (int) head->optnum ; i++ )
+	{
+		opt = (const struct sg_snapopt_s *) (base + head->options) + i;
+		n = opt->packed ? 1 : (unsigned long long) opt->count;
+		if( opt->count < 0 || opt->name < head->strings || opt->name >= size ) return( SG_ERROR_BAD_SNAPSHOT );
+		if( opt->types > size || n > size - opt->types ) return( SG_ERROR_BAD_SNAPSHOT );
+		for( k = 0 ; k < (int) n ; k++ )
+		{
+			if( base[opt->types + k] < 0 || base[opt->types + k] >= SG_NUM_TYPES ) return( SG_ERROR_BAD_SNAPSHOT );
+		}
+		n = (unsigned long long) opt->count * value_width( base[opt->types], opt->packed );
+		if( opt->values > size || n > size - opt->values ) return( SG_ERROR_BAD_SNAPSHOT );
+		k = ((const int *) (base + head->byName))[i];
+		if( k < 0 || k >= (int) head->optnum ) return( SG_ERROR_BAD_SNAPSHOT );
+	}
+
+	return(0);
+}
@@ -0,0 +1,123 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Layout of a compiled spec. Shared by superGetOpt.c and the static
+	tables that superSpecGen emits, which must be regenerated whenever
+	this file changes. Not part of the API. */
+
+#ifndef __SUPERGETOPTTABLES
+#define __SUPERGETOPTTABLES
+
+#include <stddef.h>
+#include "supergetopt.h"
+
+typedef union
+{
+	char *c;
+	short *h;
+	int *i;
+	float *f;
+	double *d;
+	char **string;
+} PANYTYPE;
+
+struct optionlist_s 
+{
+	char *name;
+	int numargs;
+	int varflag;
+	int *argtype;
+	PANYTYPE *argptr;
+	int *pNumArgs;
+	int numArgsMax;
+	char *helpString;
+	int namelen;
+	int managed;	// "+" format: argptr[0] points at the caller's array pointer
+	SG_STREAM_FN stream;	// ">" format: argptr[0] is the callback's data
+};
+
+/* Option names are looked up through a perfect hash built when the spec is
+	compiled (hash and displace: the first hash picks a bucket, the bucket's
+	displacement picks a collision-free slot). Tokens whose first byte or
+	length cannot belong to any option are rejected before hashing. */
+struct sg_hashslot_s
+{
+	int option;		// index into optionlist, -1 if the slot is empty
+	int namelen;
+};
+
+/* Tokens that are not option names are tried as abbreviations through a
+	trie of the names. Each node's children sit next to each other in byte
+	order, and every node knows the range of byName (the option indices
+	sorted by name) whose names share its prefix, so a walk of the token's
+	bytes ends at the one option it abbreviates or at all the candidates. */
+struct sg_trienode_s
+{
+	unsigned char c;	// byte leading to this node
+	unsigned short numChildren;
+	int firstChild;
+	int lo, hi;		// names with this prefix are byName[lo..hi)
+};
+
+/* An option's environment variable, with its name hashed the way the
+	environment index hashes names. */
+struct sg_envname_s
+{
+	const char *name;	// NULL: the option has no variable
+	int namelen;
+	unsigned long long hash;
+};
+
+/* A compiled option spec. Built once by superCompileOpt() and never
+	modified afterwards, except by superEnvOpt() and superPrefixOpt()
+	before its first parse; the parse entry points only read it. Specs
+	emitted by superSpecGen are static and have resultsSize set. */
+struct sg_spec_s
+{
+	int optnum;
+	int numManaged;
+	int responseOpt;	// 1 + index of the "@" flag; 0: no response files
+	unsigned long long setupNs;
+	struct optionlist_s *optionlist;
+	PANYTYPE *argptrs;	// storage behind each option's argptr/argtype
+	int *argtypes;
+	char *names;
+	int maxNameLen;
+	unsigned char firstBytes[256/8];	// bitmap of first bytes of option names
+	unsigned int bucketMask;
+	unsigned int slotMask;
+	unsigned int *disp;		// displacement per bucket
+	struct sg_hashslot_s *slots;
+	int *byName;		// option indices sorted by name, repeated names dropped
+	struct sg_trienode_s *trie;	// root first; NULL: not built
+	int prefixes;		// 1: abbreviations select options (superPrefixOpt)
+	char *usage[2];		// rendered by superUsageText() on first use, by SG_USAGE_*
+	size_t usageLen[2];
+	struct sg_envname_s *env;	// by option; NULL: no environment fallback
+	size_t resultsSize;	// > 0: outputs are offsets into a results struct of this size
+};
+
+#endif
@@ -0,0 +1,249 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Usage output. The text and JSON forms are rendered once per spec into
+	a heap buffer that hangs off the spec, so repeated help requests cost
+	one write(). Compiled specs are shared between threads, so the buffer
+	is published with a compare-and-swap; a thread that loses the race
+	frees its copy, which is identical. superSpecGen renders both forms at
+	build time, so generated specs never allocate. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+struct sg_text_s
+{
+	char *buf;
+	size_t len;
+	size_t cap;
+	int failed;
+};
+
+static void put( struct sg_text_s *t, const char *s, size_t n );
+static void puts_text( struct sg_text_s *t, const char *s );
+static void puts_json( struct sg_text_s *t, const char *s );
+static void render_text( const SG_SPEC *spec, struct sg_text_s *t );
+static void render_json( const SG_SPEC *spec, struct sg_text_s *t );
+
+const char *superUsageText( const SG_SPEC *spec, int format, size_t *pLen )
+{
+	SG_SPEC *cache = (SG_SPEC *) spec;	// the usage fields are a cache
+	struct sg_text_s t;
+	char *expected = NULL;
+	char *text;
+
+	if( format != SG_USAGE_TEXT && format != SG_USAGE_JSON ) return( NULL );
+
+	text = __atomic_load_n( &cache->usage[format], __ATOMIC_ACQUIRE );
+	if( text == NULL )
+	{
+		memset( &t, 0, sizeof(t) );
+		if( format == SG_USAGE_TEXT ) render_text( spec, &t );
+		else render_json( spec, &t );
+		put( &t, "", 1 );	// NUL, not counted
+		if( t.failed )
+		{
+			free( t.buf );
+			return( NULL );
+		}
+
+		__atomic_store_n( &cache->usageLen[format], t.len - 1, __ATOMIC_RELAXED );
+		if( __atomic_compare_exchange_n( &cache->usage[format], &expected, t.buf, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) text = t.buf;
+		else
+		{
+			free( t.buf );
+			text = expected;
+		}
+	}
+
+	if( pLen != NULL ) *pLen = __atomic_load_n( &cache->usageLen[format], __ATOMIC_RELAXED );
+
+	return( text );
+}
+
+int superWriteUsage( const SG_SPEC *spec, int format, int fd )
+{
+	const char *text;
+	size_t len, done;
+	long n;
+
+	text = superUsageText( spec, format, &len );
+	if( text == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	// anything the caller printed through stdio goes first
+	if( fd == 1 ) fflush( stdout );
+	else if( fd == 2 ) fflush( stderr );
+
+	// one write() unless the descriptor takes less (pipes, signals)
+	for( done = 0 ; done < len ; done += (size_t) n )
+	{
+		n = (long) write( fd, text + done, len - done );
+		if( n <= 0 ) return( SG_ERROR_FILE );
+	}
+
+	return(0);
+}
+
+void sg_free_usage( SG_SPEC *spec )
+{
+	free( spec->usage[SG_USAGE_TEXT] );
+	free( spec->usage[SG_USAGE_JSON] );
+}
+
+static void put( struct sg_text_s *t, const char *s, size_t n )
+{
+	char *grown;
+	size_t cap;
+
+	if( t->failed ) return;
+
+	if( t->len + n > t->cap )
+	{
+		for( cap = t->cap > 0 ? 2 * t->cap : 1024 ; cap < t->len + n ; cap *= 2 );
+		grown = (char *) realloc( t->buf, cap );
+		if( grown == NULL )
+		{
+			t->failed = 1;
+			return;
+		}
+		t->buf = grown;
+		t->cap = cap;
+	}
+
+	memcpy( t->buf + t->len, s, n );
+	t->len += n;
+}
+
+static void puts_text( struct sg_text_s *t, const char *s )
+{
+	put( t, s, strlen( s ) );
+}
+
+/* a JSON string literal, quotes included */
+static void puts_json( struct sg_text_s *t, const char *s )
+{
+	char esc[8];
+	const char *run;
+
+	put( t, "\"", 1 );
+	for( run = s ; *s != '\0' ; s++ )
+	{
+		unsigned char c = (unsigned char) *s;
+
+		if( c >= 0x20 && c != '"' && c != '\\' ) continue;
+
+		put( t, run, s - run );
+		if( c == '"' || c == '\\' ) sprintf( esc, "\\%c", c );
+		else if( c == '\n' ) strcpy( esc, "\\n" );
+		else if( c == '\t' ) strcpy( esc, "\\t" );
+		else sprintf( esc, "\\u%04x", c );
+		puts_text( t, esc );
+		run = s + 1;
+	}
+	put( t, run, s - run );
+	put( t, "\"", 1 );
+}
+
+/* the same layout the per-option printf()s used to produce */
+static void render_text( const SG_SPEC *spec, struct sg_text_s *t )
+{
+	const struct optionlist_s *option;
+	const char *type;
+	int i, k;
+
+	if( spec->optnum > 0 ) puts_text( t, "***** Usage *****\n" );
+
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		option = &spec->optionlist[i];
+
+		puts_text( t, "\t " );
+		puts_text( t, option->name );
+		for( k = 0 ; k < option->numargs ; k++ )
+		{
+			type = sg_type_names[option->argtype[k]];
+			puts_text( t, " " );
+			puts_text( t, type );
+			if( option->varflag == 0 && option->managed ) puts_text( t, " (repeatable)" );
+			else if( option->varflag != 0 )
+			{
+				puts_text( t, " [" );
+				puts_text( t, type );
+				puts_text( t, ", ...]" );
+				if( option->stream != NULL ) puts_text( t, " (streamed)" );
+			}
+		}
+#if SG_ENABLE_HELPSTRING
+		if( option->helpString != NULL )
+		{
+			puts_text( t, " <" );
+			puts_text( t, option->helpString );
+			puts_text( t, ">" );
+		}
+#endif
+		puts_text( t, "\n" );
+	}
+}
+
+/* {"options":[{"name":...,"types":[...],"var":...,"repeatable":...,
+	"streamed":...,"help":...},...]} on one line */
+static void render_json( const SG_SPEC *spec, struct sg_text_s *t )
+{
+	const struct optionlist_s *option;
+	int i, k;
+
+	puts_text( t, "{\"options\":[" );
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		option = &spec->optionlist[i];
+
+		puts_text( t, i > 0 ? ",{\"name\":" : "{\"name\":" );
+		puts_json( t, option->name );
+		puts_text( t, ",\"types\":[" );
+		for( k = 0 ; k < option->numargs ; k++ )
+		{
+			if( k > 0 ) puts_text( t, "," );
+			puts_json( t, sg_type_names[option->argtype[k]] );
+		}
+		puts_text( t, option->varflag ? "],\"var\":true" : "],\"var\":false" );
+		puts_text( t, option->managed ? ",\"repeatable\":true" : ",\"repeatable\":false" );
+		puts_text( t, option->stream != NULL ? ",\"streamed\":true" : ",\"streamed\":false" );
+		puts_text( t, ",\"help\":" );
+		if( option->helpString != NULL ) puts_json( t, option->helpString );
+		else puts_text( t, "null" );
+		puts_text( t, "}" );
+	}
+	puts_text( t, "]}\n" );
+}
@@ -0,0 +1,613 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+
+/* Watched config files (superWatchFile). A reload tokenizes the whole new
+	version of the file, but tokenizing and hashing are cheap next to
+	option lookup and conversion, which only the lines that need it get:
+
+	1. Every line's tokens are hashed and the old and new hash sequences
+	   are lined up: equal lines match, and around a difference the next
+	   RESYNC_WINDOW lines on each side are searched for a match before
+	   the two lines are taken as replaced. Matches keep file order.
+	2. The new and changed lines are parsed in file order (pass A). Each
+	   line's record lists the options it sets, so unchanged lines carry
+	   theirs over without parsing.
+	3. An option is dirty when a removed or changed line sets it. Its new
+	   value comes from its owner, the last line that sets it: a changed
+	   owner already wrote it in pass A; an unchanged owner is parsed
+	   again (pass B, file order), and without an owner it goes back to
+	   its default.
+	4. Parsing a line writes every option on it, including ones a later
+	   line owns, so every option a pass touched and its owner did not
+	   write last is restored from a snapshot: the one taken after pass A,
+	   the one from before the reload, or the defaults.
+
+	%s results point into the mapping the owner was parsed from, so old
+	mappings stay open while some owner needs them; when SG_WATCH_MAPS of
+	them are open, the owners still in them are parsed again from the new
+	one so the old ones can go. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#define RESYNC_WINDOW 64
+
+struct sg_wline_s
+{
+	unsigned long long hash;	// of the line's tokens
+	int line;			// line number of its first token
+	int map;			// mapping its outputs were parsed from
+	int firstOpt;		// the options it sets, in the watch's opts
+	int numOpts;
+	int stray;			// tokens that belong to no option
+	int firstToken;		// during a reload: its tokens in the watch's tokens
+	int numTokens;
+	int match;			// during a reload: new lines, the old line or -1; old lines, 1 if matched
+	int reparse;		// during a reload: parsed in pass B
+};
+
+struct sg_watch_s
+{
+	SG_CTX ctx;
+	char *path;
+	const char *name;	// file name part of path
+	int fd;			// inotify, -1 without
+	struct stat st;	// of the version last loaded
+	SG_FILE *maps[SG_WATCH_MAPS+1];
+	struct sg_wline_s *lines;
+	int numLines;
+	int *opts;
+	int numOpts;
+	int stray;
+	int *owner;		// by option: the last line that sets it, -1 if none
+	size_t *offsets;	// by option: where its snapshot goes
+	char *defaults;	// outputs before the first reload
+	char *before;		// outputs before the current reload
+	char *afterA;		// outputs of options pass A wrote
+	unsigned char *seen;
+	int *given;
+	unsigned char *touched;
+	int *touchedList;
+	int numTouched;
+	unsigned char *dirty;
+	int *changed;
+	int numChanged;
+	int line;
+	char **tokens;
+	int numTokens;
+	int maxTokens;
+};
+
+static unsigned long long line_hash( unsigned long long h, const char *token );
+static int read_lines( SG_WATCH *watch, SG_FILE *file, struct sg_wline_s **pLines, int *pNumLines );
+static void match_lines( struct sg_wline_s *old, int numOld, struct sg_wline_s *lines, int numLines );
+static int parse_line( SG_WATCH *watch, const struct sg_wline_s *line, int *lastArg );
+static void restore_all( SG_WATCH *watch, const char *snapshot );
+static void *grow( void *array, int *pMax, int need, size_t width );
+
+int superWatchFile( SG_WATCH **pWatch, const SG_CTX *ctx, const char *path )
+{
+	const SG_SPEC *spec = ctx->spec;
+	SG_WATCH *watch;
+	size_t bytes = 0;
+	char *slash;
+	int i, bitmap = (spec->optnum + 7) / 8;
+
+	*pWatch = NULL;
+
+	if( spec->numManaged > 0 || spec->responseOpt > 0 ) return( SG_ERROR_NOT_RELOADABLE );
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( spec->optionlist[i].stream != NULL ) return( SG_ERROR_NOT_RELOADABLE );
+	}
+
+	watch = (SG_WATCH *) calloc( 1, sizeof(SG_WATCH) );
+	if( watch == NULL ) return( SG_ERROR_NO_MEMORY );
+
+	superInitCtx( &watch->ctx, spec, NULL, NULL, 0 );
+	watch->ctx.origin = ctx->origin;
+	watch->ctx.base = ctx->base;
+	watch->ctx.size = ctx->size;
+	watch->ctx.parallelMin = ctx->parallelMin;
+	watch->ctx.parallelThreads = ctx->parallelThreads;
+	watch->fd = -1;
+
+	watch->offsets = (size_t *) malloc( (spec->optnum + 1) * sizeof(size_t) );
+	if( watch->offsets != NULL )
+	{
+		for( i = 0 ; i < spec->optnum ; i++ )
+		{
+			watch->offsets[i] = bytes;
+			bytes += sg_option_bytes( spec, i );
+		}
+		watch->offsets[i] = bytes;
+	}
+
+	watch->path = (char *) malloc( strlen( path ) + 1 );
+	watch->owner = (int *) malloc( (spec->optnum + 1) * sizeof(int) );
+	watch->defaults = (char *) malloc( bytes + 1 );
+	watch->before = (char *) malloc( bytes + 1 );
+	watch->afterA = (char *) malloc( bytes + 1 );
+	watch->seen = (unsigned char *) calloc( 3 * bitmap + 1, 1 );
+	watch->given = (int *) malloc( (2 * spec->optnum + 1) * sizeof(int) );
+	watch->changed = (int *) malloc( (spec->optnum + 1) * sizeof(int) );
+	if( watch->offsets == NULL || watch->path == NULL || watch->owner == NULL || watch->defaults == NULL || watch->before == NULL || watch->afterA == NULL || watch->seen == NULL || watch->given == NULL || watch->changed == NULL )
+	{
+		superFreeWatch( watch );
+		return( SG_ERROR_NO_MEMORY );
+	}
+	watch->touched = watch->seen + bitmap;
+	watch->dirty = watch->touched + bitmap;
+	watch->touchedList = watch->given + spec->optnum;
+
+	strcpy( watch->path, path );
+	slash = strrchr( watch->path, '/' );
+	watch->name = slash != NULL ? slash + 1 : watch->path;
+
+	// what the outputs go back to when no line sets them
+	sg_reset_outputs( &watch->ctx );
+	for( i = 0 ; i < spec->optnum ; i++ ) sg_copy_option( &watch->ctx, i, watch->defaults + watch->offsets[i], 1 );
+
+#ifdef __linux__
+	watch->fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if( watch->fd >= 0 )
+	{
+		// the directory, so that editors replacing the file are seen too
+		if( slash != NULL ) *slash = '\0';
+		i = inotify_add_watch( watch->fd, slash == watch->path ? "/" : slash != NULL ? watch->path : ".", IN_CLOSE_WRITE | IN_MOVED_TO );
+		if( slash != NULL ) *slash = '/';
+		if( i < 0 )
+		{
+			close( watch->fd );
+			watch->fd = -1;
+		}
+	}
+#endif
+
+	*pWatch = watch;
+
+	return(0);
+}
+
+void superFreeWatch( SG_WATCH *watch )
+{
+	int m;
+
+	if( watch == NULL ) return;
+
+#ifdef __linux__
+	if( watch->fd >= 0 ) close( watch->fd );
+#endif
+	for( m = 0 ; m <= SG_WATCH_MAPS ; m++ ) superCloseFile( watch->maps[m] );
+	free( watch->path );
+	free( watch->lines );
+	free( watch->opts );
+	free( watch->owner );
+	free( watch->offsets );
+	free( watch->defaults );
+	free( watch->before );
+	free( watch->afterA );
+	free( watch->seen );
+	free( watch->given );
+	free( watch->changed );
+	free( watch->tokens );
+	free( watch );
+}
+
+int superWatchFd( const SG_WATCH *watch )
+{
+	return( watch->fd );
+}
+
+int superWatchChanges( const SG_WATCH *watch, const int **options )
+{
+	*options = watch->changed;
+	return( watch->numChanged );
+}
+
+int superWatchLine( const SG_WATCH *watch )
+{
+	return( watch->line );
+}
+
+int superWatchPoll( SG_WATCH *watch, int timeoutMs )
+{
+	struct stat st;
+
+#ifdef __linux__
+	if( watch->fd >= 0 )
+	{
+		union
+		{
+			struct inotify_event event;
+			char bytes[4096];
+		} buf;
+		struct pollfd p;
+		struct inotify_event *e;
+		ssize_t got;
+		char *q;
+		int hit = 0;
+
+		p.fd = watch->fd;
+		p.events = POLLIN;
+		if( poll( &p, 1, timeoutMs ) < 0 ) return( errno == EINTR ? 0 : SG_ERROR_FILE );
+
+		// drain every queued event; any of them may name the file
+		while( (got = read( watch->fd, buf.bytes, sizeof(buf.bytes) )) > 0 )
+		{
+			for( q = buf.bytes ; q < buf.bytes + got ; q += sizeof(struct inotify_event) + e->len )
+			{
+				e = (struct inotify_event *) q;
+				if( e->len > 0 && strcmp( e->name, watch->name ) == 0 ) hit = 1;
+			}
+		}
+		if( got < 0 && errno != EAGAIN && errno != EINTR ) return( SG_ERROR_FILE );
+
+		return( hit );
+	}
+#endif
+
+	(void) timeoutMs;
+	if( stat( watch->path, &st ) < 0 ) return( SG_ERROR_FILE );
+
+	return( st.st_mtime != watch->st.st_mtime || st.st_size != watch->st.st_size || st.st_ino != watch->st.st_ino );
+}
+
+int superReloadFile( SG_WATCH *watch, int *lastArg )
+{
+	SG_CTX *ctx = &watch->ctx;
+	const SG_SPEC *spec = ctx->spec;
+	struct sg_wline_s *old = watch->lines, *lines = NULL, *line;
+	int *opts = NULL, *owner = watch->owner;
+	int numOld = watch->numLines, numLines = 0, numOpts = 0, maxOpts = 0;
+	int refs[SG_WATCH_MAPS+1];
+	int map, live = 0, compact, stray = 0;
+	int i, j, k, n;
+
+	*lastArg = 0;
+	watch->line = 0;
+	watch->numChanged = 0;
+
+	// a free slot for the new mapping; with none left, empty the old ones
+	for( map = -1, i = 0 ; i <= SG_WATCH_MAPS ; i++ )
+	{
+		if( watch->maps[i] != NULL ) live++;
+		else if( map < 0 ) map = i;
+	}
+	compact = live == SG_WATCH_MAPS;
+
+	n = superOpenFile( &watch->maps[map], watch->path );
+	if( n < 0 ) return( n );
+	stat( watch->path, &watch->st );
+	for( i = 0 ; i < spec->optnum ; i++ ) sg_copy_option( ctx, i, watch->before + watch->offsets[i], 1 );
+
+	n = read_lines( watch, watch->maps[map], &lines, &numLines );
+	if( n < 0 ) goto failed;
+	match_lines( old, numOld, lines, numLines );
+
+	memset( watch->seen, 0, 3 * ((spec->optnum + 7) / 8) );
+	watch->numTouched = 0;
+	if( sg_begin_parse( ctx ) < 0 )
+	{
+		n = SG_ERROR_NO_MEMORY;
+		goto failed;
+	}
+	ctx->seen = watch->seen;
+	ctx->given = watch->given;
+	SG_STAT( ctx->stats.parses++ );
+
+	// pass A: option lists of unchanged lines carry over, new lines are parsed
+	for( k = 0 ; k < numLines ; k++ )
+	{
+		line = &lines[k];
+		if( line->match >= 0 )
+		{
+			n = old[line->match].numOpts;
+			line->map = old[line->match].map;
+			line->stray = old[line->match].stray;
+			j = old[line->match].firstOpt;
+		}
+		else
+		{
+			n = parse_line( watch, line, lastArg );
+			if( n < 0 ) goto failed;
+			line->map = map;
+			line->stray = n;
+			n = ctx->numGiven;
+			j = 0;
+		}
+
+		if( numOpts + n > maxOpts && (opts = (int *) grow( opts, &maxOpts, numOpts + n, sizeof(int) )) == NULL )
+		{
+			n = SG_ERROR_NO_MEMORY;
+			goto failed;
+		}
+		line->firstOpt = numOpts;
+		line->numOpts = n;
+		for( i = 0 ; i < n ; i++ )
+		{
+			opts[numOpts++] = line->match >= 0 ? watch->opts[j + i] : ctx->given[i];
+			if( line->match < 0 ) watch->dirty[opts[numOpts-1] >> 3] |= 1 << (opts[numOpts-1] & 7);
+		}
+		stray += line->stray;
+	}
+	for( i = 0 ; i < watch->numTouched ; i++ )
+	{
+		j = watch->touchedList[i];
+		sg_copy_option( ctx, j, watch->afterA + watch->offsets[j], 1 );
+	}
+
+	for( i = 0 ; i < numOld ; i++ )
+	{
+		if( old[i].match ) continue;
+		for( j = old[i].firstOpt ; j < old[i].firstOpt + old[i].numOpts ; j++ ) watch->dirty[watch->opts[j] >> 3] |= 1 << (watch->opts[j] & 7);
+	}
+
+	for( i = 0 ; i < spec->optnum ; i++ ) owner[i] = -1;
+	for( k = 0 ; k < numLines ; k++ )
+	{
+		for( j = lines[k].firstOpt ; j < lines[k].firstOpt + lines[k].numOpts ; j++ ) owner[opts[j]] = k;
+	}
+
+	// pass B: unchanged owners of dirty options, and of old mappings when compacting
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( owner[i] < 0 || lines[owner[i]].match < 0 ) continue;
+		if( (watch->dirty[i >> 3] & (1 << (i & 7))) || (compact && lines[owner[i]].map != map) ) lines[owner[i]].reparse = 1;
+	}
+	for( k = 0 ; k < numLines ; k++ )
+	{
+		if( !lines[k].reparse ) continue;
+		n = parse_line( watch, &lines[k], lastArg );
+		if( n < 0 ) goto failed;
+		lines[k].map = map;
+	}
+
+	// every option ends up with its owner's value
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		int dirty = watch->dirty[i >> 3] & (1 << (i & 7));
+		int touched = watch->touched[i >> 3] & (1 << (i & 7));
+
+		if( owner[i] >= 0 && lines[owner[i]].reparse )
+		{
+			// pass B parsed the owner after every other line that sets it
+		}
+		else if( owner[i] >= 0 && lines[owner[i]].match < 0 )
+		{
+			if( touched ) sg_copy_option( ctx, i, watch->afterA + watch->offsets[i], 0 );
+		}
+		else if( owner[i] < 0 )
+		{
+			if( dirty || touched ) sg_copy_option( ctx, i, watch->defaults + watch->offsets[i], 0 );
+		}
+		else if( touched ) sg_copy_option( ctx, i, watch->before + watch->offsets[i], 0 );
+
+		if( (dirty || touched) && sg_option_differs( ctx, i, watch->before + watch->offsets[i] ) ) watch->changed[watch->numChanged++] = i;
+	}
+
+	// mappings that no owner's results point into are closed
+	memset( refs, 0, sizeof(refs) );
+	for( i = 0 ; i < spec->optnum ; i++ )
+	{
+		if( owner[i] >= 0 ) refs[lines[owner[i]].map]++;
+	}
+	for( i = 0 ; i <= SG_WATCH_MAPS ; i++ )
+	{
+		if( refs[i] > 0 ) continue;
+		superCloseFile( watch->maps[i] );
+		watch->maps[i] = NULL;
+	}
+
+	free( old );
+	free( watch->opts );
+	watch->lines = lines;
+	watch->numLines = numLines;
+	watch->opts = opts;
+	watch->numOpts = numOpts;
+	watch->stray = stray;
+	SG_STAT( sg_merge_stats( ctx ) );
+	SG_STAT( superResetStats( ctx ) );
+
+	return( stray );
+
+failed:
+	restore_all( watch, watch->before );
+	free( lines );
+	free( opts );
+	superCloseFile( watch->maps[map] );
+	watch->maps[map] = NULL;
+	watch->numChanged = 0;
+	for( i = 0 ; i < spec->optnum ; i++ ) owner[i] = -1;
+	for( i = 0 ; i < numOld ; i++ )
+	{
+		for( j = old[i].firstOpt ; j < old[i].firstOpt + old[i].numOpts ; j++ ) owner[watch->opts[j]] = i;
+	}
+	SG_STAT( sg_merge_stats( ctx ) );
+	SG_STAT( superResetStats( ctx ) );
+
+	return( n );
+}
+
+/* FNV-1a over the tokens, each with its NUL */
+static unsigned long long line_hash( unsigned long long h, const char *token )
+{
+	do
+	{
+		h ^= (unsigned char) *token;
+		h *= 1099511628211ULL;
+	} while( *token++ != '\0' );
+
+	return( h );
+}
+
+/* Tokenizes the file into the watch's tokens, one record per line that
+	has any. */
+static int read_lines( SG_WATCH *watch, SG_FILE *file, struct sg_wline_s **pLines, int *pNumLines )
+{
+	struct sg_wline_s *lines = NULL, *line;
+	int numLines = 0, maxLines = 0;
+	char *token;
+
+	watch->numTokens = 0;
+	while( sg_file_more( file ) )
+	{
+		if( numLines == maxLines && (lines = (struct sg_wline_s *) grow( lines, &maxLines, numLines + 1, sizeof(struct sg_wline_s) )) == NULL ) return( SG_ERROR_NO_MEMORY );
+		line = &lines[numLines];
+		memset( line, 0, sizeof(struct sg_wline_s) );
+		line->hash = 14695981039346656037ULL;
+		line->firstToken = watch->numTokens;
+		line->match = -1;
+
+		while( (token = sg_file_line_token( file )) != NULL )
+		{
+			if( watch->numTokens == watch->maxTokens && (watch->tokens = (char **) grow( watch->tokens, &watch->maxTokens, watch->numTokens + 1, sizeof(char *) )) == NULL )
+			{
+				free( lines );
+				return( SG_ERROR_NO_MEMORY );
+			}
+			if( line->numTokens++ == 0 ) line->line = superFileLine( file );
+			watch->tokens[watch->numTokens++] = token;
+			line->hash = line_hash( line->hash, token );
+		}
+
+		if( sg_file_error( file ) < 0 )
+		{
+			watch->line = superFileLine( file );
+			free( lines );
+			return( sg_file_error( file ) );
+		}
+		if( line->numTokens > 0 ) numLines++;
+	}
+
+	*pLines = lines;
+	*pNumLines = numLines;
+
+	return(0);
+}
+
+/* Pairs new lines with equal old ones, in order; see the top of the file */
+static void match_lines( struct sg_wline_s *old, int numOld, struct sg_wline_s *lines, int numLines )
+{
+	int i = 0, k = 0, d;
+
+	for( d = 0 ; d < numOld ; d++ ) old[d].match = 0;
+
+	while( i < numOld && k < numLines )
+	{
+		if( old[i].hash == lines[k].hash )
+		{
+			old[i].match = 1;
+			lines[k].match = i;
+			i++;
+			k++;
+			continue;
+		}
+
+		for( d = 1 ; d <= RESYNC_WINDOW ; d++ )
+		{
+			if( k + d < numLines && lines[k+d].hash == old[i].hash ) break;
+			if( i + d < numOld && old[i+d].hash == lines[k].hash ) break;
+		}
+
+		if( d > RESYNC_WINDOW )
+		{
+			i++;	// replaced
+			k++;
+		}
+		else if( k + d < numLines && lines[k+d].hash == old[i].hash ) k += d;	// inserted
+		else i += d;	// removed
+	}
+}
+
+/* Parses one line's tokens. The options it sets are left in the
+	context's given list; the touched set collects them all. */
+static int parse_line( SG_WATCH *watch, const struct sg_wline_s *line, int *lastArg )
+{
+	SG_CTX *ctx = &watch->ctx;
+	struct sg_tokens_s s;
+	int i, o, n;
+
+	s.tokens = watch->tokens + line->firstToken;
+	s.num = line->numTokens;
+	s.next = 0;
+	ctx->numGiven = 0;
+
+	n = sg_parse_stream( ctx, sg_array_token, &s, lastArg );
+
+	for( i = 0 ; i < ctx->numGiven ; i++ )
+	{
+		o = ctx->given[i];
+		ctx->seen[o >> 3] &= ~(1 << (o & 7));
+		if( !(watch->touched[o >> 3] & (1 << (o & 7))) )
+		{
+			watch->touched[o >> 3] |= 1 << (o & 7);
+			watch->touchedList[watch->numTouched++] = o;
+		}
+	}
+
+	if( n < 0 ) watch->line = line->line;
+
+	return( n );
+}
+
+static void restore_all( SG_WATCH *watch, const char *snapshot )
+{
+	int i;
+
+	for( i = 0 ; i < watch->ctx.spec->optnum ; i++ ) sg_copy_option( &watch->ctx, i, (char *) snapshot + watch->offsets[i], 0 );
+}
+
+/* array with room for need elements, NULL (and array freed) when out of memory */
+static void *grow( void *array, int *pMax, int need, size_t width )
+{
+	void *grown;
+	int max = *pMax > 0 ? *pMax : 64;
+
+	while( max < need ) max *= 2;
+	grown = realloc( array, max * width );
+	if( grown == NULL )
+	{
+		free( array );
+		*pMax = 0;
+		return( NULL );
+	}
+	*pMax = max;
+
+	return( grown );
+}
@@ -0,0 +1,620 @@
+/*********************************************************************
+
+Copyright (c) 2007-2012, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* superSpecGen: compiles a spec file into C tables at build time.
+
+	superSpecGen -spec opts.spec -out opts -prefix opts [-abbrev]
+
+	writes opts.h and opts.c. Each line of the spec file is one option in
+	superGetOpt() syntax, as C string literals:
+
+		"-puffy %c %lf %s %d"	"help message 1"
+		"-vanna *%f"			"help message 2"	16
+		"-I +%s"				"include path, repeatable"
+		"-help"					"to get this help message"
+
+	A *%X list takes its capacity as a third field (default 32). Blank
+	lines and lines starting with # are skipped. The output has a results
+	struct with one field per argument (puffy_0 ... puffy_3, vanna[16] and
+	num_vanna, I and num_I, help), a const spec whose option table and
+	perfect hash are static data, and prefix_getopt()/prefix_parse()/
+	prefix_lookup(). Outputs are stored as offsets into the results
+	struct, so the tables need no relocation against the caller's data.
+	-abbrev makes the generated parser accept unambiguous abbreviations of
+	option names, as superPrefixOpt() does. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "superGetOptInt.h"
+#include "superGetOptTables.h"
+
+#define DEFAULT_CAPACITY 32
+#define MAXLINE 4096
+
+struct genopt_s
+{
+	char *format;
+	char *help;
+	int capacity;
+	int namelen;
+	int numargs;
+	int varflag;
+	int managed;
+	int *types;
+	char *field;
+};
+
+static const char *cTypes[SG_NUM_TYPES] = { "char ", "short ", "int ", "float ", "double ", "char *",
+	"long long ", "unsigned long long ", "unsigned int ", "size_t ", "unsigned int ", "unsigned long long ", "long long " };
+static const char *typeIds[SG_NUM_TYPES] = { "SG_TYPE_CHAR", "SG_TYPE_SHORT", "SG_TYPE_INT", "SG_TYPE_FLOAT", "SG_TYPE_DOUBLE", "SG_TYPE_STRING",
+	"SG_TYPE_LLONG", "SG_TYPE_ULLONG", "SG_TYPE_UINT", "SG_TYPE_SIZE", "SG_TYPE_HEX", "SG_TYPE_BYTES", "SG_TYPE_DURATION" };
+static const char *keywords[] = { "auto", "break", "case", "char", "const", "continue", "default", "do", "double",
+	"else", "enum", "extern", "float", "for", "goto", "if", "int", "long", "register", "return", "short",
+	"signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while" };
+
+static int read_spec( const char *path, struct genopt_s **pOpts, int *pNumOpts );
+static void free_opts( struct genopt_s *opts, int numOpts );
+static int read_cstring( char **pp, char **pOut );
+static char *make_field( const char *name, int namelen );
+static int check_names( struct genopt_s *opts, int numOpts );
+static int build_spec( struct genopt_s *opts, int numOpts, SG_SPEC **pSpec );
+static int last_child( const SG_SPEC *spec );
+static void put_cstring( FILE *fp, const char *s, int len );
+static int write_header( const char *path, const char *prefix, const char *specPath, struct genopt_s *opts, int numOpts );
+static int write_source( const char *path, const char *header, const char *prefix, const char *specPath, struct genopt_s *opts, int numOpts, const SG_SPEC *spec );
+
+int main( int argc, char *argv[] )
+{
+	char *specPath = NULL, *out = NULL, *prefix = NULL;
+	char *hPath, *cPath, *hName;
+	struct genopt_s *opts;
+	SG_SPEC *spec;
+	int n, argPos, numOpts, abbrev = 0, helpSet = 0;
+
+	n = superGetOpt( argc, argv, &argPos,
+			"-spec %s", &specPath, "spec file to compile",
+			"-out %s", &out, "output path without extension; .h and .c are added",
+			"-prefix %s", &prefix, "C identifier prefix for the generated names",
+			"-abbrev", &abbrev, "accept unambiguous abbreviations of option names",
+			"-help", &helpSet, "to get this help message",
+			(char *) 0 );
+	if( n != 0 || helpSet || specPath == NULL || out == NULL || prefix == NULL )
+	{
+		superGetOpt( 0, NULL, &argPos, NULL );
+		return( helpSet ? 0 : 1 );
+	}
+
+	if( read_spec( specPath, &opts, &numOpts ) < 0 ) return( 1 );
+	n = check_names( opts, numOpts );
+	if( n == 0 ) n = build_spec( opts, numOpts, &spec );
+	if( n < 0 )
+	{
+		free_opts( opts, numOpts );
+		return( 1 );
+	}
+	superPrefixOpt( spec, abbrev );
+
+	hPath = (char *) malloc( strlen( out ) + 3 );
+	cPath = (char *) malloc( strlen( out ) + 3 );
+	if( hPath == NULL || cPath == NULL )
+	{
+		fprintf(stderr, "superSpecGen: out of memory\n");
+		n = -1;
+	}
+	else
+	{
+		sprintf( hPath, "%s.h", out );
+		sprintf( cPath, "%s.c", out );
+		hName = strrchr( hPath, '/' ) != NULL ? strrchr( hPath, '/' ) + 1 : hPath;
+
+		n = write_header( hPath, prefix, specPath, opts, numOpts );
+		if( n == 0 ) n = write_source( cPath, hName, prefix, specPath, opts, numOpts, spec );
+	}
+
+	free( hPath );
+	free( cPath );
+	free_opts( opts, numOpts );
+	superFreeOpt( spec );
+
+	return( n < 0 ? 1 : 0 );
+}
+
+static int read_spec( const char *path, struct genopt_s **pOpts, int *pNumOpts )
+{
+	FILE *fp;
+	char line[MAXLINE];
+	char *p;
+	struct genopt_s *opts = NULL, *o;
+	int numOpts = 0, lineNo = 0, stream, n;
+
+	fp = fopen( path, "r" );
+	if( fp == NULL )
+	{
+		fprintf(stderr, "superSpecGen: cannot open %s\n", path);
+		return(-1);
+	}
+
+	while( fgets( line, sizeof(line), fp ) != NULL )
+	{
+		lineNo++;
+		p = line;
+		while( isspace( (unsigned char) *p ) ) p++;
+		if( *p == '\0' || *p == '#' ) continue;
+
+		o = (struct genopt_s *) realloc( opts, (numOpts + 1) * sizeof(struct genopt_s) );
+		if( o == NULL ) goto nomem;
+		opts = o;
+		o = &opts[numOpts++];	// counted now, so a failure below frees what it holds
+		memset( o, 0, sizeof(*o) );
+		o->capacity = DEFAULT_CAPACITY;
+
+		n = read_cstring( &p, &o->format );
+		if( n == SG_ERROR_NO_MEMORY ) goto nomem;
+		if( n < 0 ) goto bad;
+		while( isspace( (unsigned char) *p ) ) p++;
+		n = *p == '"' ? read_cstring( &p, &o->help ) : 0;
+		if( n == SG_ERROR_NO_MEMORY ) goto nomem;
+		if( n < 0 ) goto bad;
+		while( isspace( (unsigned char) *p ) ) p++;
+		if( isdigit( (unsigned char) *p ) ) o->capacity = (int) strtol( p, &p, 10 );
+		while( isspace( (unsigned char) *p ) ) p++;
+		if( *p != '\0' || o->capacity <= 0 ) goto bad;
+
+		o->types = (int *) malloc( (strlen( o->format ) + 1) * sizeof(int) );
+		if( o->types == NULL ) goto nomem;
+		o->numargs = sg_parse_format( o->format, &o->namelen, &o->varflag, &o->managed, &stream, o->types );
+		if( o->numargs < 0 )
+		{
+			fprintf(stderr, "%s:%d: bad format \"%s\" (error %d)\n", path, lineNo, o->format, o->numargs);
+			goto fail;
+		}
+		if( stream )
+		{
+			fprintf(stderr, "%s:%d: streamed lists need a callback, which a generated spec cannot hold\n", path, lineNo);
+			goto fail;
+		}
+		o->field = make_field( o->format, o->namelen );
+		if( o->field == NULL ) goto nomem;
+	}
+	fclose( fp );
+
+	*pOpts = opts;
+	*pNumOpts = numOpts;
+
+	return(0);
+
+bad:
+	fprintf(stderr, "%s:%d: expected \"format\" [\"help\"] [capacity]\n", path, lineNo);
+	goto fail;
+nomem:
+	fprintf(stderr, "superSpecGen: out of memory\n");
+fail:
+	fclose( fp );
+	free_opts( opts, numOpts );
+
+	return(-1);
+}
+
+static void free_opts( struct genopt_s *opts, int numOpts )
+{
+	int i;
+
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		free( opts[i].format );
+		free( opts[i].help );
+		free( opts[i].types );
+		free( opts[i].field );
+	}
+	free( opts );
+}
+
+/* reads a double quoted C string with \" \\ \n \t escapes; -1 if it is
+	malformed, SG_ERROR_NO_MEMORY if it cannot be stored */
+static int read_cstring( char **pp, char **pOut )
+{
+	char *p = *pp, *w;
+
+	if( *p++ != '"' ) return(-1);
+
+	*pOut = w = (char *) malloc( strlen( p ) + 1 );
+	if( w == NULL ) return( SG_ERROR_NO_MEMORY );
+	for( ; *p != '"' ; p++ )
+	{
+		if( *p == '\0' || *p == '\n' ) return(-1);
+		if( *p == '\\' )
+		{
+			p++;
+			if( *p == 'n' ) *w++ = '\n';
+			else if( *p == 't' ) *w++ = '\t';
+			else if( *p == '"' || *p == '\\' ) *w++ = *p;
+			else return(-1);
+		}
+		else *w++ = *p;
+	}
+	*w = '\0';
+	*pp = p + 1;
+
+	return(0);
+}
+
+/* "-puffy" -> puffy, "--dry-run" -> dry_run, "-if" -> if_, "@" -> response_files */
+static char *make_field( const char *name, int namelen )
+{
+	char *field = (char *) malloc( namelen + 16 );
+	char *w = field;
+	int i;
+
+	if( field == NULL ) return( NULL );
+	if( namelen == 1 && name[0] == '@' )
+	{
+		strcpy( field, "response_files" );
+		return( field );
+	}
+
+	while( namelen > 0 && (*name == '-' || *name == '+' || *name == '/') )
+	{
+		name++;
+		namelen--;
+	}
+	if( namelen == 0 || isdigit( (unsigned char) *name ) )
+	{
+		strcpy( w, "opt_" );
+		w += 4;
+	}
+	for( i = 0 ; i < namelen ; i++ ) *w++ = isalnum( (unsigned char) name[i] ) ? name[i] : '_';
+	*w = '\0';
+
+	for( i = 0 ; i < (int) (sizeof(keywords) / sizeof(keywords[0])) ; i++ )
+	{
+		if( strcmp( field, keywords[i] ) == 0 ) strcat( field, "_" );
+	}
+
+	return( field );
+}
+
+/* every generated member name must be unique; names[2*i+1] is option
+	i's count field, if it has one */
+static int check_names( struct genopt_s *opts, int numOpts )
+{
+	char **names = (char **) calloc( (size_t) numOpts * 2 + 1, sizeof(char *) );
+	int i, j, n = 0;
+
+	if( names == NULL )
+	{
+		fprintf(stderr, "superSpecGen: out of memory\n");
+		return(-1);
+	}
+
+	for( i = 0 ; i < numOpts && n == 0 ; i++ )
+	{
+		names[2*i] = opts[i].field;
+		if( opts[i].varflag || opts[i].managed )
+		{
+			names[2*i+1] = (char *) malloc( strlen( opts[i].field ) + 5 );
+			if( names[2*i+1] == NULL )
+			{
+				fprintf(stderr, "superSpecGen: out of memory\n");
+				n = -1;
+			}
+			else sprintf( names[2*i+1], "num_%s", opts[i].field );
+		}
+	}
+	for( i = 0 ; i < 2*numOpts && n == 0 ; i++ )
+	{
+		for( j = 0 ; j < i && names[i] != NULL ; j++ )
+		{
+			if( names[j] != NULL && strcmp( names[i], names[j] ) == 0 )
+			{
+				fprintf(stderr, "superSpecGen: two options map to the field name %s\n", names[i]);
+				n = -1;
+				break;
+			}
+		}
+	}
+
+	for( i = 0 ; i < numOpts ; i++ ) free( names[2*i+1] );
+	free( names );
+
+	return( n );
+}
+
+/* compiles the spec with stand-in pointers; only its hash tables are used */
+static int build_spec( struct genopt_s *opts, int numOpts, SG_SPEC **pSpec )
+{
+	static char dummy[8];
+	static void *dummyPtrs[MAXLINE];
+	SG_OPTION *table = (SG_OPTION *) calloc( numOpts > 0 ? numOpts : 1, sizeof(SG_OPTION) );
+	int i, n, lastArg;
+
+	if( table == NULL )
+	{
+		fprintf(stderr, "superSpecGen: out of memory\n");
+		return(-1);
+	}
+	for( i = 0 ; i < MAXLINE ; i++ ) dummyPtrs[i] = dummy;
+
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		table[i].name = opts[i].format;
+		table[i].namelen = opts[i].namelen;
+		table[i].numargs = opts[i].numargs;
+		table[i].flags = (opts[i].varflag ? SG_OPTION_VAR : 0) | (opts[i].managed ? SG_OPTION_MANAGED : 0);
+		table[i].types = opts[i].types;
+		table[i].ptrs = dummyPtrs;
+		table[i].pNumArgs = (int *) dummy;
+		table[i].help = opts[i].help;
+	}
+
+	n = superCompileTable( pSpec, table, numOpts, &lastArg );
+	free( table );
+	if( n < 0 )
+	{
+		fprintf(stderr, "superSpecGen: option %d: error %d\n", lastArg, n);
+		return(-1);
+	}
+
+	return(0);
+}
+
+/* the trie's nodes are 0..last_child(); children always follow parents */
+static int last_child( const SG_SPEC *spec )
+{
+	int k, last = 0;
+
+	for( k = 0 ; k <= last ; k++ )
+	{
+		if( spec->trie[k].numChildren > 0 && spec->trie[k].firstChild + spec->trie[k].numChildren - 1 > last ) last = spec->trie[k].firstChild + spec->trie[k].numChildren - 1;
+	}
+
+	return( last );
+}
+
+static void put_cstring( FILE *fp, const char *s, int len )
+{
+	int i;
+
+	if( s == NULL )
+	{
+		fprintf( fp, "NULL" );
+		return;
+	}
+
+	fputc( '"', fp );
+	for( i = 0 ; i < len ; i++ )
+	{
+		unsigned char c = (unsigned char) s[i];
+
+		if( c == '"' || c == '\\' ) fprintf( fp, "\\%c", c );
+		else if( c == '\n' ) fprintf( fp, "\\n" );
+		else if( c == '\t' ) fprintf( fp, "\\t" );
+		else if( c < 0x20 || c >= 0x7f ) fprintf( fp, "\\%03o", c );
+		else fputc( c, fp );
+	}
+	fputc( '"', fp );
+}
+
+static int write_header( const char *path, const char *prefix, const char *specPath, struct genopt_s *opts, int numOpts )
+{
+	FILE *fp;
+	int i, k;
+
+	fp = fopen( path, "w" );
+	if( fp == NULL )
+	{
+		fprintf(stderr, "superSpecGen: cannot write %s\n", path);
+		return(-1);
+	}
+
+	fprintf( fp, "/* Generated by superSpecGen from %s. Do not edit. */\n\n", specPath );
+	fprintf( fp, "#ifndef __%s_SPEC\n#define __%s_SPEC\n\n#include \"supergetopt.h\"\n\n", prefix, prefix );
+	fprintf( fp, "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n" );
+
+	fprintf( fp, "typedef struct %s_results_s\n{\n", prefix );
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		const struct genopt_s *o = &opts[i];
+
+		if( o->numargs == 0 ) fprintf( fp, "\tint %s;", o->field );
+		else if( o->managed ) fprintf( fp, "\t%s*%s;\n\tint num_%s;", cTypes[o->types[0]], o->field, o->field );
+		else if( o->varflag ) fprintf( fp, "\t%s%s[%d];\n\tint num_%s;", cTypes[o->types[0]], o->field, o->capacity, o->field );
+		else if( o->numargs == 1 ) fprintf( fp, "\t%s%s;", cTypes[o->types[0]], o->field );
+		else
+		{
+			for( k = 0 ; k < o->numargs ; k++ ) fprintf( fp, "%s\t%s%s_%d;", k ? "\n" : "", cTypes[o->types[k]], o->field, k );
+		}
+		fprintf( fp, "\t// " );
+		put_cstring( fp, o->format, (int) strlen( o->format ) );
+		fprintf( fp, "\n" );
+	}
+	fprintf( fp, "} %s_results;\n\n", prefix );
+
+	fprintf( fp, "// option indices, as returned by %s_lookup()\nenum\n{\n", prefix );
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		fprintf( fp, "\t%s_OPT_", prefix );
+		for( k = 0 ; opts[i].field[k] != '\0' ; k++ ) fputc( toupper( (unsigned char) opts[i].field[k] ), fp );
+		fprintf( fp, " = %d,\n", i );
+	}
+	fprintf( fp, "\t%s_NUM_OPTS = %d\n};\n\n", prefix, numOpts );
+
+	fprintf( fp, "extern const SG_SPEC *const %s_spec;\n\n", prefix );
+	fprintf( fp, "// like superGetOpt()/superParseOpt(); argc 0 and argv NULL print usage\n" );
+	fprintf( fp, "int %s_getopt( %s_results *results, int argc, char **argv, int *lastArg );\n", prefix, prefix );
+	fprintf( fp, "int %s_parse( %s_results *results, int argc, char **argv, int *lastArg );\n", prefix, prefix );
+	fprintf( fp, "int %s_lookup( const char *name );\n\n", prefix );
+	fprintf( fp, "#ifdef __cplusplus\n}\n#endif\n\n#endif\n" );
+
+	fclose( fp );
+
+	return(0);
+}
+
+static int write_source( const char *path, const char *header, const char *prefix, const char *specPath, struct genopt_s *opts, int numOpts, const SG_SPEC *spec )
+{
+	FILE *fp;
+	int i, k, slot, last;
+	unsigned int b;
+
+	fp = fopen( path, "w" );
+	if( fp == NULL )
+	{
+		fprintf(stderr, "superSpecGen: cannot write %s\n", path);
+		return(-1);
+	}
+
+	fprintf( fp, "/* Generated by superSpecGen from %s. Do not edit. */\n\n", specPath );
+	fprintf( fp, "#include <stddef.h>\n#include \"%s\"\n#include \"superGetOptTables.h\"\n\n", header );
+	fprintf( fp, "#define OUT( field ) ((char *) offsetof( %s_results, field ))\n\n", prefix );
+
+	fprintf( fp, "static const int argtypes[] =\n{\n" );
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		fprintf( fp, "\t" );
+		if( opts[i].numargs == 0 ) fprintf( fp, "SG_TYPE_INT," );
+		for( k = 0 ; k < opts[i].numargs ; k++ ) fprintf( fp, "%s%s,", k ? " " : "", typeIds[opts[i].types[k]] );
+		fprintf( fp, "\n" );
+	}
+	fprintf( fp, "};\n\n" );
+
+	fprintf( fp, "static const PANYTYPE argptrs[] =\n{\n" );
+	for( i = 0 ; i < numOpts ; i++ )
+	{
+		const struct genopt_s *o = &opts[i];
+
+		fprintf( fp, "\t" );
+		if( o->numargs <= 1 || o->varflag || o->managed ) fprintf( fp, "{ OUT( %s ) },", o->field );
+		else
+		{
+			for( k = 0 ; k < o->numargs ; k++ ) fprintf( fp, "%s{ OUT( %s_%d ) },", k ? " " : "", o->field, k );
+		}
+		fprintf( fp, "\n" );
+	}
+	fprintf( fp, "};\n\n" );
+
+	fprintf( fp, "static const struct optionlist_s optionlist[] =\n{\n" );
+	for( i = 0, slot = 0 ; i < numOpts ; i++ )
+	{
+		const struct genopt_s *o = &opts[i];
+
+		fprintf( fp, "\t{ .name = " );
+		put_cstring( fp, o->format, o->namelen );
+		fprintf( fp, ", .namelen = %d, .numargs = %d, .varflag = %d, .managed = %d,\n", o->namelen, o->numargs, o->varflag, o->managed );
+		fprintf( fp, "\t  .argtype = (int *) &argtypes[%d], .argptr = (PANYTYPE *) &argptrs[%d],\n", slot, slot );
+		if( o->varflag || o->managed ) fprintf( fp, "\t  .pNumArgs = (int *) OUT( num_%s ), .numArgsMax = %d,\n", o->field, o->managed ? 0 : o->capacity );
+		fprintf( fp, "\t  .helpString = " );
+		put_cstring( fp, o->help, o->help != NULL ? (int) strlen( o->help ) : 0 );
+		fprintf( fp, " },\n" );
+		slot += o->numargs > 0 ? o->numargs : 1;
+	}
+	fprintf( fp, "};\n\n" );
+
+	fprintf( fp, "static const unsigned int disp[] =\n{" );
+	for( b = 0 ; b <= spec->bucketMask ; b++ ) fprintf( fp, "%s%u,", b % 16 ? " " : "\n\t", spec->disp[b] );
+	fprintf( fp, "\n};\n\n" );
+
+	fprintf( fp, "static const struct sg_hashslot_s slots[] =\n{" );
+	for( b = 0 ; b <= spec->slotMask ; b++ ) fprintf( fp, "%s{ %d, %d },", b % 8 ? " " : "\n\t", spec->slots[b].option, spec->slots[b].namelen );
+	fprintf( fp, "\n};\n\n" );
+
+	// byName is only filled when the library builds tries
+	if( spec->trie != NULL )
+	{
+		fprintf( fp, "static const int byName[] =\n{" );
+		for( b = 0 ; b < (unsigned int) spec->optnum ; b++ ) fprintf( fp, "%s%d,", b % 16 ? " " : "\n\t", spec->byName[b] );
+		fprintf( fp, "\n};\n\n" );
+
+		fprintf( fp, "static const struct sg_trienode_s trie[] =\n{\n" );
+		last = last_child( spec );
+		for( k = 0 ; k <= last ; k++ )
+		{
+			const struct sg_trienode_s *t = &spec->trie[k];
+
+			fprintf( fp, "\t{ %d, %d, %d, %d, %d },\n", t->c, t->numChildren, t->firstChild, t->lo, t->hi );
+		}
+		fprintf( fp, "};\n\n" );
+	}
+
+	fprintf( fp, "static const struct sg_spec_s spec =\n{\n" );
+	fprintf( fp, "\t.optnum = %d,\n\t.numManaged = %d,\n\t.responseOpt = %d,\n", spec->optnum, spec->numManaged, spec->responseOpt );
+	fprintf( fp, "\t.optionlist = (struct optionlist_s *) optionlist,\n" );
+	fprintf( fp, "\t.argptrs = (PANYTYPE *) argptrs,\n" );
+	fprintf( fp, "\t.argtypes = (int *) argtypes,\n" );
+	fprintf( fp, "\t.maxNameLen = %d,\n\t.firstBytes = {", spec->maxNameLen );
+	for( k = 0 ; k < (int) sizeof(spec->firstBytes) ; k++ ) fprintf( fp, "%s0x%02x", k ? ", " : " ", spec->firstBytes[k] );
+	fprintf( fp, " },\n" );
+	fprintf( fp, "\t.bucketMask = %u,\n\t.slotMask = %u,\n", spec->bucketMask, spec->slotMask );
+	fprintf( fp, "\t.disp = (unsigned int *) disp,\n\t.slots = (struct sg_hashslot_s *) slots,\n" );
+	if( spec->trie != NULL ) fprintf( fp, "\t.byName = (int *) byName,\n\t.trie = (struct sg_trienode_s *) trie,\n" );
+	else fprintf( fp, "\t.byName = NULL,\n\t.trie = NULL,\n" );
+	if( spec->prefixes ) fprintf( fp, "\t.prefixes = 1,\n" );
+	for( k = SG_USAGE_TEXT ; k <= SG_USAGE_JSON ; k++ )
+	{
+		const char *text;
+		const char *line;
+		size_t len;
+
+		// rendered now, so the const spec never needs its cache filled
+		text = superUsageText( spec, k, &len );
+		if( text == NULL )
+		{
+			fprintf(stderr, "superSpecGen: out of memory\n");
+			fclose( fp );
+			remove( path );
+			return(-1);
+		}
+
+		fprintf( fp, "\t.usage[%s] =", k == SG_USAGE_TEXT ? "SG_USAGE_TEXT" : "SG_USAGE_JSON" );
+		for( line = text ; line < text + len ; )
+		{
+			const char *eol = strchr( line, '\n' );
+			int n = eol != NULL ? (int) (eol - line) + 1 : (int) strlen( line );
+
+			fprintf( fp, "\n\t\t" );
+			put_cstring( fp, line, n );
+			line += n;
+		}
+		if( len == 0 ) fprintf( fp, " \"\"" );
+		fprintf( fp, ",\n\t.usageLen[%s] = %lu,\n", k == SG_USAGE_TEXT ? "SG_USAGE_TEXT" : "SG_USAGE_JSON", (unsigned long) len );
+	}
+	fprintf( fp, "\t.resultsSize = sizeof( %s_results ),\n};\n\n", prefix );
+
+	fprintf( fp, "const SG_SPEC *const %s_spec = &spec;\n\n", prefix );
+
+	fprintf( fp, "int %s_getopt( %s_results *results, int argc, char **argv, int *lastArg )\n{\n", prefix, prefix );
+	fprintf( fp, "\tSG_CTX ctx;\n\n\tsuperInitCtx( &ctx, &spec, NULL, results, sizeof(*results) );\n" );
+	fprintf( fp, "\treturn( superGetOptCtx( &ctx, argc, argv, lastArg ) );\n}\n\n" );
+	fprintf( fp, "int %s_parse( %s_results *results, int argc, char **argv, int *lastArg )\n{\n", prefix, prefix );
+	fprintf( fp, "\tSG_CTX ctx;\n\n\tsuperInitCtx( &ctx, &spec, NULL, results, sizeof(*results) );\n" );
+	fprintf( fp, "\treturn( superParseOptCtx( &ctx, argc, argv, lastArg ) );\n}\n\n" );
+	fprintf( fp, "int %s_lookup( const char *name )\n{\n\treturn( superLookupOpt( &spec, name ) );\n}\n", prefix );
+
+	fclose( fp );
+
+	return(0);
+}
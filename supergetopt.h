@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __SUPERGETOPT
 
 #include <stdarg.h>
+#include <stddef.h>
 
 /* The function prototypes you need */
 
@@ -41,6 +42,413 @@ int superGetOpt( int argc, char **argv, int *lastArg, ... );
 // for parsing args in a file, for instance, where argv[0] isn't ignored
 int superParseOpt( int argc, char **argv, int *lastArg, ... );
 
+/* Compiled option specs. superCompileOpt() takes the same
+	format/pointer/help triplets as superGetOpt() (NULL terminated) and
+	parses the formats once. The spec is immutable afterwards and can be
+	handed to superGetOptSpec()/superParseOptSpec() any number of times,
+	which only match and convert arguments.
+	The capacity of each var-arg array is taken from *numInArray when the
+	spec is compiled; each parse resets *numInArray to the count found. */
+typedef struct sg_spec_s SG_SPEC;
+
+int superCompileOpt( SG_SPEC **pSpec, int *lastArg, ... );
+int superCompileOptV( SG_SPEC **pSpec, int *lastArg, va_list ap );
+int superGetOptSpec( const SG_SPEC *spec, int argc, char **argv, int *lastArg );
+int superParseOptSpec( const SG_SPEC *spec, int argc, char **argv, int *lastArg );
+void superFreeOpt( SG_SPEC *spec );
+
+/* Specs from tables that are already parsed, for front ends that know the
+	formats at compile time (see supergetopt.hpp). Each entry holds what a
+	format string would: the name (not necessarily NUL terminated), the
+	SG_TYPE_* of each argument, and the pointers that would follow it. A
+	flag has numargs 0 and its int * in ptrs[0]; var-arg and "+" lists
+	have numargs 1, an SG_OPTION_* flag and a count in pNumArgs. */
+#define SG_TYPE_CHAR 0		// %c
+#define SG_TYPE_SHORT 1		// %hd
+#define SG_TYPE_INT 2		// %d
+#define SG_TYPE_FLOAT 3		// %f
+#define SG_TYPE_DOUBLE 4	// %lf
+#define SG_TYPE_STRING 5	// %s
+#define SG_TYPE_LLONG 6		// %lld
+#define SG_TYPE_ULLONG 7	// %llu
+#define SG_TYPE_UINT 8		// %u
+#define SG_TYPE_SIZE 9		// %zu, a size_t
+#define SG_TYPE_HEX 10		// %x, an unsigned int
+#define SG_TYPE_BYTES 11	// %B, an unsigned long long
+#define SG_TYPE_DURATION 12	// %T, a long long
+#define SG_NUM_TYPES 13
+
+/* %u, %llu and %zu also take hex after 0x; %x is always hex, the 0x
+	optional. %B is a byte count with an optional K, M, G, T, P or E
+	(powers of 1024, either case) and B or iB after it: "512M", "4GiB",
+	"1.5k". %T is a duration in nanoseconds: number and unit pairs with
+	units ns, us, ms, s, m, h and d ("250ms", "1h30m"), or a number of
+	seconds alone. */
+
+#define SG_OPTION_VAR 1		// *%X
+#define SG_OPTION_MANAGED 2	// +%X, or +*%X with SG_OPTION_VAR
+#define SG_OPTION_STREAM 4	// >*%X, with SG_OPTION_VAR
+
+/* Streamed lists. A '>' before a var-arg format, as in "-vanna >*%f",
+	hands the values to a callback instead of an array: the option takes an
+	SG_STREAM_FN and a void * that is passed back to it. The callback gets
+	the converted values in order, up to SG_STREAM_CHUNK of them per call
+	(a T array, T as for the format), as the tokens are read, so a list of
+	any length needs no more memory than one chunk. A non-zero return
+	stops the parse with SG_ERROR_CALLBACK. Nothing is reset between
+	parses; the callback sees every occurrence of the option. */
+#define SG_STREAM_CHUNK 4096
+
+typedef int (*SG_STREAM_FN)( void *data, const void *values, int count );
+
+typedef struct sg_option_s
+{
+	const char *name;
+	int namelen;
+	int numargs;
+	int flags;
+	const int *types;
+	void * const *ptrs;	// SG_OPTION_STREAM: ptrs[0] is the callback's data
+	int *pNumArgs;
+	const char *help;
+	SG_STREAM_FN stream;
+} SG_OPTION;
+
+int superCompileTable( SG_SPEC **pSpec, const SG_OPTION *options, int numOptions, int *lastArg );
+
+// index of the option called name in spec (superCompileTable order), or -1
+int superLookupOpt( const SG_SPEC *spec, const char *name );
+
+/* Usage text. superUsageText() renders a spec's options once, as the
+	text that superGetOpt( 0, NULL, &err, NULL ) prints or as one line of
+	JSON ({"options":[{"name":"-puffy","types":["char","double"],"var":false,
+	"repeatable":false,"streamed":false,"help":"..."},...]}), and returns
+	the cached, NUL terminated buffer; NULL if out of memory. The buffer
+	lives as long as the spec. superWriteUsage() sends it to a file
+	descriptor with a single write(), after flushing stdout or stderr if fd
+	is 1 or 2. The usage calls print the text form on fd 1. */
+#define SG_USAGE_TEXT 0
+#define SG_USAGE_JSON 1
+
+const char *superUsageText( const SG_SPEC *spec, int format, size_t *pLen );
+int superWriteUsage( const SG_SPEC *spec, int format, int fd );
+
+/* Abbreviations. Option names match exactly unless superPrefixOpt() is
+	called with enable set, before the spec's first parse. Then a token
+	that is not an option name but starts exactly one of them (past any
+	leading dashes) is taken as that option, so "--verb" gives "--verbose".
+	A token that starts several names is an error,
+	SG_ERROR_AMBIGUOUS_OPTION. superPrefixMatches() stores up to max of the
+	names starting with prefix, in byte order, and returns how many there
+	are. Building the library with SG_ENABLE_PREFIX=0 leaves abbreviations
+	off for every spec. */
+void superPrefixOpt( SG_SPEC *spec, int enable );
+int superPrefixMatches( const SG_SPEC *spec, const char *prefix, const char **names, int max );
+
+/* Library-managed arrays. A '+' before the format, as in "-I +%s" or
+	"-in +*%d", makes the library own the array: the option takes a T **
+	and an int * instead of a T * array (or a single T *), and every
+	occurrence of the option appends its values, so "-I a -I b" gives two.
+	The arrays grow in an SG_ARENA and live until it is reset or freed.
+	A context without an arena (and every call that takes no context) uses
+	a per-thread arena that is reset at the start of each parse, so those
+	results last until the next parse on the same thread. */
+typedef struct sg_arena_s SG_ARENA;
+
+int superNewArena( SG_ARENA **pArena );
+void superResetArena( SG_ARENA *arena );
+void superFreeArena( SG_ARENA *arena );
+
+/* Response files. When a spec has a flag named "@", any token of the
+	form @path is replaced by the tokens in that file, which is mapped and
+	tokenized in place like a config file except that newlines are just
+	blanks. Response files may name further response files, up to
+	SG_MAX_RESPONSE_DEPTH deep; relative paths are taken from the current
+	directory. Tokens are pulled from the mapping as the parser needs them,
+	so no argv copy is built, and %s results (including *%s lists) point
+	into the mapping. The mappings belong to the parse's arena (see "+"
+	formats above) and stay valid until it is reset or freed. The "@" flag
+	is set when a response file was read. A file that cannot be opened
+	gives SG_ERROR_FILE, one nested too deep SG_ERROR_RESPONSE_DEPTH. */
+#define SG_MAX_RESPONSE_DEPTH 8
+
+/* Environment fallback. superEnvOpt() maps the options of a compiled spec
+	to environment variables: option i (in spec order) reads names[i] when
+	names and names[i] are not NULL, otherwise prefix followed by its name
+	with the leading dashes dropped, letters upper-cased and anything else
+	that is not a digit turned into '_' (prefix "APP_" maps "-max-conns" to
+	APP_MAX_CONNS); a NULL prefix maps only the named options. Call it once,
+	before the spec is first parsed. After each command line, every mapped
+	option that did not appear on it is filled from its variable when that
+	is set and not empty: the value is split at blanks into the option's
+	arguments and converted like command-line arguments, except that a lone
+	%s argument takes the whole value and a word is never taken as an
+	option name or an @file; a flag is set unless the value is "0". A bad
+	value fails the parse like a bad argument would, and a value with
+	words left over gives SG_ERROR_TOO_MANY_ARGS. The environment is
+	indexed in one pass the first time any spec needs it, so changes made
+	after that are not seen, and each parse costs one hash probe per unset
+	option. Values are copied into the parse's arena (see "+" formats).
+	Returns 0, SG_ERROR_ZERO_LEN_OPTION for an empty name or
+	SG_ERROR_NO_MEMORY. */
+int superEnvOpt( SG_SPEC *spec, const char *prefix, const char * const *names );
+
+/* Parser statistics, kept per context. Counters are maintained when the
+	library is built with SG_ENABLE_STATS >= 1 (the default); bytes and
+	nanosecond timings need SG_ENABLE_STATS=2, and SG_ENABLE_STATS=0
+	compiles all of it out. conversions[] is indexed by SG_TYPE_*.
+	matchNs is parse time not spent in conversion. */
+#define SG_STATS_MAXTYPES 16
+
+typedef struct sg_stats_s
+{
+	unsigned long long parses;
+	unsigned long long formatsCompiled;
+	unsigned long long tokensScanned;
+	unsigned long long bytesScanned;
+	unsigned long long lookups;		// tokens checked against the option table
+	unsigned long long lookupProbes;	// of those, the ones that reached a hash slot
+	unsigned long long conversions[SG_STATS_MAXTYPES];
+	unsigned long long conversionFailures;
+	unsigned long long setupNs;
+	unsigned long long matchNs;
+	unsigned long long convertNs;
+} SG_STATS;
+
+/* Parsing contexts. All parser state lives in a caller-owned SG_CTX, so
+	any number of threads can parse with one spec at the same time. Output
+	pointers given to superCompileOpt() that fall inside [origin,
+	origin+size) are written at the same offset from base instead, so each
+	thread (or record) can fill its own copy of a results struct. Pass
+	NULL origin/base to write through the compiled pointers unchanged.
+	A numeric var-arg list that reaches parallelMin values converts the
+	rest of its run on parallelThreads threads, each value going straight
+	to its slot; errors are reported for the first bad token as usual, and
+	the count stops there. Unlike the single-threaded path, slots past the
+	bad token (within the array) may still be overwritten by values that
+	another thread converted before the bad token was found.
+	superInitCtx() sets parallelMin to SG_PARALLEL_MIN, 0 turns it off.
+	A lazy context converts numeric arguments only when they are read,
+	see superLazyGet(). A spec generated by superSpecGen writes into the
+	results struct at base, so superInitCtx() returns SG_ERROR_BAD_FORMAT
+	for one given a NULL base, and parsing with it fails the same way. */
+#define SG_PARALLEL_MIN 65536
+
+typedef struct sg_ctx_s
+{
+	const SG_SPEC *spec;
+	char *origin;
+	char *base;
+	size_t size;
+	SG_ARENA *arena;	// for "+" formats, NULL for the per-thread one
+	int parallelMin;	// var-list length that goes to threads, 0: never
+	int parallelThreads;	// 0: one per online CPU; 1 never goes to threads
+	int lazy;		// 1: record numeric arguments, convert them on first read
+
+	// parser state, private
+	SG_ARENA *outArena;
+	char *cur;
+	char **argv;
+	int argsleft;
+	char *(*nextToken)( void *state );
+	void *tokenState;
+	int lastArgProcessedSuccessfully;
+	int unAccountedFor;
+	int tokenError;
+	int responseDepth;
+	struct sg_file_s *response[SG_MAX_RESPONSE_DEPTH];
+	unsigned char *seen;	// bitmap of options given (environment fallback, watches)
+	int *given;		// if not NULL, the options as seen first sets their bits
+	int numGiven;
+	struct sg_lazy_s *lazySpans;	// where a lazy parse found each option's arguments
+	SG_STATS stats;
+} SG_CTX;
+
+int superInitCtx( SG_CTX *ctx, const SG_SPEC *spec, void *origin, void *base, size_t size );
+int superGetOptCtx( SG_CTX *ctx, int argc, char **argv, int *lastArg );
+int superParseOptCtx( SG_CTX *ctx, int argc, char **argv, int *lastArg );
+
+/* Lazy conversion. A parse through a context with lazy set still matches
+	every option, counts var-arg values and stores flags and %s arguments,
+	but only records which tokens hold the numeric arguments of options
+	that are neither "+" nor ">". superLazyGet() converts such a value the
+	first time it is read, stores it in its output and copies it out from
+	there afterwards, so a run pays only for the values it uses; until
+	then the output keeps its old contents. A bad number shows up at its
+	first read as SG_ERROR_INCORRECT_ARG, and superLazyValidate() converts
+	everything still pending, in argument order, failing the way the
+	parse itself would have, *lastArg included. The records live in
+	ctx->arena (with NULL, in the per-thread one until its next parse) and
+	point at the tokens, so argv, or the SG_FILE of superParseFileCtx(),
+	must outlive the reads. Validate before superWriteSnapshot().
+	superLazyGet() also reads eager contexts. type is the SG_TYPE_* of
+	argument arg, a flag being one SG_TYPE_INT; any other type or arg
+	gives SG_ERROR_BAD_ARGTYPE, and a var-arg index at or past the count
+	SG_ERROR_MISSING_ARG. Returns 0 with the value in *value. */
+int superLazyGet( SG_CTX *ctx, int option, int arg, int type, void *value );
+int superLazyValidate( SG_CTX *ctx, int *lastArg );
+
+/* Copies a context's statistics, with formatsCompiled and setupNs taken
+	from its spec. A NULL ctx gives this thread's totals for everything
+	parsed without a caller's context, plus every spec it compiled.
+	Returns the library's SG_ENABLE_STATS level; 0 means no statistics. */
+int superGetStats( const SG_CTX *ctx, SG_STATS *stats );
+void superResetStats( SG_CTX *ctx );
+
+/* Config files. The file is mapped read/write private and tokenized in
+	place: blanks separate tokens, "..." and '...' quote, backslash escapes,
+	a token starting with # comments out the rest of the line, and a
+	backslash at the end of a line continues it. Each line is parsed like
+	its own superParseOpt() argument list into one set of outputs, so a
+	later line overrides an earlier one. %s results point into the mapping
+	and stay valid until superCloseFile(). A file can be parsed once.
+	Returns like superParseOpt(); after an error superFileLine() gives the
+	line of the offending token and *lastArg its position on that line. */
+typedef struct sg_file_s SG_FILE;
+
+int superOpenFile( SG_FILE **pFile, const char *path );
+int superParseFile( const SG_SPEC *spec, SG_FILE *file, int *lastArg );
+int superParseFileCtx( SG_CTX *ctx, SG_FILE *file, int *lastArg );
+int superFileLine( const SG_FILE *file );
+void superCloseFile( SG_FILE *file );
+
+/* Watched config files. superWatchFile() ties a config file to a copy of
+	ctx, resets the outputs and watches the file with inotify (on other
+	systems, by its modification time and size); superReloadFile() then
+	parses the file, the first time in full. A reload re-tokenizes the file
+	and hashes each line's tokens, keeps the lines whose hash it already
+	had, and parses only the changed lines, plus the earlier line that sets
+	an option again when the line that set it last went away. Each line
+	still counts as its own argument list with later lines overriding
+	earlier ones, and an option no line sets goes back to its value from
+	before the watch. So a one-line edit of a huge file costs a pass of
+	tokenizing and hashing and about one line of parsing. %s results may
+	point into the mapping of an earlier version of the file, which is kept
+	until no option needs it (at most SG_WATCH_MAPS old versions). A reload
+	that fails leaves every output as it was. Specs with "+", ">" or "@"
+	options accumulate values across lines and give
+	SG_ERROR_NOT_RELOADABLE.
+
+	superWatchPoll() waits up to timeoutMs for the file to be written or
+	replaced and returns 1 when it was, 0 when not (possibly early), or
+	SG_ERROR_FILE; without inotify it checks once and returns at once.
+	superWatchFd() is the inotify descriptor to wait on instead, -1 when
+	there is none. superReloadFile() returns like superParseFile(), with
+	superWatchLine() giving the offending line after an error, and
+	superWatchChanges() points *options at the ascending indices (in spec
+	order) of the options whose values the last reload changed and returns
+	their count. */
+#define SG_WATCH_MAPS 4
+
+typedef struct sg_watch_s SG_WATCH;
+
+int superWatchFile( SG_WATCH **pWatch, const SG_CTX *ctx, const char *path );
+int superReloadFile( SG_WATCH *watch, int *lastArg );
+int superWatchPoll( SG_WATCH *watch, int timeoutMs );
+int superWatchFd( const SG_WATCH *watch );
+int superWatchChanges( const SG_WATCH *watch, const int **options );
+int superWatchLine( const SG_WATCH *watch );
+void superFreeWatch( SG_WATCH *watch );
+
+/* Snapshots. superWriteSnapshot() serializes the values a parse through
+	ctx left in its outputs, every option in spec order: flags, typed
+	arguments, var-arg and "+" arrays, and strings, each distinct string
+	stored once. A snapshot holds offsets, not pointers, so it reads the
+	same wherever it is mapped. superSnapshotFd() writes one into a sealed
+	memfd (an unlinked temporary file where there is no memfd) whose
+	descriptor forked workers inherit, and superMapSnapshot() maps one
+	read-only after checking that it is one and complete, so every process
+	shares the same clean pages instead of parsing the config again.
+	Values are read in place: superSnapCount() is an option's number of
+	values (one int for a flag, none for ">" options), and superSnapValue()
+	points at value arg and sets *pType to its SG_TYPE_*. Numeric var-arg
+	and "+" values are consecutive, so value 0 is the whole array; a %s
+	value is the string itself, NULL if the output was. superSnapLookup()
+	finds an option by its exact name, -1 if none. Snapshots only read
+	back on the kind of machine that wrote them; anything else gives
+	SG_ERROR_BAD_SNAPSHOT. superUnmapSnapshot() takes only what
+	superMapSnapshot() returned. */
+typedef struct sg_snapshot_s SG_SNAPSHOT;
+
+int superWriteSnapshot( const SG_CTX *ctx, int fd );
+int superSnapshotFd( const SG_CTX *ctx, int *pFd );
+int superMapSnapshot( const SG_SNAPSHOT **pSnap, int fd );
+void superUnmapSnapshot( const SG_SNAPSHOT *snap );
+int superSnapLookup( const SG_SNAPSHOT *snap, const char *name );
+int superSnapCount( const SG_SNAPSHOT *snap, int option );
+const void *superSnapValue( const SG_SNAPSHOT *snap, int option, int arg, int *pType );
+
+/* Command interpreters, for control channels that take one command per
+	line. superCompileCommands() builds a set of num commands in which the
+	word names[i] selects specs[i]; the names are copied, the specs stay
+	the caller's and must outlive the set, which threads can share. It
+	gives SG_ERROR_ZERO_LEN_OPTION for an empty name and SG_ERROR_BAD_FORMAT
+	for a name given twice. superParseCommand() tokenizes line in place
+	like one line of a config file (blanks, quotes, backslashes and #
+	comments; a newline ends the command), looks its first word up and
+	parses the rest with that command's spec through ctx, whose spec it
+	sets, so origin, base, arena and lazy still apply. No format strings
+	are parsed and nothing is allocated unless the spec needs an arena.
+	*pCommand gets the command's index, -1 for an unknown word (with
+	SG_ERROR_UNKNOWN_COMMAND) or an empty line (with 0); otherwise it
+	returns like superParseOpt(), %s results pointing into line.
+	superCommandLookup() is a name's index, -1 if none. */
+typedef struct sg_commands_s SG_COMMANDS;
+
+int superCompileCommands( SG_COMMANDS **pCmds, const char * const *names, SG_SPEC * const *specs, int num );
+int superParseCommand( const SG_COMMANDS *cmds, SG_CTX *ctx, char *line, int *pCommand, int *lastArg );
+int superCommandLookup( const SG_COMMANDS *cmds, const char *name );
+void superFreeCommands( SG_COMMANDS *cmds );
+
+/* Subcommands, git style: "tool commit -m msg". superNewSubcommands()
+	indexes the names of a table of subcommands, each with its own option
+	table as superCompileTable() takes it, and compiles none of them; the
+	table must outlive the set. superParseSubcommand() takes argv[1] as
+	the subcommand, compiles its options the first time it is chosen
+	(superSubcommandSpec() does the same, for usage text) and parses the
+	rest of argv through ctx, whose spec it sets, like superParseOptCtx().
+	So startup costs one subcommand's options however many the tool has,
+	and several threads can share a set. *pCommand gets the index in the
+	table, -1 if argv[1] is missing (SG_ERROR_PRINT_USAGE) or not a
+	subcommand (SG_ERROR_UNKNOWN_COMMAND); a table that does not compile
+	gives superCompileTable()'s error and *lastArg. Callers with options
+	of their own before the subcommand parse those first and pass the
+	rest of argv. superWriteSubcommands() lists names and help on fd. */
+typedef struct sg_subcommand_s
+{
+	const char *name;
+	const SG_OPTION *options;
+	int numOptions;
+	const char *help;
+} SG_SUBCOMMAND;
+
+typedef struct sg_subcommands_s SG_SUBCOMMANDS;
+
+int superNewSubcommands( SG_SUBCOMMANDS **pSet, const SG_SUBCOMMAND *subs, int num );
+int superParseSubcommand( const SG_SUBCOMMANDS *set, SG_CTX *ctx, int argc, char **argv, int *pCommand, int *lastArg );
+int superSubcommandSpec( const SG_SUBCOMMANDS *set, int command, const SG_SPEC **pSpec, int *lastArg );
+int superWriteSubcommands( const SG_SUBCOMMANDS *set, int fd );
+void superFreeSubcommands( SG_SUBCOMMANDS *set );
+
+/* Batch parsing. Each record is parsed like superParseOpt() with its own
+	context whose base is the record's out block (see SG_CTX), and gets its
+	own status and lastArg. Records are split across numThreads threads
+	(0: one per online CPU) that steal work from each other, so uneven
+	records still balance, and a record's var-arg lists are never split
+	across threads again. Returns the number of records with a negative
+	status. Specs with "+" formats, response files or environment fallback
+	are rejected with SG_ERROR_NO_ARENA. */
+typedef struct sg_record_s
+{
+	int argc;
+	char **argv;
+	void *out;
+	int status;
+	int lastArg;
+} SG_RECORD;
+
+int superParseBatch( const SG_SPEC *spec, SG_RECORD *records, int numRecords, void *origin, size_t size, int numThreads );
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,5 +468,15 @@ int superParseOpt( int argc, char **argv, int *lastArg, ... );
 #define SG_ERROR_MIXED_TYPES_IN_VAR -10
 #define SG_ERROR_ZERO_LEN_OPTION -11
 #define SG_ERROR_TOO_MANY_ARGS -12
+#define SG_ERROR_NO_MEMORY -13
+#define SG_ERROR_FILE -14 // cannot open or read the file, or it was already parsed
+#define SG_ERROR_UNTERMINATED_QUOTE -15
+#define SG_ERROR_NO_ARENA -16
+#define SG_ERROR_RESPONSE_DEPTH -17
+#define SG_ERROR_AMBIGUOUS_OPTION -18
+#define SG_ERROR_CALLBACK -19
+#define SG_ERROR_NOT_RELOADABLE -20
+#define SG_ERROR_BAD_SNAPSHOT -21
+#define SG_ERROR_UNKNOWN_COMMAND -22
 
 #endif
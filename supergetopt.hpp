@@ -0,0 +1,348 @@
+/*********************************************************************
+
+Copyright (c) 2007, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* C++ front end (C++20, header only). Formats are template arguments and
+	are parsed while compiling, the output pointers are checked against
+	them with static_assert, and the result is an SG_OPTION table for
+	superCompileTable(), so there is no va_list and no runtime format
+	parsing; matching and conversion are the C library's.
+
+		char c; double lf; char *s; int d, help;
+		float f[8]; int numf = 8;
+
+		sg::spec options(
+			sg::opt<"-puffy %c %lf %s %d">( &c, &lf, &s, &d, "help message 1" ),
+			sg::opt<"-vanna *%f">( f, &numf, "help message 2" ),
+			sg::opt<"-help">( &help, "help message 3" ) );
+
+		int lastArg, n = options.getopt( argc, argv, &lastArg );
+
+	Pointer types: %c char *, %hd short *, %d int *, %f float *,
+	%lf double *, %s char ** (or const char **), %lld long long *,
+	%llu unsigned long long *, %u unsigned int *, %zu size_t *,
+	%x unsigned int *, %B unsigned long long * (a byte count) and
+	%T long long * (nanoseconds); *%X takes a T * array and
+	an int * capacity/count, +%X and +*%X take T ** and int *, >*%X takes
+	an SG_STREAM_FN (or a lambda without captures) and the void * passed
+	back to it, and a flag without formats takes an int *. */
+
+#ifndef __SUPERGETOPT_HPP
+#define __SUPERGETOPT_HPP
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "supergetopt.h"
+
+namespace sg
+{
+
+// a string literal usable as a template argument
+template<std::size_t N>
+struct format
+{
+	char text[N] {};
+
+	constexpr format( const char (&s)[N] )
+	{
+		for( std::size_t i = 0 ; i < N ; i++ ) text[i] = s[i];
+	}
+};
+
+namespace detail
+{
+
+// the same rules as parse_string()/parse_format() in superGetOpt.c
+template<std::size_t N>
+struct parsed
+{
+	int error = 0;	// SG_ERROR_* or 0
+	int namelen = 0;
+	int numargs = 0;
+	int flags = 0;
+	int types[N] {};
+};
+
+constexpr bool starts_with( const char *s, const char *prefix )
+{
+	for( ; *prefix != '\0' ; s++, prefix++ )
+	{
+		if( *s != *prefix ) return( false );
+	}
+	return( true );
+}
+
+template<std::size_t N>
+constexpr parsed<N> parse( const format<N> &f )
+{
+	struct conversion { const char *text; int type; };
+	constexpr conversion conversions[] = {
+		{ "lld", SG_TYPE_LLONG }, { "llu", SG_TYPE_ULLONG },
+		{ "lf", SG_TYPE_DOUBLE }, { "hd", SG_TYPE_SHORT }, { "zu", SG_TYPE_SIZE }, { "f", SG_TYPE_FLOAT },
+		{ "c", SG_TYPE_CHAR }, { "d", SG_TYPE_INT }, { "u", SG_TYPE_UINT }, { "x", SG_TYPE_HEX },
+		{ "s", SG_TYPE_STRING }, { "B", SG_TYPE_BYTES }, { "T", SG_TYPE_DURATION }
+	};
+	parsed<N> p;
+	const char *s = f.text;
+	std::size_t len = 0, pN = N, pM = N, pEnd, i;
+
+	while( s[len] != '\0' ) len++;
+	p.namelen = (int) len;
+
+	if( len < 2 && s[0] != '@' )	// "@" alone turns on response files
+	{
+		p.error = SG_ERROR_ZERO_LEN_OPTION;
+		return( p );
+	}
+
+	for( i = 0 ; i < len ; i++ )
+	{
+		if( s[i] == '%' && pN == N ) pN = i;
+		if( s[i] == '*' && pM == N ) pM = i;
+	}
+	if( pN == N ) return( p );	// a flag
+	if( pM != N ) p.flags |= SG_OPTION_VAR;
+
+	pEnd = pM < pN ? pM : pN;
+	if( pEnd >= 2 && s[pEnd - 1] == '+' && (s[pEnd - 2] == ' ' || s[pEnd - 2] == '\t') )
+	{
+		p.flags |= SG_OPTION_MANAGED;
+		pEnd--;
+	}
+	else if( pEnd >= 2 && s[pEnd - 1] == '>' && (s[pEnd - 2] == ' ' || s[pEnd - 2] == '\t') )
+	{
+		p.flags |= SG_OPTION_STREAM;
+		pEnd--;
+	}
+	while( pEnd > 0 && (s[pEnd - 1] == ' ' || s[pEnd - 1] == '\t') ) pEnd--;
+	p.namelen = (int) pEnd;
+
+	if( pN >= len - 1 )
+	{
+		p.error = SG_ERROR_NO_FORMATS;
+		return( p );
+	}
+
+	for( i = pN ; i < len ; )
+	{
+		while( s[i] == '%' ) i++;
+		if( s[i] == '\0' ) break;
+
+		std::size_t k = 0;
+		while( k < sizeof(conversions) / sizeof(conversions[0]) && !starts_with( s + i, conversions[k].text ) ) k++;
+		if( k == sizeof(conversions) / sizeof(conversions[0]) )
+		{
+			p.error = SG_ERROR_BAD_FORMAT_TYPE;
+			return( p );
+		}
+		p.types[p.numargs++] = conversions[k].type;
+
+		while( i < len && s[i] != '%' ) i++;
+	}
+
+	if( p.numargs > 1 && (p.flags & SG_OPTION_VAR) ) p.error = SG_ERROR_MIXED_TYPES_IN_VAR;
+	else if( p.numargs > 1 && (p.flags & SG_OPTION_MANAGED) ) p.error = SG_ERROR_BAD_FORMAT;
+	else if( (p.flags & SG_OPTION_STREAM) && !(p.flags & SG_OPTION_VAR) ) p.error = SG_ERROR_BAD_FORMAT;
+
+	return( p );
+}
+
+template<format F>
+struct traits
+{
+	static constexpr auto p = parse( F );
+	static constexpr bool managed = (p.flags & SG_OPTION_MANAGED) != 0;
+	static constexpr bool var = (p.flags & SG_OPTION_VAR) != 0;
+	static constexpr bool stream = (p.flags & SG_OPTION_STREAM) != 0;
+	static constexpr bool counted = (managed || var) && !stream;
+	static constexpr std::size_t numPtrs = p.numargs > 0 ? p.numargs : 1;	// a stream's is its data
+	static constexpr std::size_t numArgs = numPtrs + (counted || stream ? 1 : 0) + (SG_ENABLE_HELPSTRING ? 1 : 0);
+};
+
+template<int T> struct value_type;
+template<> struct value_type<SG_TYPE_CHAR> { using type = char; };
+template<> struct value_type<SG_TYPE_SHORT> { using type = short; };
+template<> struct value_type<SG_TYPE_INT> { using type = int; };
+template<> struct value_type<SG_TYPE_FLOAT> { using type = float; };
+template<> struct value_type<SG_TYPE_DOUBLE> { using type = double; };
+template<> struct value_type<SG_TYPE_STRING> { using type = char *; };
+template<> struct value_type<SG_TYPE_LLONG> { using type = long long; };
+template<> struct value_type<SG_TYPE_ULLONG> { using type = unsigned long long; };
+template<> struct value_type<SG_TYPE_UINT> { using type = unsigned int; };
+template<> struct value_type<SG_TYPE_SIZE> { using type = std::size_t; };
+template<> struct value_type<SG_TYPE_HEX> { using type = unsigned int; };
+template<> struct value_type<SG_TYPE_BYTES> { using type = unsigned long long; };
+template<> struct value_type<SG_TYPE_DURATION> { using type = long long; };
+
+// pointer the I-th argument must be; void for the help string
+template<format F, std::size_t I>
+constexpr auto expected()
+{
+	using t = traits<F>;
+
+	if constexpr( I == t::numPtrs + (t::counted || t::stream ? 1 : 0) ) return( std::type_identity<void>{} );
+	else if constexpr( t::stream && I == 0 ) return( std::type_identity<SG_STREAM_FN>{} );
+	else if constexpr( t::stream ) return( std::type_identity<void *>{} );
+	else if constexpr( t::counted && I == 1 ) return( std::type_identity<int *>{} );
+	else if constexpr( t::p.numargs == 0 ) return( std::type_identity<int *>{} );
+	else if constexpr( t::managed ) return( std::type_identity<typename value_type<t::p.types[0]>::type **>{} );
+	else return( std::type_identity<typename value_type<t::p.types[I]>::type *>{} );
+}
+
+template<typename Arg, typename Want>
+constexpr bool matches()
+{
+	if constexpr( std::is_void_v<Want> ) return( std::is_convertible_v<Arg, const char *> );
+	else if constexpr( std::is_same_v<Want, SG_STREAM_FN> || std::is_same_v<Want, void *> ) return( std::is_convertible_v<Arg, Want> );
+	else if constexpr( std::is_same_v<Want, char **> ) return( std::is_same_v<Arg, char **> || std::is_same_v<Arg, const char **> );
+	else if constexpr( std::is_same_v<Want, char ***> ) return( std::is_same_v<Arg, char ***> || std::is_same_v<Arg, const char ***> );
+	else return( std::is_same_v<Arg, Want> );
+}
+
+template<format F, typename Tuple, std::size_t... I>
+constexpr bool all_match( std::index_sequence<I...> )
+{
+	return( (matches<std::tuple_element_t<I, Tuple>, typename decltype( expected<F, I>() )::type>() && ...) );
+}
+
+} // namespace detail
+
+// one option, ready to go into an SG_OPTION table
+template<std::size_t NP>
+struct option
+{
+	const char *name;
+	int namelen;
+	int numargs;
+	int flags;
+	const int *types;
+	void *ptrs[NP];
+	int *pNumArgs;
+	const char *help;
+	SG_STREAM_FN stream;
+
+	SG_OPTION entry() const
+	{
+		return( SG_OPTION{ name, namelen, numargs, flags, types, ptrs, pNumArgs, help, stream } );
+	}
+};
+
+template<format F, typename... Args>
+option<detail::traits<F>::numPtrs> opt( Args... args )
+{
+	using t = detail::traits<F>;
+	constexpr auto p = t::p;
+
+	static_assert( p.error != SG_ERROR_ZERO_LEN_OPTION, "sg::opt: option name is too short" );
+	static_assert( p.error != SG_ERROR_NO_FORMATS, "sg::opt: '%' without a conversion" );
+	static_assert( p.error != SG_ERROR_BAD_FORMAT_TYPE, "sg::opt: unknown conversion, use %c %hd %d %f %lf %s %lld %llu %u %zu %x %B or %T" );
+	static_assert( p.error != SG_ERROR_MIXED_TYPES_IN_VAR, "sg::opt: a *% list takes exactly one conversion" );
+	static_assert( p.error != SG_ERROR_BAD_FORMAT || !t::managed, "sg::opt: a + option takes exactly one conversion" );
+	static_assert( p.error != SG_ERROR_BAD_FORMAT || !t::stream, "sg::opt: only a *% list can be streamed, as in >*%d" );
+	static_assert( sizeof...(Args) == t::numArgs, "sg::opt: wrong number of arguments for this format" );
+	static_assert( detail::all_match<F, std::tuple<Args...>>( std::make_index_sequence<sizeof...(Args)>{} ),
+			"sg::opt: argument type does not match the format" );
+
+	option<t::numPtrs> o {};
+	std::tuple<Args...> a( args... );
+
+	o.name = F.text;
+	o.namelen = p.namelen;
+	o.numargs = p.numargs;
+	o.flags = p.flags;
+	o.types = t::p.types;
+	if constexpr( t::stream )
+	{
+		o.stream = std::get<0>( a );
+		o.ptrs[0] = (void *) std::get<1>( a );
+	}
+	else
+	{
+		[&]<std::size_t... I>( std::index_sequence<I...> ) {
+			((o.ptrs[I] = (void *) std::get<I>( a )), ...);
+		}( std::make_index_sequence<t::numPtrs>{} );
+	}
+	if constexpr( t::counted ) o.pNumArgs = std::get<1>( a );
+#if SG_ENABLE_HELPSTRING
+	o.help = std::get<sizeof...(Args) - 1>( a );
+#endif
+
+	return( o );
+}
+
+// a compiled spec; status() is 0 or the SG_ERROR_* from compiling it
+class spec
+{
+public:
+	template<typename... Opts>
+	explicit spec( const Opts &... opts )
+	{
+		const std::array<SG_OPTION, sizeof...(Opts)> table = { opts.entry()... };
+
+		error = superCompileTable( &compiled, table.data(), (int) table.size(), &lastArg );
+	}
+
+	~spec() { superFreeOpt( compiled ); }
+
+	spec( const spec & ) = delete;
+	spec &operator=( const spec & ) = delete;
+
+	spec( spec &&other ) noexcept : compiled( other.compiled ), error( other.error ), lastArg( other.lastArg )
+	{
+		other.compiled = nullptr;
+	}
+
+	int status() const { return( error ); }
+	const SG_SPEC *get() const { return( compiled ); }
+
+	int getopt( int argc, char **argv, int *pLastArg ) const
+	{
+		return( compiled != nullptr ? superGetOptSpec( compiled, argc, argv, pLastArg ) : error );
+	}
+
+	int parse( int argc, char **argv, int *pLastArg ) const
+	{
+		return( compiled != nullptr ? superParseOptSpec( compiled, argc, argv, pLastArg ) : error );
+	}
+
+	void usage() const
+	{
+		int unused;
+
+		if( compiled != nullptr ) superGetOptSpec( compiled, 0, nullptr, &unused );
+	}
+
+private:
+	SG_SPEC *compiled = nullptr;
+	int error = 0;
+	int lastArg = 0;
+};
+
+} // namespace sg
+
+#endif
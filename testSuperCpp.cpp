@@ -0,0 +1,134 @@
+/*********************************************************************
+
+Copyright (c) 2007, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Checks for the C++ front end in supergetopt.hpp. Format errors and
+	pointer mismatches are compile errors, so only the accepted cases can
+	run here; the format parser itself is checked with static_assert. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "supergetopt.hpp"
+
+#define CHECK(cond) do { if( !(cond) ) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while(0)
+
+using sg::detail::parse;
+
+static_assert( parse( sg::format( "-puffy %c %lf %s %d" ) ).numargs == 4 );
+static_assert( parse( sg::format( "-puffy %c %lf %s %d" ) ).namelen == 6 );
+static_assert( parse( sg::format( "-puffy %c %lf %s %d" ) ).types[1] == SG_TYPE_DOUBLE );
+static_assert( parse( sg::format( "-vanna *%f" ) ).flags == SG_OPTION_VAR );
+static_assert( parse( sg::format( "-I +%s" ) ).flags == SG_OPTION_MANAGED );
+static_assert( parse( sg::format( "-I +%s" ) ).namelen == 2 );
+static_assert( parse( sg::format( "-help" ) ).numargs == 0 );
+static_assert( parse( sg::format( "-x %q" ) ).error == SG_ERROR_BAD_FORMAT_TYPE );
+static_assert( parse( sg::format( "-x *%d %d" ) ).error == SG_ERROR_MIXED_TYPES_IN_VAR );
+static_assert( parse( sg::format( "-cache %B %llu %lld %zu" ) ).types[0] == SG_TYPE_BYTES );
+static_assert( parse( sg::format( "-cache %B %llu %lld %zu" ) ).types[1] == SG_TYPE_ULLONG );
+static_assert( parse( sg::format( "-cache %B %llu %lld %zu" ) ).types[3] == SG_TYPE_SIZE );
+static_assert( parse( sg::format( "@" ) ).error == 0 && parse( sg::format( "@" ) ).namelen == 1 );
+static_assert( parse( sg::format( "-" ) ).error == SG_ERROR_ZERO_LEN_OPTION );
+static_assert( parse( sg::format( "-vanna >*%d" ) ).flags == (SG_OPTION_VAR | SG_OPTION_STREAM) );
+static_assert( parse( sg::format( "-vanna >*%d" ) ).namelen == 6 );
+static_assert( parse( sg::format( "-vanna >%d" ) ).error == SG_ERROR_BAD_FORMAT );
+
+static void test_basic( void )
+{
+	char c = 'A';
+	double lf = 0.0;
+	char *s = nullptr;
+	const char *name = nullptr;
+	int d = 0, help = 0;
+	float farray[4];
+	int numf = 4;
+	char **incs;
+	int numIncs;
+	int err;
+	const char *args[] = { "prog", "-puffy", "x", "2.5", "hi", "3", "-vanna", "1", "2", "-I", "a", "-name", "n",
+		"-help", "-I", "b", "extra", nullptr };
+
+	sg::spec options(
+			sg::opt<"-puffy %c %lf %s %d">( &c, &lf, &s, &d, "help message 1" ),
+			sg::opt<"-vanna *%f">( farray, &numf, "help message 2" ),
+			sg::opt<"-I +%s">( &incs, &numIncs, "include paths" ),
+			sg::opt<"-name %s">( &name, "a const char *" ),
+			sg::opt<"-help">( &help, "help message 3" ) );
+	CHECK( options.status() == 0 );
+
+	CHECK( options.getopt( 17, const_cast<char **>( args ), &err ) == 1 );
+	CHECK( c == 'x' && lf == 2.5 && strcmp( s, "hi" ) == 0 && d == 3 );
+	CHECK( numf == 2 && farray[1] == 2.0f );
+	CHECK( numIncs == 2 && strcmp( incs[1], "b" ) == 0 );
+	CHECK( strcmp( name, "n" ) == 0 && help == 1 );
+
+	const char *bad[] = { "-puffy", "xy" };
+	CHECK( options.parse( 2, const_cast<char **>( bad ), &err ) == SG_ERROR_INCORRECT_ARG );
+
+	sg::spec moved( std::move( options ) );
+	CHECK( moved.get() != nullptr && options.get() == nullptr );
+}
+
+static void test_stream( void )
+{
+	long long sum = 0;
+	int err;
+	const char *args[] = { "-sum", "1", "2", "3", "-sum", "4" };
+
+	sg::spec options(
+			sg::opt<"-sum >*%d">( []( void *data, const void *values, int count ) {
+				for( int i = 0 ; i < count ; i++ ) *(long long *) data += ((const int *) values)[i];
+				return( 0 );
+			}, (void *) &sum, "streamed" ) );
+	CHECK( options.status() == 0 );
+
+	CHECK( options.parse( 6, const_cast<char **>( args ), &err ) == 0 );
+	CHECK( sum == 10 );
+}
+
+static void test_response( void )
+{
+	int d = 0, response = 0, err;
+	const char *args[] = { "-d", "1", "@/nonexistent/superGetOpt.rsp" };
+
+	sg::spec options(
+			sg::opt<"-d %d">( &d, "a number" ),
+			sg::opt<"@">( &response, "read arguments from @file" ) );
+	CHECK( options.status() == 0 );
+
+	// "@" turns response files on, so a missing one is an error rather than an argument
+	CHECK( options.parse( 3, const_cast<char **>( args ), &err ) == SG_ERROR_FILE );
+}
+
+int main( void )
+{
+	test_basic();
+	test_stream();
+	test_response();
+
+	printf("testSuperCpp: all tests passed\n");
+
+	return(0);
+}
@@ -0,0 +1,124 @@
+/*********************************************************************
+
+Copyright (c) 2007, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Self-checking tests for a spec compiled at build time by superSpecGen
+	(testSuperGen.spec -> testSuperGenOpts.[ch]). Exits non-zero on the
+	first failure. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testSuperGenOpts.h"
+#include "superGetOptTables.h"
+
+#define CHECK(cond) do { if( !(cond) ) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while(0)
+
+static void test_generated( void )
+{
+	tsg_results r1, r2;
+	SG_CTX ctx;
+	int err, n;
+	char *argv[] = { "prog", "-puffy", "x", "2.5", "hi", "3", "-vanna", "1", "2", "3", "-I", "a", "-I", "b",
+		"-level", "7", "--dry-run", "-int", "42", "extra", NULL };
+
+	memset( &r1, 0, sizeof(r1) );
+	n = tsg_getopt( &r1, 20, argv, &err );
+	CHECK( n == 1 );
+	CHECK( r1.puffy_0 == 'x' && r1.puffy_1 == 2.5 && strcmp( r1.puffy_2, "hi" ) == 0 && r1.puffy_3 == 3 );
+	CHECK( r1.num_vanna == 3 && r1.vanna[0] == 1.0f && r1.vanna[2] == 3.0f );
+	CHECK( r1.num_I == 2 && strcmp( r1.I[0], "a" ) == 0 && strcmp( r1.I[1], "b" ) == 0 );
+	CHECK( r1.level == 7 && r1.dry_run == 1 && r1.int_ == 42 && r1.help == 0 );
+
+	// a second results struct is filled independently of the first
+	memset( &r2, 0, sizeof(r2) );
+	CHECK( tsg_parse( &r2, 3, (char *[]) { "-help", "-vanna", "9" }, &err ) == 0 );
+	CHECK( r2.help == 1 && r2.num_vanna == 1 && r2.vanna[0] == 9.0f && r2.dry_run == 0 );
+	CHECK( r1.help == 0 && r1.num_vanna == 3 && r1.level == 7 );
+
+	// the capacity from the spec file bounds the list; extra values are dropped
+	CHECK( tsg_parse( &r2, 10, (char *[]) { "-vanna", "1", "2", "3", "4", "5", "6", "7", "8", "9" }, &err ) == 0 );
+	CHECK( r2.num_vanna == 8 && r2.vanna[7] == 8.0f );
+
+	CHECK( tsg_parse( &r2, 2, (char *[]) { "-level", "x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( tsg_parse( &r2, 1, (char *[]) { "-puffy" }, &err ) == SG_ERROR_MISSING_ARG );
+
+	CHECK( tsg_lookup( "-puffy" ) == tsg_OPT_PUFFY );
+	CHECK( tsg_lookup( "--dry-run" ) == tsg_OPT_DRY_RUN );
+	CHECK( tsg_lookup( "-help" ) == tsg_OPT_HELP && tsg_OPT_HELP == tsg_NUM_OPTS - 1 );
+	CHECK( tsg_lookup( "-nope" ) < 0 );
+
+	// abbreviations work from the generated trie as well
+	CHECK( tsg_parse( &r2, 3, (char *[]) { "--dry", "-lev", "2" }, &err ) == 0 );
+	CHECK( r2.dry_run == 1 && r2.level == 2 );
+	CHECK( tsg_lookup( "--dry" ) < 0 );	// lookups stay exact
+
+	// the generated outputs are offsets, so a context needs a results struct
+	CHECK( superInitCtx( &ctx, tsg_spec, NULL, NULL, 0 ) == SG_ERROR_BAD_FORMAT );
+	CHECK( superParseOptCtx( &ctx, 1, (char *[]) { "-help" }, &err ) == SG_ERROR_BAD_FORMAT );
+	CHECK( superParseOptSpec( tsg_spec, 1, (char *[]) { "-help" }, &err ) == SG_ERROR_BAD_FORMAT );
+	CHECK( superInitCtx( &ctx, tsg_spec, NULL, &r2, sizeof(r2) ) == 0 );
+}
+
+static void test_matches_runtime( void )
+{
+	SG_SPEC *spec;
+	tsg_results r;
+	int err, numv = 8, numI = 0;
+
+	// the generated tables are the ones superCompileOpt() builds
+	CHECK( superCompileOpt( &spec, &err,
+			"-puffy %c %lf %s %d", &r.puffy_0, &r.puffy_1, &r.puffy_2, &r.puffy_3, "help message 1",
+			"-vanna *%f", r.vanna, &numv, "up to 8 floats",
+			"-I +%s", &r.I, &numI, "include path, repeatable",
+			"-level %hd", &r.level, "a short",
+			"--dry-run", &r.dry_run, "a flag with dashes",
+			"-int %d", &r.int_, "a keyword as a name",
+			"@", &r.response_files, "read more arguments from a file",
+			"-help", &r.help, "to get this help message",
+			(char *) 0 ) == 0 );
+	CHECK( spec->optnum == tsg_spec->optnum && spec->maxNameLen == tsg_spec->maxNameLen );
+	CHECK( spec->responseOpt == tsg_spec->responseOpt && spec->responseOpt == tsg_OPT_RESPONSE_FILES + 1 );
+	CHECK( spec->bucketMask == tsg_spec->bucketMask && spec->slotMask == tsg_spec->slotMask );
+	CHECK( memcmp( spec->firstBytes, tsg_spec->firstBytes, sizeof(spec->firstBytes) ) == 0 );
+	CHECK( memcmp( spec->disp, tsg_spec->disp, (spec->bucketMask + 1) * sizeof(unsigned int) ) == 0 );
+	CHECK( memcmp( spec->slots, tsg_spec->slots, (spec->slotMask + 1) * sizeof(struct sg_hashslot_s) ) == 0 );
+	CHECK( memcmp( spec->byName, tsg_spec->byName, spec->optnum * sizeof(int) ) == 0 );
+	CHECK( strcmp( superUsageText( spec, SG_USAGE_TEXT, NULL ), superUsageText( tsg_spec, SG_USAGE_TEXT, NULL ) ) == 0 );
+	CHECK( strcmp( superUsageText( spec, SG_USAGE_JSON, NULL ), superUsageText( tsg_spec, SG_USAGE_JSON, NULL ) ) == 0 );
+	CHECK( spec->trie[0].numChildren == tsg_spec->trie[0].numChildren && spec->trie[0].hi == tsg_spec->trie[0].hi );
+
+	superFreeOpt( spec );
+}
+
+int main( void )
+{
+	test_generated();
+	test_matches_runtime();
+
+	printf("testSuperGen: all tests passed\n");
+
+	return(0);
+}
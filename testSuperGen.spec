@@ -0,0 +1,9 @@
+# Options for testSuperGen; compiled by superSpecGen into testSuperGenOpts.[ch]
+"-puffy %c %lf %s %d"	"help message 1"
+"-vanna *%f"			"up to 8 floats"	8
+"-I +%s"				"include path, repeatable"
+"-level %hd"			"a short"
+"--dry-run"				"a flag with dashes"
+"-int %d"				"a keyword as a name"
+"@"						"read more arguments from a file"
+"-help"					"to get this help message"
@@ -0,0 +1,1522 @@
+/*********************************************************************
+
+Copyright (c) 2007, Anthony P. Russo
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+    * Neither the name of Russolutions, Inc. nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*********************************************************************/
+
+/* Self-checking tests for the compiled spec API. Exits non-zero on the
+	first failure. Linked with --wrap=malloc etc. (see Makefile) so that
+	the library's heap use can be counted. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <locale.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include "supergetopt.h"
+
+#define CHECK(cond) do { if( !(cond) ) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while(0)
+
+static long numAllocs = 0;
+static long numLive = 0;
+
+void *__real_malloc( size_t n );
+void *__real_calloc( size_t n, size_t m );
+void *__real_realloc( void *p, size_t n );
+void __real_free( void *p );
+
+void *__wrap_malloc( size_t n ) { numAllocs++; numLive++; return( __real_malloc( n ) ); }
+void *__wrap_calloc( size_t n, size_t m ) { numAllocs++; numLive++; return( __real_calloc( n, m ) ); }
+void *__wrap_realloc( void *p, size_t n ) { numAllocs++; if( p == NULL ) numLive++; return( __real_realloc( p, n ) ); }
+void __wrap_free( void *p ) { if( p != NULL ) numLive--; __real_free( p ); }
+
+/* 64 flags with long names, well past the old MAXOPTS/MAXSTRING limits */
+#define LONGNAME "--a-rather-long-option-name-that-used-to-be-limited-to-one-hundred-and-twenty-characters-in-total-"
+#define FLAG8(n) LONGNAME #n "0", &flags[n*8+0], "", LONGNAME #n "1", &flags[n*8+1], "", \
+	LONGNAME #n "2", &flags[n*8+2], "", LONGNAME #n "3", &flags[n*8+3], "", \
+	LONGNAME #n "4", &flags[n*8+4], "", LONGNAME #n "5", &flags[n*8+5], "", \
+	LONGNAME #n "6", &flags[n*8+6], "", LONGNAME #n "7", &flags[n*8+7], ""
+
+static void test_basic( void )
+{
+	SG_SPEC *spec;
+	int err, n;
+	char c = 'A';
+	double lf = 0.0;
+	char *s = NULL;
+	int d = 0, help = 0;
+	float farray[4];
+	int numf = 4;
+	char *argv[] = { "prog", "-puffy", "x", "2.5", "hi", "3", "-vanna", "1", "2", "3", "4", "5", "-help", "extra", NULL };
+
+	n = superCompileOpt( &spec, &err,
+			"-puffy %c %lf %s %d", &c, &lf, &s, &d, "help message 1",
+			"-vanna *%f", farray, &numf, "help message 2",
+			"-help", &help, "help message 3",
+			(char *) 0 );
+	CHECK( n == 0 && spec != NULL );
+
+	n = superGetOptSpec( spec, 14, argv, &err );
+	CHECK( n == 1 );
+	CHECK( c == 'x' && lf == 2.5 && strcmp( s, "hi" ) == 0 && d == 3 );
+	CHECK( numf == 4 && farray[0] == 1.0f && farray[3] == 4.0f );	// fifth value dropped, array full
+	CHECK( help == 1 );
+
+	superFreeOpt( spec );
+}
+
+static void test_integers( void )
+{
+	SG_SPEC *spec;
+	int err, n;
+	char c;
+	short h;
+	int d;
+	int iarray[4];
+	int numi = 4;
+
+	n = superCompileOpt( &spec, &err,
+			"-c %c", &c, "help",
+			"-h %hd", &h, "help",
+			"-d %d", &d, "help",
+			"-list *%d", iarray, &numi, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	CHECK( superParseOptSpec( spec, 6, (char *[]) { "-d", "-2147483648", "-h", "32767", "-c", "z" }, &err ) == 0 );
+	CHECK( d == INT_MIN && h == 32767 && c == 'z' );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-d", "12abc" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-d", "2147483648" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-h", "32768" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-c", "zz" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-d", "" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 5, (char *[]) { "-list", "+7", "-000000000000000000012", "999999999999999", "-c" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 6, (char *[]) { "-list", "+7", "-000000000000000000012", "2147483647", "-d", "1" }, &err ) == 0 );
+	CHECK( numi == 3 && iarray[0] == 7 && iarray[1] == -12 && iarray[2] == INT_MAX && d == 1 );
+
+	superFreeOpt( spec );
+}
+
+static void test_wide_types( void )
+{
+	SG_SPEC *spec;
+	int err, numIds = 4, numSizes;
+	long long big, ids[4], timeout;
+	unsigned long long ubig, cache, *sizes;
+	unsigned int count, mask;
+	size_t len;
+	const char *json;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-big %lld", &big, "help",
+			"-ubig %llu", &ubig, "help",
+			"-count %u", &count, "help",
+			"-len %zu", &len, "help",
+			"-mask %x", &mask, "help",
+			"-cache %B", &cache, "help",
+			"-timeout %T", &timeout, "help",
+			"-ids *%lld", ids, &numIds, "help",
+			"-sizes +*%B", &sizes, &numSizes, "help",
+			(char *) 0 ) == 0 );
+
+	CHECK( superParseOptSpec( spec, 14, (char *[]) { "-big", "-9223372036854775808", "-ubig", "18446744073709551615",
+			"-count", "4294967295", "-len", "3000000000", "-mask", "DeadBeef", "-cache", "512M", "-timeout", "250ms" }, &err ) == 0 );
+	CHECK( big == LLONG_MIN && ubig == ULLONG_MAX && count == UINT_MAX && len == 3000000000ULL && mask == 0xdeadbeef );
+	CHECK( cache == 512ULL << 20 && timeout == 250000000LL );
+
+	// hex after 0x for the unsigned types, 0x optional for %x
+	CHECK( superParseOptSpec( spec, 8, (char *[]) { "-ubig", "0xFFFFFFFFFFFFFFFF", "-count", "0x10", "-len", "0X1f", "-mask", "0xff" }, &err ) == 0 );
+	CHECK( ubig == ULLONG_MAX && count == 16 && len == 31 && mask == 255 );
+
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-big", "9223372036854775808" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-ubig", "-1" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-ubig", "18446744073709551616" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-count", "4294967296" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-count", "0x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-mask", "1g" }, &err ) == SG_ERROR_INCORRECT_ARG );
+
+	// sizes: K..E are powers of 1024, B and iB optional, fractions need a multiplier
+	CHECK( superParseOptSpec( spec, 10, (char *[]) { "-sizes", "4GiB", "1.5k", "100", "7B", "2mb", "15E", "0.5K", "-cache", "1T" }, &err ) == 0 );
+	CHECK( numSizes == 7 && sizes[0] == 4ULL << 30 && sizes[1] == 1536 && sizes[2] == 100 && sizes[3] == 7 );
+	CHECK( sizes[4] == 2ULL << 20 && sizes[5] == 15ULL << 60 && sizes[6] == 512 && cache == 1ULL << 40 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-cache", "1.5" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-cache", "5Ki" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-cache", "16E" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-cache", "12Q" }, &err ) == SG_ERROR_INCORRECT_ARG );
+
+	// durations in nanoseconds; a lone number is seconds
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "1h30m" }, &err ) == 0 && timeout == 5400LL * 1000000000 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "1.5s" }, &err ) == 0 && timeout == 1500000000LL );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "2" }, &err ) == 0 && timeout == 2000000000LL );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "1m0.5us" }, &err ) == 0 && timeout == 60000000500LL );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "1h5" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "5x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-timeout", "300000d" }, &err ) == SG_ERROR_INCORRECT_ARG );
+
+	// 64-bit lists end at the next option like any other
+	CHECK( superParseOptSpec( spec, 5, (char *[]) { "-ids", "4294967296", "-7", "-len", "1" }, &err ) == 0 );
+	CHECK( numIds == 2 && ids[0] == 4294967296LL && ids[1] == -7 && len == 1 );
+
+	json = superUsageText( spec, SG_USAGE_JSON, NULL );
+	CHECK( json != NULL && strstr( json, "\"types\":[\"bytes\"]" ) != NULL && strstr( json, "\"types\":[\"duration\"]" ) != NULL );
+	superFreeOpt( spec );
+}
+
+static void test_reals( void )
+{
+	SG_SPEC *spec;
+	int err, n;
+	float f;
+	double lf;
+	double darray[4];
+	int numd = 4;
+
+	setlocale( LC_NUMERIC, "de_DE.UTF-8" );	// a decimal comma must not matter; fine if not installed
+
+	n = superCompileOpt( &spec, &err,
+			"-f %f", &f, "help",
+			"-lf %lf", &lf, "help",
+			"-coef *%lf", darray, &numd, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	CHECK( superParseOptSpec( spec, 4, (char *[]) { "-f", "3.14", "-lf", "0.1" }, &err ) == 0 );
+	CHECK( f == 3.14f && lf == 0.1 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-lf", "2.5x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-lf", "3,14" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superParseOptSpec( spec, 5, (char *[]) { "-coef", "1e-400", "-2.2250738585072011e-308", "179769313486231580793728971405301e276", "-f" }, &err ) == SG_ERROR_MISSING_ARG );
+	CHECK( numd == 3 && darray[0] == 0.0 && darray[1] == -2.2250738585072009e-308 && darray[2] == 1.7976931348623157e308 );
+	// 0.5 ulp above 1 + 2^-52 would round to even (down) without the trailing 1
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-lf", "1.00000000000000033306690738754696212708950042724609375000000000000000000001" }, &err ) == 0 );
+	CHECK( lf == 1.0000000000000004 );
+
+	setlocale( LC_NUMERIC, "C" );
+	superFreeOpt( spec );
+}
+
+static void test_many_options( void )
+{
+	SG_SPEC *spec;
+	int err, n;
+	int flags[64];
+	char *argv[] = { "prog", LONGNAME "00", LONGNAME "77", LONGNAME "35", LONGNAME "3", NULL };
+
+	n = superCompileOpt( &spec, &err, FLAG8(0), FLAG8(1), FLAG8(2), FLAG8(3), FLAG8(4), FLAG8(5), FLAG8(6), FLAG8(7), (char *) 0 );
+	CHECK( n == 0 );
+
+	n = superGetOptSpec( spec, 5, argv, &err );
+	CHECK( n == 1 );	// the truncated name is not an option
+	CHECK( flags[0] == 1 && flags[63] == 1 && flags[29] == 1 && flags[30] == 0 );
+
+	superFreeOpt( spec );
+}
+
+static void test_prefix( void )
+{
+	SG_SPEC *spec;
+	const char *names[4];
+	int err, verbose, version, v, d;
+	int iarray[4], numi = 4;
+	char *sarray[4];
+	int nums = 4;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"--verbose", &verbose, "help",
+			"--version", &version, "help",
+			"-v", &v, "help",
+			"-depth %d", &d, "help",
+			"-list *%d", iarray, &numi, "help",
+			"-strings *%s", sarray, &nums, "help",
+			(char *) 0 ) == 0 );
+
+	// names match exactly until abbreviations are asked for
+	CHECK( superParseOptSpec( spec, 3, (char *[]) { "-strings", "a", "--verb" }, &err ) == 0 );
+	CHECK( nums == 2 && strcmp( sarray[1], "--verb" ) == 0 );
+	nums = 4;
+	superPrefixOpt( spec, 1 );
+
+	CHECK( superParseOptSpec( spec, 4, (char *[]) { "--verb", "-dep", "3", "-v" }, &err ) == 0 );
+	CHECK( verbose == 1 && version == 0 && v == 1 && d == 3 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "--versio", "-d" }, &err ) == SG_ERROR_MISSING_ARG );
+	CHECK( version == 1 );
+
+	// "-v" is a name, "--ver" starts two
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-d", "1" }, &err ) == 0 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-v", "--ver" }, &err ) == SG_ERROR_AMBIGUOUS_OPTION );
+	CHECK( superPrefixMatches( spec, "--ver", names, 4 ) == 2 );
+	CHECK( strcmp( names[0], "--verbose" ) == 0 && strcmp( names[1], "--version" ) == 0 );
+	CHECK( superPrefixMatches( spec, "-", names, 1 ) == 6 && strcmp( names[0], "--verbose" ) == 0 );
+	CHECK( superPrefixMatches( spec, "-x", names, 4 ) == 0 );
+
+	// abbreviations end lists; an ambiguous one is reported, not taken as a value
+	CHECK( superParseOptSpec( spec, 5, (char *[]) { "-list", "1", "-5", "-str", "a" }, &err ) == 0 );
+	CHECK( numi == 2 && iarray[1] == -5 && nums == 1 );
+	CHECK( superParseOptSpec( spec, 3, (char *[]) { "-strings", "a", "--v" }, &err ) == SG_ERROR_AMBIGUOUS_OPTION );
+	CHECK( superParseOptSpec( spec, 3, (char *[]) { "-list", "1", "--ver" }, &err ) == SG_ERROR_AMBIGUOUS_OPTION );
+
+	// dashes alone stay arguments
+	CHECK( superParseOptSpec( spec, 3, (char *[]) { "-", "--", "x" }, &err ) == 3 );
+
+	superFreeOpt( spec );
+}
+
+static void test_allocations( void )
+{
+	SG_SPEC *spec;
+	int err, n, i;
+	int d1 = 0, d2 = 0, help = 0;
+	int iarray[8];
+	int numi = 8;
+	char *sarray[8];
+	int nums = 8;
+	char *argv[] = { "prog", "-e", "1", "2", "-list", "5", "6", "7", "-strings", "a", "b", "-help", NULL };
+	long before, start;
+
+	start = numLive;
+	n = superCompileOpt( &spec, &err,
+			"-e %d %d", &d1, &d2, "help",
+			"-list *%d", iarray, &numi, "help",
+			"-strings *%s", sarray, &nums, "help",
+			"-help", &help, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+	CHECK( numLive - start == 1 );	// the whole spec is a single arena
+
+	before = numAllocs;
+	for( i = 0 ; i < 1000 ; i++ )
+	{
+		n = superGetOptSpec( spec, 12, argv, &err );
+		CHECK( n == 0 );
+	}
+	CHECK( numAllocs == before );	// nothing on the parse path
+	CHECK( d2 == 2 && numi == 3 && iarray[2] == 7 && nums == 2 && help == 1 );
+
+	superFreeOpt( spec );
+	CHECK( numLive == start );
+}
+
+/* Several threads parse different argv's with one spec at once, each
+	into its own copy of the results struct through an SG_CTX. */
+#define NUM_THREADS 8
+#define NUM_ITERATIONS 20000
+
+struct results_s
+{
+	int d;
+	double lf;
+	char *s;
+	int iarray[8];
+	int numi;
+	int help;
+};
+
+static struct results_s resultsTemplate;
+static SG_SPEC *threadSpec;
+
+static void *parse_thread( void *arg )
+{
+	long id = (long) arg;
+	struct results_s r;
+	SG_CTX ctx;
+	char dbuf[32], lfbuf[32], i0buf[32], i1buf[32];
+	char *argv[] = { "prog", "-d", dbuf, "-lf", lfbuf, "-s", "thread", "-list", i0buf, i1buf, NULL, NULL };
+	int err, n, k, argc;
+
+	superInitCtx( &ctx, threadSpec, &resultsTemplate, &r, sizeof(r) );
+
+	for( k = 0 ; k < NUM_ITERATIONS ; k++ )
+	{
+		sprintf( dbuf, "%ld", id * 1000000 + k );
+		sprintf( lfbuf, "%ld.5", id );
+		sprintf( i0buf, "%d", k );
+		sprintf( i1buf, "%d", -k );
+		argc = 10;
+		if( k & 1 ) argv[argc++] = "-help";
+
+		memset( &r, 0xff, sizeof(r) );
+		n = superGetOptCtx( &ctx, argc, argv, &err );
+		if( n != 0 || r.d != id * 1000000 + k || r.lf != id + 0.5 || strcmp( r.s, "thread" ) != 0 ||
+			r.numi != 2 || r.iarray[0] != k || r.iarray[1] != -k || r.help != (k & 1) )
+		{
+			return( (void *) 1 );
+		}
+		argv[10] = NULL;
+	}
+
+	return( NULL );
+}
+
+static void test_threads( void )
+{
+	pthread_t threads[NUM_THREADS];
+	void *ret;
+	long t;
+	int err, n;
+
+	resultsTemplate.numi = 8;
+	n = superCompileOpt( &threadSpec, &err,
+			"-d %d", &resultsTemplate.d, "help",
+			"-lf %lf", &resultsTemplate.lf, "help",
+			"-s %s", &resultsTemplate.s, "help",
+			"-list *%d", resultsTemplate.iarray, &resultsTemplate.numi, "help",
+			"-help", &resultsTemplate.help, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	for( t = 0 ; t < NUM_THREADS ; t++ ) CHECK( pthread_create( &threads[t], NULL, parse_thread, (void *) t ) == 0 );
+	for( t = 0 ; t < NUM_THREADS ; t++ )
+	{
+		CHECK( pthread_join( threads[t], &ret ) == 0 );
+		CHECK( ret == NULL );
+	}
+	CHECK( resultsTemplate.numi == 8 );	// the template itself is never written
+
+	superFreeOpt( threadSpec );
+}
+
+/* writes len bytes to a fresh temp file and opens it */
+static void write_temp( char *path, const char *text, size_t len )
+{
+	int fd;
+
+	strcpy( path, "/tmp/testSuperSpecXXXXXX" );
+	fd = mkstemp( path );
+	CHECK( fd >= 0 );
+	CHECK( write( fd, text, len ) == (ssize_t) len );
+	close( fd );
+}
+
+static SG_FILE *open_temp( char *path, const char *text, size_t len )
+{
+	SG_FILE *file;
+
+	write_temp( path, text, len );
+	CHECK( superOpenFile( &file, path ) == 0 );
+	unlink( path );
+
+	return( file );
+}
+
+static void test_file( void )
+{
+	SG_SPEC *spec;
+	SG_FILE *file;
+	char path[64];
+	char big[4096];
+	int err, n, d, help;
+	double lf;
+	char *s, *name;
+	int iarray[8];
+	int numi = 8;
+	const char *conf =
+		"# generated\n"
+		"-d 1\n"
+		"\n"
+		"-s \"hello world\"   -name 'it'\\''s' # not an option\n"
+		"-list 1 2 \\\n"
+		"   3 4\r\n"
+		"stray -lf 2.5\n"
+		"-d 42 -help";
+
+	n = superCompileOpt( &spec, &err,
+			"-d %d", &d, "help",
+			"-lf %lf", &lf, "help",
+			"-s %s", &s, "help",
+			"-name %s", &name, "help",
+			"-list *%d", iarray, &numi, "help",
+			"-help", &help, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	file = open_temp( path, conf, strlen( conf ) );
+	CHECK( superParseFile( spec, file, &err ) == 1 );	// "stray"
+	CHECK( d == 42 && lf == 2.5 && help == 1 );
+	CHECK( strcmp( s, "hello world" ) == 0 && strcmp( name, "it's" ) == 0 );
+	CHECK( numi == 4 && iarray[0] == 1 && iarray[3] == 4 );
+	CHECK( superParseFile( spec, file, &err ) == SG_ERROR_FILE );
+	superCloseFile( file );
+
+	file = open_temp( path, "-d 1\n\n-help -d x\n-d 2\n", 21 );
+	CHECK( superParseFile( spec, file, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superFileLine( file ) == 3 && err == 3 );
+	superCloseFile( file );
+
+	file = open_temp( path, "-s \"open\n-d 1\n", 14 );
+	CHECK( superParseFile( spec, file, &err ) == SG_ERROR_UNTERMINATED_QUOTE );
+	superCloseFile( file );
+
+	// exactly one page, last token running into the end of the data
+	memset( big, 'x', sizeof(big) );
+	memcpy( big, "-s ", 3 );
+	file = open_temp( path, big, sizeof(big) );
+	CHECK( superParseFile( spec, file, &err ) == 0 );
+	CHECK( strlen( s ) == sizeof(big) - 3 );
+	superCloseFile( file );
+
+	CHECK( superOpenFile( &file, "/nonexistent/testSuperSpec" ) == SG_ERROR_FILE && file == NULL );
+
+	superFreeOpt( spec );
+}
+
+#define NUM_RECORDS 5000
+
+struct job_s
+{
+	int id;
+	double mem;
+	int numDeps;
+	int deps[4];
+	char ids[16];
+};
+
+static void test_batch( void )
+{
+	static struct job_s jobs[NUM_RECORDS];
+	static SG_RECORD records[NUM_RECORDS];
+	static char *argvs[NUM_RECORDS][8];
+	struct job_s template;
+	SG_SPEC *spec;
+	int err, n, i, bad = 0;
+
+	template.numDeps = 4;
+	n = superCompileOpt( &spec, &err,
+			"-id %d", &template.id, "help",
+			"-mem %lf", &template.mem, "help",
+			"-deps *%d", template.deps, &template.numDeps, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	for( i = 0 ; i < NUM_RECORDS ; i++ )
+	{
+		sprintf( jobs[i].ids, "%d", i );
+		argvs[i][0] = "-id";
+		argvs[i][1] = i % 7 == 3 ? "oops" : jobs[i].ids;
+		argvs[i][2] = "-mem";
+		argvs[i][3] = "1.5";
+		argvs[i][4] = "-deps";
+		argvs[i][5] = "1";
+		argvs[i][6] = jobs[i].ids;
+		records[i].argc = i % 100 == 99 ? 0 : 2 + (i % 3) * 2 + (i % 3 == 2);
+		records[i].argv = argvs[i];
+		records[i].out = &jobs[i];
+		if( i % 7 == 3 && records[i].argc > 0 ) bad++;
+	}
+
+	CHECK( superParseBatch( spec, records, NUM_RECORDS, &template, sizeof(template), 4 ) == bad );
+
+	for( i = 0 ; i < NUM_RECORDS ; i++ )
+	{
+		if( records[i].argc == 0 )
+		{
+			CHECK( records[i].status == 0 && jobs[i].numDeps == 0 );
+		}
+		else if( i % 7 == 3 )
+		{
+			CHECK( records[i].status == SG_ERROR_INCORRECT_ARG && records[i].lastArg == 2 );
+		}
+		else
+		{
+			CHECK( records[i].status == 0 && jobs[i].id == i );
+			CHECK( i % 3 == 0 || jobs[i].mem == 1.5 );
+			CHECK( i % 3 != 2 || (jobs[i].numDeps == 2 && jobs[i].deps[1] == i) );
+		}
+	}
+
+	superFreeOpt( spec );
+}
+
+static void test_usage( void )
+{
+	SG_SPEC *spec;
+	const char *text, *json;
+	char path[64], back[512];
+	size_t len, jsonLen;
+	long before;
+	int err, d, help, fd;
+	float farray[4];
+	int numf = 4;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-d %d", &d, "an \"int\"\tvalue",
+			"-vanna *%f", farray, &numf, "floats",
+			"-help", &help, "to get this help message",
+			(char *) 0 ) == 0 );
+
+	text = superUsageText( spec, SG_USAGE_TEXT, &len );
+	CHECK( text != NULL && len == strlen( text ) );
+	CHECK( strcmp( text, "***** Usage *****\n"
+			"\t -d int <an \"int\"\tvalue>\n"
+			"\t -vanna float [float, ...] <floats>\n"
+			"\t -help <to get this help message>\n" ) == 0 );
+
+	json = superUsageText( spec, SG_USAGE_JSON, &jsonLen );
+	CHECK( json != NULL && jsonLen == strlen( json ) );
+	CHECK( strcmp( json, "{\"options\":["
+			"{\"name\":\"-d\",\"types\":[\"int\"],\"var\":false,\"repeatable\":false,\"streamed\":false,\"help\":\"an \\\"int\\\"\\tvalue\"},"
+			"{\"name\":\"-vanna\",\"types\":[\"float\"],\"var\":true,\"repeatable\":false,\"streamed\":false,\"help\":\"floats\"},"
+			"{\"name\":\"-help\",\"types\":[],\"var\":false,\"repeatable\":false,\"streamed\":false,\"help\":\"to get this help message\"}"
+			"]}\n" ) == 0 );
+
+	// rendered once; later calls hand out the same buffer
+	before = numAllocs;
+	CHECK( superUsageText( spec, SG_USAGE_TEXT, NULL ) == text );
+	CHECK( superUsageText( spec, SG_USAGE_JSON, NULL ) == json );
+	CHECK( numAllocs == before );
+	CHECK( superUsageText( spec, 2, NULL ) == NULL );
+
+	write_temp( path, "", 0 );
+	fd = open( path, O_WRONLY | O_TRUNC );
+	CHECK( fd >= 0 );
+	CHECK( superWriteUsage( spec, SG_USAGE_TEXT, fd ) == 0 );
+	close( fd );
+	fd = open( path, O_RDONLY );
+	CHECK( read( fd, back, sizeof(back) ) == (ssize_t) len && memcmp( back, text, len ) == 0 );
+	close( fd );
+	unlink( path );
+
+	superFreeOpt( spec );
+}
+
+static void test_env( void )
+{
+	SG_SPEC *spec;
+	SG_RECORD rec;
+	const char *names[7] = { NULL, NULL, NULL, NULL, "TSS_LEVEL_OVERRIDE", NULL, NULL };
+	char *s;
+	int *sizes;
+	int err, port, verbose, quiet, level, numSizes;
+	double lf;
+	char *args[4];
+	int numArgs = 4;
+
+	// the index is built on the first parse, so set everything up front
+	setenv( "TSS_PORT", "8080", 1 );
+	setenv( "TSS_SERVER_NAME", "  two words ", 1 );
+	setenv( "TSS_VERBOSE", "yes", 1 );
+	setenv( "TSS_QUIET", "0", 1 );
+	setenv( "TSS_SIZES", " 1\t2  3 ", 1 );
+	setenv( "TSS_LEVEL_OVERRIDE", "7", 1 );
+	setenv( "TSS_LEVEL", "99", 1 );
+	setenv( "TSS_RATIO", "", 1 );
+	setenv( "TSS_BAD_PORT", "80 81", 1 );
+	setenv( "TSS_BAD_RATIO", "x", 1 );
+	setenv( "TSS_ARGS", "-port @missing.rsp -x", 1 );
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-port %d", &port, "",
+			"--server.name %s", &s, "",
+			"-verbose", &verbose, "",
+			"-quiet", &quiet, "",
+			"-level %d", &level, "",
+			"-sizes +*%d", &sizes, &numSizes, "",
+			"-ratio %lf", &lf, "",
+			(char *) 0 ) == 0 );
+	CHECK( superEnvOpt( spec, "TSS_", names ) == 0 );
+
+	// nothing on the command line: everything comes from the environment
+	port = level = 0;
+	s = NULL;
+	lf = 1.5;
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "extra" }, &err ) == 1 );
+	CHECK( port == 8080 && strcmp( s, "  two words " ) == 0 && verbose == 1 && quiet == 0 );
+	CHECK( level == 7 && numSizes == 3 && sizes[0] == 1 && sizes[2] == 3 && lf == 1.5 );
+
+	// flags and values given on the command line win
+	CHECK( superParseOptSpec( spec, 6, (char *[]) { "-port", "1", "-sizes", "9", "-level", "2" }, &err ) == 0 );
+	CHECK( port == 1 && numSizes == 1 && sizes[0] == 9 && level == 2 && verbose == 1 );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "-quiet" }, &err ) == 0 && quiet == 1 );
+
+	// changes after the first parse are not seen
+	setenv( "TSS_PORT", "9090", 1 );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "-verbose" }, &err ) == 0 && port == 8080 );
+
+	// explicit names only
+	names[0] = "TSS_BAD_PORT";
+	CHECK( superEnvOpt( spec, NULL, names ) == 0 );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "-level" }, &err ) == SG_ERROR_MISSING_ARG );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-level", "3" }, &err ) == SG_ERROR_TOO_MANY_ARGS );
+	CHECK( superParseOptSpec( spec, 4, (char *[]) { "-port", "1", "-level", "3" }, &err ) == 0 );
+	names[0] = NULL;
+	names[4] = NULL;
+	names[6] = "TSS_BAD_RATIO";
+	CHECK( superEnvOpt( spec, NULL, names ) == 0 );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "-quiet" }, &err ) == SG_ERROR_INCORRECT_ARG );
+
+	names[1] = "";
+	CHECK( superEnvOpt( spec, NULL, names ) == SG_ERROR_ZERO_LEN_OPTION );
+
+	// the values live in the per-thread arena, which batches do not have
+	rec.argc = 1;
+	rec.argv = (char *[]) { "-quiet" };
+	rec.out = NULL;
+	CHECK( superParseBatch( spec, &rec, 1, NULL, 0, 1 ) == SG_ERROR_NO_ARENA );
+
+	superFreeOpt( spec );
+
+	// the words are values, even those that look like options or @files
+	CHECK( superCompileOpt( &spec, &err,
+			"-port %d", &port, "",
+			"-args *%s", args, &numArgs, "",
+			"@", &quiet, "",
+			(char *) 0 ) == 0 );
+	CHECK( superEnvOpt( spec, "TSS_", NULL ) == 0 );
+	port = 0;
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "x" }, &err ) == 1 );
+	CHECK( port == 8080 && numArgs == 3 && strcmp( args[0], "-port" ) == 0 );
+	CHECK( strcmp( args[1], "@missing.rsp" ) == 0 && strcmp( args[2], "-x" ) == 0 );
+
+	superFreeOpt( spec );
+}
+
+/* replaces the file through a rename, the way editors save */
+static void rewrite( const char *path, const char *text )
+{
+	char tmp[80];
+	int fd;
+
+	snprintf( tmp, sizeof(tmp), "%s.new", path );
+	fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+	CHECK( fd >= 0 && write( fd, text, strlen( text ) ) == (ssize_t) strlen( text ) );
+	close( fd );
+	CHECK( rename( tmp, path ) == 0 );
+}
+
+static void test_watch( void )
+{
+	SG_SPEC *spec, *managed;
+	SG_CTX ctx;
+	SG_WATCH *watch;
+	SG_STATS before, after;
+	const int *changed;
+	const char *text = "-port 80 -name alpha\n# comment\n-level 1\n-port 81\n";
+	char path[64], line[64], *big, *p;
+	char *name = "none";
+	int err, port = 1, level = 5, verbose, numSizes = 4, sizes[4], i;
+	int *list;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-port %d", &port, "",
+			"-name %s", &name, "",
+			"-level %d", &level, "",
+			"-v", &verbose, "",
+			"-sizes *%d", sizes, &numSizes, "",
+			(char *) 0 ) == 0 );
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+
+	write_temp( path, text, strlen( text ) );
+	CHECK( superWatchFile( &watch, &ctx, path ) == 0 );
+	CHECK( superReloadFile( watch, &err ) == 0 );
+	CHECK( port == 81 && strcmp( name, "alpha" ) == 0 && level == 1 && verbose == 0 );
+	CHECK( superWatchChanges( watch, &changed ) == 3 && changed[0] == 0 && changed[1] == 1 && changed[2] == 2 );
+
+	// the last -port went away: the first line sets it again
+	rewrite( path, "-port 80 -name alpha\n-level 1\n-sizes 1 2 -v\n" );
+	CHECK( superWatchPoll( watch, 1000 ) == 1 );
+	CHECK( superReloadFile( watch, &err ) == 0 );
+	CHECK( port == 80 && level == 1 && verbose == 1 && numSizes == 2 && sizes[1] == 2 && strcmp( name, "alpha" ) == 0 );
+	CHECK( superWatchChanges( watch, &changed ) == 3 && changed[0] == 0 && changed[1] == 3 && changed[2] == 4 );
+
+	// blanks and comments change nothing; an option no line sets is reset
+	rewrite( path, "-port   80 -name alpha   # same tokens\n-sizes 1 2 -v\n" );
+	CHECK( superReloadFile( watch, &err ) == 0 );
+	CHECK( level == 5 && port == 80 && superWatchChanges( watch, &changed ) == 1 && changed[0] == 2 );
+
+	// a bad line changes nothing at all
+	rewrite( path, "-port 90 -name beta\n-sizes 1 2 -v\n-level x\n" );
+	CHECK( superReloadFile( watch, &err ) == SG_ERROR_INCORRECT_ARG && superWatchLine( watch ) == 3 );
+	CHECK( port == 80 && strcmp( name, "alpha" ) == 0 && level == 5 && superWatchChanges( watch, &changed ) == 0 );
+
+	// stray tokens are counted as by superParseFile()
+	rewrite( path, "-port 80 -name alpha\n-sizes 1 2 -v\nstray\n" );
+	CHECK( superReloadFile( watch, &err ) == 1 && superWatchChanges( watch, &changed ) == 0 );
+
+	// %s results outlive the versions they were read from
+	for( i = 0 ; i < 3 * SG_WATCH_MAPS ; i++ )
+	{
+		snprintf( line, sizeof(line), "-name alpha\n-port %d\n", i );
+		rewrite( path, line );
+		CHECK( superReloadFile( watch, &err ) == 0 && port == i && strcmp( name, "alpha" ) == 0 );
+	}
+
+	// a one-line edit of a big file converts one value
+	big = (char *) malloc( 20000 * 16 );
+	for( p = big, i = 0 ; i < 20000 ; i++ ) p += sprintf( p, "-level %d\n", i );
+	rewrite( path, big );
+	CHECK( superReloadFile( watch, &err ) == 0 && level == 19999 && port == 1 );
+	p = strstr( big, "-level 19999\n" );
+	strcpy( p, "-level 42\n" );
+	rewrite( path, big );
+	superGetStats( NULL, &before );
+	CHECK( superReloadFile( watch, &err ) == 0 && level == 42 );
+	CHECK( superGetStats( NULL, &after ) == 0 || after.conversions[SG_TYPE_INT] == before.conversions[SG_TYPE_INT] + 1 );
+	*p = '\0';	// drop the last line: the one before it sets -level again
+	rewrite( path, big );
+	superGetStats( NULL, &before );
+	CHECK( superReloadFile( watch, &err ) == 0 && level == 19998 );
+	CHECK( superGetStats( NULL, &after ) == 0 || after.conversions[SG_TYPE_INT] == before.conversions[SG_TYPE_INT] + 1 );
+	CHECK( superWatchChanges( watch, &changed ) == 1 && changed[0] == 2 );
+	free( big );
+
+	superFreeWatch( watch );
+	unlink( path );
+	superFreeOpt( spec );
+
+	CHECK( superCompileOpt( &managed, &err, "-I +%d", &list, &numSizes, "", (char *) 0 ) == 0 );
+	superInitCtx( &ctx, managed, NULL, NULL, 0 );
+	CHECK( superWatchFile( &watch, &ctx, path ) == SG_ERROR_NOT_RELOADABLE && watch == NULL );
+	superFreeOpt( managed );
+}
+
+static void check_snapshot( const SG_SNAPSHOT *snap )
+{
+	const float *f;
+	const char *s1, *s2;
+	int type, i;
+
+	i = superSnapLookup( snap, "-sizes" );
+	CHECK( i == 5 && superSnapCount( snap, i ) == 3 );
+	f = (const float *) superSnapValue( snap, i, 0, &type );
+	CHECK( type == SG_TYPE_FLOAT && f[0] == 1.5f && f[2] == 3.5f );
+
+	CHECK( *(const int *) superSnapValue( snap, superSnapLookup( snap, "-d" ), 0, &type ) == 42 && type == SG_TYPE_INT );
+	CHECK( *(const int *) superSnapValue( snap, superSnapLookup( snap, "-v" ), 0, &type ) == 1 );
+	CHECK( superSnapCount( snap, superSnapLookup( snap, "-name" ) ) == 1 );
+	CHECK( superSnapValue( snap, superSnapLookup( snap, "-name" ), 0, &type ) == NULL && type == SG_TYPE_STRING );
+
+	i = superSnapLookup( snap, "-puffy" );
+	CHECK( superSnapCount( snap, i ) == 3 );
+	CHECK( *(const char *) superSnapValue( snap, i, 0, &type ) == 'Q' && type == SG_TYPE_CHAR );
+	CHECK( *(const double *) superSnapValue( snap, i, 1, &type ) == 2.25 && type == SG_TYPE_DOUBLE );
+	s1 = (const char *) superSnapValue( snap, i, 2, &type );
+	CHECK( strcmp( s1, "shared" ) == 0 );
+
+	// strings are interned: one copy however often they occur
+	i = superSnapLookup( snap, "-I" );
+	CHECK( superSnapCount( snap, i ) == 3 );
+	s2 = (const char *) superSnapValue( snap, i, 1, NULL );
+	CHECK( s2 == s1 && strcmp( (const char *) superSnapValue( snap, i, 2, NULL ), "/usr/include" ) == 0 );
+
+	CHECK( superSnapLookup( snap, "-nope" ) == -1 && superSnapValue( snap, i, 3, &type ) == NULL );
+}
+
+static void test_snapshot( void )
+{
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	const SG_SNAPSHOT *snap;
+	char path[64], bytes[256];
+	char *name = NULL, *s, **inc;
+	char c;
+	double lf;
+	float sizes[8];
+	int err, d, v, numSizes = 8, numInc, fd, status, k;
+	unsigned long long claimed;
+	unsigned char pages[16];
+	size_t len;
+	long page;
+	char *guard;
+	pid_t pid;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-d %d", &d, "",
+			"-v", &v, "",
+			"-name %s", &name, "",
+			"-puffy %c %lf %s", &c, &lf, &s, "",
+			"-I +%s", &inc, &numInc, "",
+			"-sizes *%f", sizes, &numSizes, "",
+			(char *) 0 ) == 0 );
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	CHECK( superParseOptCtx( &ctx, 17, (char *[]) { "-d", "42", "-v", "-puffy", "Q", "2.25", "shared",
+			"-I", "a", "-I", "shared", "-I", "/usr/include", "-sizes", "1.5", "2.5", "3.5" }, &err ) == 0 );
+
+	CHECK( superSnapshotFd( &ctx, &fd ) == 0 );
+	superFreeOpt( spec );	// the snapshot needs neither the spec nor the outputs
+
+	// a forked worker maps it and reads the same values
+	pid = fork();
+	CHECK( pid >= 0 );
+	if( pid == 0 )
+	{
+		CHECK( superMapSnapshot( &snap, fd ) == 0 );
+		check_snapshot( snap );
+		superUnmapSnapshot( snap );
+		_exit(0);
+	}
+	CHECK( waitpid( pid, &status, 0 ) == pid && WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+
+	CHECK( superMapSnapshot( &snap, fd ) == 0 );
+	check_snapshot( snap );
+	memcpy( bytes, snap, sizeof(bytes) );
+	superUnmapSnapshot( snap );
+	close( fd );
+
+	// anything short or foreign is refused
+	write_temp( path, bytes, 100 );
+	fd = open( path, O_RDONLY );
+	CHECK( superMapSnapshot( &snap, fd ) == SG_ERROR_BAD_SNAPSHOT && snap == NULL );
+	close( fd );
+	unlink( path );
+	bytes[0] = 'X';
+	write_temp( path, bytes, sizeof(bytes) );
+	fd = open( path, O_RDONLY );
+	CHECK( superMapSnapshot( &snap, fd ) == SG_ERROR_BAD_SNAPSHOT );
+	close( fd );
+	unlink( path );
+
+	// a refused header's size reaches over a mapping made just before,
+	// which must survive: a truncated snapshot, then a corrupted size
+	bytes[0] = 'S';
+	page = sysconf( _SC_PAGESIZE );
+	for( k = 0 ; k < 2 ; k++ )
+	{
+		len = k == 0 ? 100 : sizeof(bytes);
+		claimed = len + 16 * page;
+		memcpy( bytes + 16, &claimed, sizeof(claimed) );
+		write_temp( path, bytes, len );
+		fd = open( path, O_RDONLY );
+		guard = (char *) mmap( NULL, 16 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		CHECK( guard != MAP_FAILED );
+		CHECK( superMapSnapshot( &snap, fd ) == SG_ERROR_BAD_SNAPSHOT && snap == NULL );
+		CHECK( mincore( guard, 16 * page, pages ) == 0 );
+		guard[16 * page - 1] = 1;
+		munmap( guard, 16 * page );
+		close( fd );
+		unlink( path );
+	}
+}
+
+struct stream_s
+{
+	int calls;
+	int count;
+	int maxChunk;
+	double sum;
+	int stopAfter;	// calls before the callback asks to stop, 0: never
+};
+
+static int sum_doubles( void *data, const void *values, int count )
+{
+	struct stream_s *st = (struct stream_s *) data;
+	const double *d = (const double *) values;
+	int i;
+
+	for( i = 0 ; i < count ; i++ ) st->sum += d[i];
+	st->calls++;
+	st->count += count;
+	if( count > st->maxChunk ) st->maxChunk = count;
+
+	return( st->stopAfter > 0 && st->calls >= st->stopAfter );
+}
+
+static int count_strings( void *data, const void *values, int count )
+{
+	const char * const *s = (const char * const *) values;
+
+	CHECK( count == 2 && strcmp( s[0], "a" ) == 0 && strcmp( s[1], "b" ) == 0 );
+	(*(int *) data)++;
+
+	return(0);
+}
+
+static void test_stream( void )
+{
+	SG_SPEC *spec;
+	struct stream_s st;
+	int err, d, strings = 0, n = 10000, i;
+	char **argv = (char **) malloc( (n + 4) * sizeof(char *) );
+	char *values = (char *) malloc( n * 8 );
+	void *ptrs[1] = { &strings };
+	const int types[1] = { SG_TYPE_STRING };
+	SG_OPTION table[1] = { { "-s", 2, 1, SG_OPTION_VAR | SG_OPTION_STREAM, types, ptrs, NULL, "help", count_strings } };
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-vanna >*%lf", sum_doubles, &st, "help",
+			"-d %d", &d, "help",
+			(char *) 0 ) == 0 );
+
+	// 10000 values arrive in chunks of at most SG_STREAM_CHUNK
+	argv[0] = "-vanna";
+	for( i = 0 ; i < n ; i++ )
+	{
+		argv[i+1] = values + i * 8;
+		sprintf( argv[i+1], "%d", i );
+	}
+	argv[n+1] = "-d";
+	argv[n+2] = "5";
+	memset( &st, 0, sizeof(st) );
+	CHECK( superParseOptSpec( spec, n + 3, argv, &err ) == 0 );
+	CHECK( st.count == n && st.calls == 3 && st.maxChunk == SG_STREAM_CHUNK && d == 5 );
+	CHECK( st.sum == (double) n * (n - 1) / 2 );
+
+	// each occurrence is streamed
+	memset( &st, 0, sizeof(st) );
+	CHECK( superParseOptSpec( spec, 6, (char *[]) { "-vanna", "1.5", "-d", "1", "-vanna", "2" }, &err ) == 0 );
+	CHECK( st.calls == 2 && st.sum == 3.5 );
+
+	memset( &st, 0, sizeof(st) );
+	st.stopAfter = 1;
+	CHECK( superParseOptSpec( spec, n + 3, argv, &err ) == SG_ERROR_CALLBACK );
+	CHECK( st.count == SG_STREAM_CHUNK );
+
+	memset( &st, 0, sizeof(st) );
+	CHECK( superParseOptSpec( spec, 3, (char *[]) { "-vanna", "1", "x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	superFreeOpt( spec );
+
+	CHECK( superCompileOpt( &spec, &err, "-d >%d", sum_doubles, &st, "help", (char *) 0 ) == SG_ERROR_BAD_FORMAT );
+	CHECK( superCompileOpt( &spec, &err, "-d >*%d", NULL, &st, "help", (char *) 0 ) == SG_ERROR_MISSING_ARG );
+
+	CHECK( superCompileTable( &spec, table, 1, &err ) == 0 );
+	CHECK( superParseOptSpec( spec, 4, (char *[]) { "-s", "a", "b", "-s" }, &err ) == 0 );
+	CHECK( strings == 1 );
+	superFreeOpt( spec );
+
+	free( argv );
+	free( values );
+}
+
+/* long var lists converted on threads must come out exactly as the
+	single-threaded parse does, errors included */
+static void test_parallel( void )
+{
+	enum { N = 20000, SHORTS = 100 };
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	char **argv = (char **) malloc( (4 * N + 8) * sizeof(char *) );
+	char *values = (char *) malloc( 4 * N * 24 );
+	int *ints = (int *) malloc( N * sizeof(int) ), *ints1 = (int *) malloc( N * sizeof(int) );
+	double *dbls = (double *) malloc( N * sizeof(double) ), *dbls1 = (double *) malloc( N * sizeof(double) );
+	short shorts[SHORTS];
+	int *managed, *managed1 = (int *) malloc( N * sizeof(int) );
+	int numInts = N, numDbls = N, numShorts = SHORTS, numManaged, v;
+	int counts[4], argc = 0, i, k, mode, n, n1 = 0, last, last1 = 0, err;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-n *%d", ints, &numInts, "",
+			"-x *%lf", dbls, &numDbls, "",
+			"-m +*%d", &managed, &numManaged, "",
+			"-s *%hd", shorts, &numShorts, "",
+			"-v", &v, "",
+			(char *) 0 ) == 0 );
+
+	// -n, -x and -m runs of N values, a -s run far longer than its array
+	for( k = 0 ; k < 4 ; k++ )
+	{
+		argv[argc++] = (char *[]) { "-n", "-x", "-m", "-s" }[k];
+		for( i = 0 ; i < N ; i++ )
+		{
+			argv[argc] = values + (k * N + i) * 24;
+			if( k == 1 ) sprintf( argv[argc], "%.17g", (i - N / 2) / 7.0 );
+			else sprintf( argv[argc], "%d", (i * 7919) % (k == 3 ? 30000 : 2000000) - (k == 3 ? 15000 : 1000000) );
+			argc++;
+		}
+	}
+	argv[argc++] = "-v";
+
+	for( k = 0 ; k < 3 ; k++ )
+	{
+		// k 1 and 2: a bad value in the -x run, then a second, earlier one in -n
+		if( k == 1 ) argv[1 + N + 1 + 17000] = "1.5x";
+		if( k == 2 ) argv[1 + 12345] = "12a";
+
+		for( mode = 0 ; mode < 2 ; mode++ )
+		{
+			superInitCtx( &ctx, spec, NULL, NULL, 0 );
+			ctx.parallelMin = mode ? 100 : 0;
+			ctx.parallelThreads = 4;
+			n = superParseOptCtx( &ctx, argc, argv, &last );
+			if( mode == 0 )
+			{
+				n1 = n;
+				last1 = last;
+				counts[0] = numInts; counts[1] = numDbls; counts[2] = numManaged; counts[3] = numShorts;
+				memcpy( ints1, ints, N * sizeof(int) );
+				memcpy( dbls1, dbls, N * sizeof(double) );
+				if( n == 0 ) memcpy( managed1, managed, N * sizeof(int) );
+				continue;
+			}
+
+			CHECK( n == n1 && last == last1 );
+			CHECK( numInts == counts[0] && numDbls == counts[1] );
+			CHECK( memcmp( ints, ints1, numInts * sizeof(int) ) == 0 );
+			CHECK( memcmp( dbls, dbls1, numDbls * sizeof(double) ) == 0 );
+			if( n == 0 )
+			{
+				CHECK( numManaged == N && numShorts == SHORTS && v == 1 );
+				CHECK( memcmp( managed, managed1, N * sizeof(int) ) == 0 );
+			}
+		}
+	}
+	CHECK( n1 == SG_ERROR_INCORRECT_ARG && numInts == 12345 );
+
+	// a threshold of 1 and more threads than chunks still work
+	argv[1 + 12345] = "0";
+	argv[1 + N + 1 + 17000] = "0";
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	ctx.parallelMin = 1;
+	ctx.parallelThreads = 64;
+	CHECK( superParseOptCtx( &ctx, argc, argv, &last ) == 0 && numInts == N && numManaged == N && v == 1 );
+	superFreeOpt( spec );
+
+	free( argv ); free( values );
+	free( ints ); free( ints1 ); free( dbls ); free( dbls1 ); free( managed1 );
+}
+
+static void test_lazy( void )
+{
+	static char *cases[][16] = {
+		{ "-n", "1", "2", "3", "4", "5", "6", "-p", "2.5", "name", "7", "-s", "a", "b", "-v", 0 },
+		{ "-n", "1", "x", "3", "-v", 0 },
+		{ "-n", "1", "2", "3", "4", "5", "6x", "-v", 0 },
+		{ "-p", "1", "a", "2x", "-p", "3", "b", "4", 0 },
+		{ "-p", "1", "a", "-v", 0 },
+		{ "-p", "1", "-pi", "2", 0 },
+		{ "-m", "4", "5", "-n", "8", "-n", "9", "-m", "6", 0 },
+	};
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	int ints[4], ints1[4], managedInts[8], numInts, numStrings, numManaged, v, k, argc, n, n1, last, last1, err, x;
+	char *strings[4], *name, *name1;
+	short h, h1;
+	int *managed;
+	double p, p1;
+
+	numInts = numStrings = 4;
+	CHECK( superCompileOpt( &spec, &err,
+			"-n *%d", ints, &numInts, "",
+			"-p %lf %s %hd", &p, &name, &h, "",
+			"-s *%s", strings, &numStrings, "",
+			"-m +*%d", &managed, &numManaged, "",
+			"-v", &v, "",
+			(char *) 0 ) == 0 );
+
+	// lazy and validated gives what an eager parse gives, errors included
+	for( k = 0 ; k < (int) (sizeof(cases) / sizeof(cases[0])) ; k++ )
+	{
+		for( argc = 0 ; cases[k][argc] != NULL ; argc++ );
+
+		superInitCtx( &ctx, spec, NULL, NULL, 0 );
+		memset( ints, 0, sizeof(ints) );
+		p = 0; name = NULL; h = 0;
+		n1 = superParseOptCtx( &ctx, argc, cases[k], &last1 );
+		memcpy( ints1, ints, sizeof(ints) );
+		p1 = p; name1 = name; h1 = h;
+		x = numManaged;
+		if( n1 == 0 && numManaged > 0 ) memcpy( managedInts, managed, numManaged * sizeof(int) );
+
+		memset( ints, 0, sizeof(ints) );
+		p = 0; name = NULL; h = 0;
+		ctx.lazy = 1;
+		n = superParseOptCtx( &ctx, argc, cases[k], &last );
+		if( n == 0 ) n = superLazyValidate( &ctx, &last );
+		CHECK( n == n1 && last == last1 );
+		if( n == 0 )
+		{
+			CHECK( memcmp( ints, ints1, numInts * sizeof(int) ) == 0 && p == p1 && h == h1 && name == name1 );
+			CHECK( numManaged == x && (x == 0 || memcmp( managed, managedInts, x * sizeof(int) ) == 0) );
+		}
+	}
+
+	// only what is read gets converted, and is kept in the output
+	ints[0] = ints[2] = -1;
+	CHECK( superParseOptCtx( &ctx, 15, cases[0], &last ) == 0 && numInts == 4 && numStrings == 2 && v == 1 );
+	CHECK( name == cases[0][9] && superLazyGet( &ctx, 0, 1, SG_TYPE_INT, &x ) == 0 && x == 2 );
+	CHECK( ints[0] == -1 && ints[1] == 2 && ints[2] == -1 );
+	ints[1] = 5;
+	CHECK( superLazyGet( &ctx, 0, 1, SG_TYPE_INT, &x ) == 0 && x == 5 );
+	CHECK( superLazyGet( &ctx, 1, 2, SG_TYPE_SHORT, &h1 ) == 0 && h1 == 7 );
+	CHECK( superLazyGet( &ctx, 4, 0, SG_TYPE_INT, &x ) == 0 && x == 1 );
+	CHECK( superLazyGet( &ctx, 2, 1, SG_TYPE_STRING, &name1 ) == 0 && strcmp( name1, "b" ) == 0 );
+	CHECK( superLazyGet( &ctx, 0, 4, SG_TYPE_INT, &x ) == SG_ERROR_MISSING_ARG );
+	CHECK( superLazyGet( &ctx, 1, 0, SG_TYPE_FLOAT, &x ) == SG_ERROR_BAD_ARGTYPE );
+	CHECK( superLazyGet( &ctx, 1, 3, SG_TYPE_SHORT, &x ) == SG_ERROR_BAD_ARGTYPE );
+	CHECK( superLazyGet( &ctx, 5, 0, SG_TYPE_INT, &x ) == SG_ERROR_BAD_ARGTYPE );
+	CHECK( superLazyValidate( &ctx, &last ) == 0 && ints[0] == 1 && ints[1] == 5 && ints[3] == 4 );
+
+	// a bad value fails where it is read, and again until it is fixed
+	CHECK( superParseOptCtx( &ctx, 5, cases[1], &last ) == 0 );
+	CHECK( superLazyGet( &ctx, 0, 0, SG_TYPE_INT, &x ) == 0 && x == 1 );
+	CHECK( superLazyGet( &ctx, 0, 1, SG_TYPE_INT, &x ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( superLazyValidate( &ctx, &last ) == SG_ERROR_INCORRECT_ARG && last == 3 );
+	CHECK( superLazyGet( &ctx, 0, 2, SG_TYPE_INT, &x ) == 0 && x == 3 );
+
+	// eager contexts read through the same getter
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	CHECK( superParseOptCtx( &ctx, 9, cases[6], &last ) == 0 );
+	CHECK( superLazyGet( &ctx, 3, 2, SG_TYPE_INT, &x ) == 0 && x == 6 && superLazyValidate( &ctx, &last ) == 0 );
+	CHECK( superLazyGet( &ctx, 0, 0, SG_TYPE_INT, &x ) == 0 && x == 9 );
+
+	superFreeOpt( spec );
+}
+
+static void test_commands( void )
+{
+	static const char *names[] = { "set", "get", "sum" };
+	SG_SPEC *specs[3], *dup[2];
+	SG_COMMANDS *cmds;
+	SG_CTX ctx;
+	char line[128], *key = NULL, *getKey = NULL;
+	int value = 0, ints[4], numInts = 4, c, last, err, i;
+	long before;
+
+	CHECK( superCompileOpt( &specs[0], &err, "-key %s", &key, "", "-value %d", &value, "", (char *) 0 ) == 0 );
+	CHECK( superCompileOpt( &specs[1], &err, "-key %s", &getKey, "", (char *) 0 ) == 0 );
+	CHECK( superCompileOpt( &specs[2], &err, "-n *%d", ints, &numInts, "", (char *) 0 ) == 0 );
+	CHECK( superCompileCommands( &cmds, names, specs, 3 ) == 0 );
+	CHECK( superCommandLookup( cmds, "sum" ) == 2 && superCommandLookup( cmds, "su" ) == -1 );
+	superInitCtx( &ctx, NULL, NULL, NULL, 0 );
+
+	strcpy( line, "set -key alpha -value 42" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 0 && c == 0 );
+	CHECK( strcmp( key, "alpha" ) == 0 && value == 42 && ctx.spec == specs[0] );
+
+	strcpy( line, "  get -key 'two words'  # the rest is a comment" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 0 && c == 1 && strcmp( getKey, "two words" ) == 0 );
+
+	// a newline ends the command
+	strcpy( line, "sum -n 1 2 3\nset -value 9" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 0 && c == 2 && numInts == 3 && ints[2] == 3 && value == 42 );
+
+	strcpy( line, " # nothing" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 0 && c == -1 );
+	strcpy( line, "sets -value 1" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == SG_ERROR_UNKNOWN_COMMAND && c == -1 );
+	strcpy( line, "set -value x" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == SG_ERROR_INCORRECT_ARG && c == 0 );
+	strcpy( line, "get -key \"open" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == SG_ERROR_UNTERMINATED_QUOTE );
+	strcpy( line, "set extra -value 1" );
+	CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 1 && value == 1 );
+
+	// dispatch allocates nothing
+	before = numAllocs;
+	for( i = 0 ; i < 1000 ; i++ )
+	{
+		strcpy( line, i & 1 ? "sum -n 4 5" : "set -key k -value 7" );
+		CHECK( superParseCommand( cmds, &ctx, line, &c, &last ) == 0 );
+	}
+	CHECK( numAllocs == before );
+
+	superFreeCommands( cmds );
+	dup[0] = dup[1] = specs[0];
+	CHECK( superCompileCommands( &cmds, (const char *[]) { "a", "a" }, dup, 2 ) == SG_ERROR_BAD_FORMAT && cmds == NULL );
+	for( i = 0 ; i < 3 ; i++ ) superFreeOpt( specs[i] );
+}
+
+static void test_subcommands( void )
+{
+	static const int strType = SG_TYPE_STRING, intType = SG_TYPE_INT, badType = 99;
+	static char *message;
+	static int amend, count;
+	static void * const messagePtr[] = { &message }, * const amendPtr[] = { &amend }, * const countPtr[] = { &count };
+	static const SG_OPTION commitOpts[] = {
+		{ "-m", 2, 1, 0, &strType, messagePtr, NULL, "message", NULL },
+		{ "-amend", 6, 0, 0, NULL, amendPtr, NULL, "redo the last commit", NULL },
+	};
+	static const SG_OPTION logOpts[] = { { "-n", 2, 1, 0, &intType, countPtr, NULL, "entries", NULL } };
+	static const SG_OPTION brokenOpts[] = {
+		{ "-n", 2, 1, 0, &intType, countPtr, NULL, "", NULL },
+		{ "-x", 2, 1, 0, &badType, countPtr, NULL, "", NULL },
+	};
+	static const SG_SUBCOMMAND subs[] = {
+		{ "status", NULL, 0, "show the state" },
+		{ "commit", commitOpts, 2, "record changes" },
+		{ "log", logOpts, 1, "show history" },
+		{ "broken", brokenOpts, 2, "never compiles" },
+	};
+	SG_SUBCOMMANDS *set;
+	const SG_SPEC *spec;
+	SG_CTX ctx;
+	char *argv[8] = { "tool", "commit", "-m", "fix", "-amend", NULL }, text[256];
+	int c, last, i, fds[2];
+	ssize_t n;
+	long before;
+
+	CHECK( superNewSubcommands( &set, subs, 4 ) == 0 );
+	superInitCtx( &ctx, NULL, NULL, NULL, 0 );
+
+	// "broken" is never compiled unless chosen, and a chosen one only once
+	CHECK( superParseSubcommand( set, &ctx, 5, argv, &c, &last ) == 0 && c == 1 );
+	CHECK( strcmp( message, "fix" ) == 0 && amend == 1 );
+	spec = ctx.spec;
+	before = numAllocs;
+	argv[4] = "-m";
+	argv[5] = "again";
+	CHECK( superParseSubcommand( set, &ctx, 6, argv, &c, &last ) == 0 && c == 1 && ctx.spec == spec );
+	CHECK( strcmp( message, "again" ) == 0 && amend == 0 && numAllocs == before );
+
+	argv[1] = "log";
+	argv[2] = "-n";
+	argv[3] = "12";
+	CHECK( superParseSubcommand( set, &ctx, 4, argv, &c, &last ) == 0 && c == 2 && count == 12 );
+	argv[1] = "status";
+	CHECK( superParseSubcommand( set, &ctx, 2, argv, &c, &last ) == 0 && c == 0 );
+	CHECK( superSubcommandSpec( set, 1, &spec, &last ) == 0 && superLookupOpt( spec, "-amend" ) == 1 );
+
+	argv[1] = "stat";
+	CHECK( superParseSubcommand( set, &ctx, 2, argv, &c, &last ) == SG_ERROR_UNKNOWN_COMMAND && c == -1 );
+	CHECK( superParseSubcommand( set, &ctx, 1, argv, &c, &last ) == SG_ERROR_PRINT_USAGE && c == -1 );
+	argv[1] = "broken";
+	CHECK( superParseSubcommand( set, &ctx, 2, argv, &c, &last ) == SG_ERROR_BAD_FORMAT_TYPE && c == 3 && last == 2 );
+
+	for( i = 0 ; i < 2 ; i++ ) CHECK( superSubcommandSpec( set, 0, &spec, &last ) == 0 && spec == ctx.spec );
+
+	CHECK( pipe( fds ) == 0 && superWriteSubcommands( set, fds[1] ) == 0 );
+	close( fds[1] );
+	n = read( fds[0], text, sizeof(text) - 1 );
+	close( fds[0] );
+	CHECK( n > 0 && (text[n] = '\0', strstr( text, "  log    show history\n" ) != NULL) );
+
+	superFreeSubcommands( set );
+}
+
+static void test_response( void )
+{
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	SG_ARENA *arena;
+	SG_RECORD record;
+	char inner[64], outer[64], self[64], bad[64], big[64];
+	char arg[128];
+	char *list[8], **files;
+	FILE *fp;
+	char *text;
+	int numl = 8, numFiles, d, resp, err, i;
+	size_t len;
+
+	CHECK( superCompileOpt( &spec, &err,
+			"-d %d", &d, "help",
+			"-list *%s", list, &numl, "help",
+			"-files +*%s", &files, &numFiles, "help",
+			"@", &resp, "read arguments from a file",
+			(char *) 0 ) == 0 );
+
+	// the inner file's tokens continue the outer file's -list
+	write_temp( inner, "x \"y z\"\n\n  w\n", 14 );
+	sprintf( arg, "-list a 'b c' @%s\n-d 7\n", inner );
+	write_temp( outer, arg, strlen( arg ) );
+	sprintf( arg, "@%s", outer );
+	CHECK( superGetOptSpec( spec, 3, (char *[]) { "prog", arg, "extra" }, &err ) == 1 );
+	CHECK( resp == 1 && d == 7 && numl == 5 );
+	CHECK( strcmp( list[1], "b c" ) == 0 && strcmp( list[2], "x" ) == 0 && strcmp( list[3], "y z" ) == 0 && strcmp( list[4], "w" ) == 0 );
+	CHECK( superParseOptSpec( spec, 2, (char *[]) { "-d", "1" }, &err ) == 0 );
+	CHECK( resp == 0 && d == 1 );
+
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { "@/nonexistent/file" }, &err ) == SG_ERROR_FILE );
+
+	// a file that names itself stops at the depth limit
+	write_temp( self, "", 0 );
+	fp = fopen( self, "w" );
+	CHECK( fp != NULL );
+	fprintf( fp, "-d 1 @%s", self );
+	fclose( fp );
+	sprintf( arg, "@%s", self );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { arg }, &err ) == SG_ERROR_RESPONSE_DEPTH );
+
+	write_temp( bad, "-d 'unterminated", 16 );
+	sprintf( arg, "@%s", bad );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { arg }, &err ) == SG_ERROR_UNTERMINATED_QUOTE );
+
+	// far more arguments than ARG_MAX would allow, all pointing into the mapping
+	len = 0;
+	text = (char *) malloc( 100000 * 8 + 16 );
+	len += sprintf( text, "-files" );
+	for( i = 0 ; i < 100000 ; i++ ) len += sprintf( text + len, " f%d", i );
+	write_temp( big, text, len );
+	free( text );
+	CHECK( superNewArena( &arena ) == 0 );
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	ctx.arena = arena;
+	sprintf( arg, "@%s", big );
+	CHECK( superParseOptCtx( &ctx, 1, (char *[]) { arg }, &err ) == 0 );
+	CHECK( numFiles == 100000 && strcmp( files[0], "f0" ) == 0 && strcmp( files[99999], "f99999" ) == 0 );
+	superFreeArena( arena );
+
+	// batch contexts have no arena for the mappings
+	record.argc = 1;
+	record.argv = (char *[]) { arg };
+	record.out = NULL;
+	CHECK( superParseBatch( spec, &record, 1, NULL, 0, 1 ) == SG_ERROR_NO_ARENA );
+
+	unlink( inner );
+	unlink( outer );
+	unlink( self );
+	unlink( bad );
+	unlink( big );
+	superFreeOpt( spec );
+
+	// without an "@" flag the token is an ordinary argument
+	CHECK( superCompileOpt( &spec, &err, "-d %d", &d, "help", (char *) 0 ) == 0 );
+	CHECK( superParseOptSpec( spec, 1, (char *[]) { arg }, &err ) == 1 );
+	superFreeOpt( spec );
+}
+
+static void test_managed( void )
+{
+	static char *argv[4 + 3 + 2 + 2 + 10000];
+	SG_SPEC *spec;
+	SG_ARENA *arena;
+	SG_CTX ctx;
+	SG_RECORD record;
+	char **incs;
+	int *ins, *kept;
+	double *lfs;
+	int numIncs, numIns, numLfs, err, n, i, argc;
+	long before;
+	char buf[16];
+
+	n = superCompileOpt( &spec, &err,
+			"-I +%s", &incs, &numIncs, "include paths, repeatable",
+			"-in +*%d", &ins, &numIns, "inputs",
+			"-lf +%lf", &lfs, &numLfs, "reals",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	argc = 0;
+	argv[argc++] = "-I"; argv[argc++] = "a";
+	argv[argc++] = "-in"; argv[argc++] = "1"; argv[argc++] = "2"; argv[argc++] = "3";
+	argv[argc++] = "-I"; argv[argc++] = "b";
+	argv[argc++] = "-in";
+	for( i = 0 ; i < 10000 ; i++ )
+	{
+		sprintf( buf, "%d", 4 + i );
+		argv[argc++] = strdup( buf );
+	}
+
+	CHECK( superParseOptSpec( spec, argc, argv, &err ) == 0 );
+	CHECK( numIncs == 2 && strcmp( incs[0], "a" ) == 0 && strcmp( incs[1], "b" ) == 0 );
+	CHECK( numLfs == 0 && lfs == NULL );
+	CHECK( numIns == 10003 );
+	for( i = 0 ; i < numIns ; i++ ) CHECK( ins[i] == i + 1 );
+
+	// the per-thread arena is reused: steady state allocates nothing
+	before = numAllocs;
+	for( i = 0 ; i < 100 ; i++ ) CHECK( superParseOptSpec( spec, argc, argv, &err ) == 0 );
+	CHECK( numAllocs == before && numIns == 10003 );
+
+	// a caller's arena keeps results across parses until it is reset
+	CHECK( superNewArena( &arena ) == 0 );
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	ctx.arena = arena;
+	CHECK( superParseOptCtx( &ctx, 6, argv, &err ) == 0 );
+	kept = ins;
+	CHECK( numIns == 3 && superParseOptSpec( spec, 9, argv, &err ) == 0 );
+	CHECK( kept[0] == 1 && kept[2] == 3 && ins != kept );
+	superFreeArena( arena );
+
+	CHECK( superParseOptSpec( spec, 4, (char *[]) { "-lf", "2.5", "-lf", "x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	CHECK( numLfs == 1 && lfs[0] == 2.5 );
+
+	record.argc = 2;
+	record.argv = argv;
+	record.out = NULL;
+	CHECK( superParseBatch( spec, &record, 1, NULL, 0, 1 ) == SG_ERROR_NO_ARENA );
+
+	for( i = 9 ; i < argc ; i++ ) free( argv[i] );
+	superFreeOpt( spec );
+
+	CHECK( superCompileOpt( &spec, &err, "-x +%d %d", &ins, &numIns, "", (char *) 0 ) == SG_ERROR_BAD_FORMAT );
+}
+
+static void test_stats( void )
+{
+	SG_SPEC *spec;
+	SG_CTX ctx;
+	SG_STATS stats, before;
+	char *argv[] = { "-d", "5", "-list", "1", "2", "-lf", "2.5", "stray" };
+	int err, n, level, d;
+	double lf;
+	int iarray[4];
+	int numi = 4;
+
+	n = superCompileOpt( &spec, &err,
+			"-d %d", &d, "help",
+			"-lf %lf", &lf, "help",
+			"-list *%d", iarray, &numi, "help",
+			(char *) 0 );
+	CHECK( n == 0 );
+
+	superInitCtx( &ctx, spec, NULL, NULL, 0 );
+	CHECK( superParseOptCtx( &ctx, 8, argv, &err ) == 1 );
+	level = superGetStats( &ctx, &stats );
+	if( level == 0 )
+	{
+		superFreeOpt( spec );
+		return;
+	}
+
+	CHECK( stats.parses == 1 && stats.formatsCompiled == 3 );
+	CHECK( stats.tokensScanned == 9 );	// "-lf" ends the list and is read again as an option
+	CHECK( stats.lookups == 5 && stats.lookupProbes == 4 );	// "stray" fails the first byte filter
+	CHECK( stats.conversions[2] == 3 && stats.conversions[4] == 1 && stats.conversionFailures == 0 );
+	if( level > 1 ) CHECK( stats.bytesScanned == 24 && stats.setupNs > 0 && stats.matchNs > 0 && stats.convertNs > 0 );
+
+	CHECK( superParseOptCtx( &ctx, 2, (char *[]) { "-d", "x" }, &err ) == SG_ERROR_INCORRECT_ARG );
+	superGetStats( &ctx, &stats );
+	CHECK( stats.parses == 2 && stats.conversionFailures == 1 );
+	superResetStats( &ctx );
+	superGetStats( &ctx, &stats );
+	CHECK( stats.parses == 0 && stats.tokensScanned == 0 );
+
+	// context-less calls add up per thread
+	superGetStats( NULL, &before );
+	CHECK( superParseOptSpec( spec, 8, argv, &err ) == 1 );
+	superGetStats( NULL, &stats );
+	CHECK( stats.parses == before.parses + 1 && stats.tokensScanned == before.tokensScanned + 9 );
+
+	superFreeOpt( spec );
+}
+
+int main( void )
+{
+	test_basic();
+	test_integers();
+	test_wide_types();
+	test_reals();
+	test_many_options();
+	test_prefix();
+	test_allocations();
+	test_threads();
+	test_file();
+	test_batch();
+	test_managed();
+	test_response();
+	test_stream();
+	test_parallel();
+	test_lazy();
+	test_commands();
+	test_subcommands();
+	test_usage();
+	test_env();
+	test_watch();
+	test_snapshot();
+	test_stats();
+
+	printf("testSuperSpec: all tests passed\n");
+
+	return(0);
+}